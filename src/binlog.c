@@ -0,0 +1,352 @@
+/*
+   binlog.c
+
+   Copyright (c) 2026 by Daniel Kelley
+
+*/
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include "codec.h"
+#include "binlog.h"
+
+/*
+ * binlog_add() copies the capture into a queue and returns; the
+ * writer thread takes everything queued in one writev(), so the
+ * event loop never waits on the disk. Should the disk fall so far
+ * behind that the queue is full, captures are dropped and counted
+ * rather than holding up the next sweep.
+ *
+ * Queue slots from tail to head belong to the writer until it moves
+ * tail past them, so it writes them in place without the lock. A
+ * packed log has them packed into a batch buffer first, also on the
+ * writer thread.
+ */
+struct binlog {
+    int fd;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    struct capture queue[BINLOG_QUEUE_DEPTH];
+    unsigned long head;             /* captures queued */
+    unsigned long tail;             /* captures dealt with */
+    unsigned long written;
+    unsigned long dropped;
+    int stop;
+    int error;                      /* errno of the first failure */
+    uint64_t offset;                /* end of the records */
+    uint8_t *batch;                 /* packed records; NULL: raw log */
+    struct binlog_index *index;
+    size_t index_len;
+    size_t index_max;
+};
+
+/* Write all of the iovecs, however many calls that takes. */
+static int binlog_writev(int fd, struct iovec *iov, int iovcnt)
+{
+    ssize_t n;
+
+    while (iovcnt > 0) {
+        n = writev(fd, iov, iovcnt);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno;
+        }
+        while (iovcnt > 0 && (size_t)n >= iov->iov_len) {
+            n -= (ssize_t)iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= (size_t)n;
+        }
+    }
+
+    return 0;
+}
+
+static int binlog_index_add(struct binlog *log,
+                            const struct capture *cap,
+                            size_t len)
+{
+    struct binlog_index *index;
+    size_t max;
+
+    if (log->index_len == log->index_max) {
+        max = log->index_max ? log->index_max * 2 : 1024;
+        index = realloc(log->index, max * sizeof(*index));
+        if (!index) {
+            return ENOMEM;
+        }
+        log->index = index;
+        log->index_max = max;
+    }
+    index = &log->index[log->index_len++];
+    index->seq = cap->seq;
+    index->tv_sec = cap->tv.tv_sec;
+    index->tv_usec = cap->tv.tv_usec;
+    index->offset = log->offset;
+    log->offset += len;
+
+    return 0;
+}
+
+/* Pack and write the queued captures from tail up to head. */
+static int binlog_write_packed(struct binlog *log,
+                               unsigned long tail,
+                               size_t n)
+{
+    const struct capture *cap;
+    struct iovec iov;
+    uint32_t len;
+    size_t pos = 0;
+    size_t j;
+    int err = 0;
+
+    for (j=0; !err && j<n; j++) {
+        cap = &log->queue[(tail + j) % BINLOG_QUEUE_DEPTH];
+        len = (uint32_t)codec_pack(cap, log->batch + pos + sizeof(len));
+        memcpy(log->batch + pos, &len, sizeof(len));
+        err = binlog_index_add(log, cap, sizeof(len) + len);
+        pos += sizeof(len) + len;
+    }
+
+    iov.iov_base = log->batch;
+    iov.iov_len = pos;
+
+    return err ? err : binlog_writev(log->fd, &iov, 1);
+}
+
+/* Write the queued captures from tail up to head. */
+static int binlog_write(struct binlog *log, unsigned long tail, size_t n)
+{
+    struct iovec iov[2];
+    size_t first = tail % BINLOG_QUEUE_DEPTH;
+    size_t run = BINLOG_QUEUE_DEPTH - first;
+    size_t j;
+    int iovcnt = 1;
+    int err;
+
+    if (log->batch) {
+        return binlog_write_packed(log, tail, n);
+    }
+
+    if (run > n) {
+        run = n;
+    }
+    iov[0].iov_base = &log->queue[first];
+    iov[0].iov_len = run * sizeof(struct capture);
+    if (run < n) {
+        /* Wrapped */
+        iov[1].iov_base = &log->queue[0];
+        iov[1].iov_len = (n - run) * sizeof(struct capture);
+        iovcnt = 2;
+    }
+
+    err = binlog_writev(log->fd, iov, iovcnt);
+    for (j=0; !err && j<n; j++) {
+        err = binlog_index_add(log,
+                               &log->queue[(tail + j) % BINLOG_QUEUE_DEPTH],
+                               sizeof(struct capture));
+    }
+
+    return err;
+}
+
+static void *binlog_thread(void *arg)
+{
+    struct binlog *log = arg;
+    unsigned long tail;
+    size_t n;
+    int err;
+
+    pthread_mutex_lock(&log->lock);
+    for (;;) {
+        while (log->head == log->tail && !log->stop) {
+            pthread_cond_wait(&log->cond, &log->lock);
+        }
+        if (log->head == log->tail) {
+            break;
+        }
+        tail = log->tail;
+        n = log->head - tail;
+        pthread_mutex_unlock(&log->lock);
+
+        err = log->error ? 0 : binlog_write(log, tail, n);
+
+        pthread_mutex_lock(&log->lock);
+        if (err) {
+            log->error = err;
+        }
+        if (log->error) {
+            log->dropped += n;
+        } else {
+            log->written += n;
+        }
+        log->tail += n;
+    }
+    pthread_mutex_unlock(&log->lock);
+
+    return NULL;
+}
+
+/* Append the index and trailer once the records are all out. */
+static int binlog_footer(struct binlog *log)
+{
+    struct binlog_trailer trailer;
+    struct iovec iov[2];
+
+    memset(&trailer, 0, sizeof(trailer));
+    memcpy(trailer.magic, BINLOG_INDEX_MAGIC, sizeof(trailer.magic));
+    trailer.count = log->index_len;
+    trailer.offset = log->offset;
+
+    iov[0].iov_base = log->index;
+    iov[0].iov_len = log->index_len * sizeof(*log->index);
+    iov[1].iov_base = &trailer;
+    iov[1].iov_len = sizeof(trailer);
+
+    return binlog_writev(log->fd, iov, 2);
+}
+
+struct binlog *binlog_open(const char *path, int packed)
+{
+    struct binlog *log;
+    struct binlog_header hdr;
+    struct iovec iov;
+    int err = 0;
+
+    log = calloc(1, sizeof(*log));
+    if (!log) {
+        return NULL;
+    }
+
+    do {
+        if (packed) {
+            log->batch = malloc(BINLOG_QUEUE_DEPTH *
+                                (sizeof(uint32_t) + CODEC_MAX_BYTES));
+            if (!log->batch) {
+                err = ENOMEM;
+                break;
+            }
+        }
+
+        log->fd = open(path, O_WRONLY|O_CREAT|O_EXCL, 0644);
+        if (log->fd < 0) {
+            err = errno;
+            break;
+        }
+
+        memset(&hdr, 0, sizeof(hdr));
+        memcpy(hdr.magic, BINLOG_MAGIC, sizeof(hdr.magic));
+        hdr.version = BINLOG_VERSION;
+        hdr.record_size = packed ? 0 : sizeof(struct capture);
+        iov.iov_base = &hdr;
+        iov.iov_len = sizeof(hdr);
+        err = binlog_writev(log->fd, &iov, 1);
+        if (err) {
+            close(log->fd);
+            break;
+        }
+        log->offset = sizeof(hdr);
+
+        pthread_mutex_init(&log->lock, NULL);
+        pthread_cond_init(&log->cond, NULL);
+        err = pthread_create(&log->thread, NULL, binlog_thread, log);
+        if (err) {
+            pthread_cond_destroy(&log->cond);
+            pthread_mutex_destroy(&log->lock);
+            close(log->fd);
+            break;
+        }
+
+        return log;
+    } while (0);
+
+    free(log->batch);
+    free(log);
+    errno = err;
+
+    return NULL;
+}
+
+/*
+ * Write out whatever is queued, then the index; returns 0 or the
+ * errno of the first failure.
+ */
+int binlog_close(struct binlog *log)
+{
+    int err;
+
+    pthread_mutex_lock(&log->lock);
+    log->stop = 1;
+    pthread_cond_signal(&log->cond);
+    pthread_mutex_unlock(&log->lock);
+    pthread_join(log->thread, NULL);
+
+    err = log->error;
+    if (!err) {
+        err = binlog_footer(log);
+    }
+    if (close(log->fd) < 0 && !err) {
+        err = errno;
+    }
+
+    pthread_cond_destroy(&log->cond);
+    pthread_mutex_destroy(&log->lock);
+    free(log->index);
+    free(log->batch);
+    free(log);
+
+    return err;
+}
+
+/* Queue a capture; -1 if it had to be dropped. */
+int binlog_add(struct binlog *log, const struct capture *cap)
+{
+    int err = 0;
+
+    pthread_mutex_lock(&log->lock);
+    if (log->error || log->head - log->tail == BINLOG_QUEUE_DEPTH) {
+        log->dropped++;
+        err = -1;
+    } else {
+        log->queue[log->head % BINLOG_QUEUE_DEPTH] = *cap;
+        log->head++;
+        pthread_cond_signal(&log->cond);
+    }
+    pthread_mutex_unlock(&log->lock);
+
+    return err;
+}
+
+unsigned long binlog_written(struct binlog *log)
+{
+    unsigned long written;
+
+    pthread_mutex_lock(&log->lock);
+    written = log->written;
+    pthread_mutex_unlock(&log->lock);
+
+    return written;
+}
+
+unsigned long binlog_dropped(struct binlog *log)
+{
+    unsigned long dropped;
+
+    pthread_mutex_lock(&log->lock);
+    dropped = log->dropped;
+    pthread_mutex_unlock(&log->lock);
+
+    return dropped;
+}
@@ -0,0 +1,67 @@
+/*
+   binlog.h
+
+   Copyright (c) 2026 by Daniel Kelley
+
+   Append only binary log of published oscilloscope captures, written
+   by a thread of its own.
+
+*/
+
+#ifndef   BINLOG_H_
+#define   BINLOG_H_
+
+#include <stdint.h>
+#include "capture.h"
+
+#define BINLOG_MAGIC "CGR1LOG"      /* with the NUL, 8 bytes */
+#define BINLOG_INDEX_MAGIC "CGR1IDX"
+#define BINLOG_VERSION 1
+#define BINLOG_QUEUE_DEPTH 64       /* captures waiting to be written */
+
+/*
+ * File layout:
+ *
+ *   struct binlog_header
+ *   struct capture            one per capture, record_size bytes each
+ *   ...
+ *   struct binlog_index       one per capture, when closed cleanly
+ *   ...
+ *   struct binlog_trailer
+ *
+ * A packed log (record_size 0) has instead for each capture a
+ * uint32_t length and that many bytes of codec_pack() output, which
+ * codec_unpack() turns back into the struct capture; see codec.h.
+ *
+ * A reader looks for the trailer at the end of the file first; if it
+ * isn't there the server didn't close the log, and the records can
+ * still be read in order from the header up to the last whole one.
+ */
+struct binlog_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;           /* sizeof(struct capture); 0: packed */
+};
+
+struct binlog_index {
+    uint64_t seq;
+    int64_t tv_sec;
+    int64_t tv_usec;
+    uint64_t offset;                /* of the record in the file */
+};
+
+struct binlog_trailer {
+    char magic[8];
+    uint64_t count;                 /* index entries */
+    uint64_t offset;                /* of the first index entry */
+};
+
+struct binlog;
+
+extern struct binlog *binlog_open(const char *path, int packed);
+extern int binlog_close(struct binlog *log);
+extern int binlog_add(struct binlog *log, const struct capture *cap);
+extern unsigned long binlog_written(struct binlog *log);
+extern unsigned long binlog_dropped(struct binlog *log);
+
+#endif /* BINLOG_H_ */
@@ -0,0 +1,45 @@
+/*
+   capture.h
+
+   Copyright (c) 2026 by Daniel Kelley
+
+*/
+
+#ifndef   CAPTURE_H_
+#define   CAPTURE_H_
+
+#include <stdint.h>
+#include <sys/time.h>
+
+#define CAPTURE_NUM_CHAN 2
+#define CAPTURE_NUM_SAMPLE 1024
+#define CAPTURE_MAX_COUNT 64    /* sums of 64 10 bit codes fit code[] */
+
+/*
+ * A completed oscilloscope sweep as published to clients. Samples
+ * are the raw 10 bit codes in time order (the device ring already
+ * unrotated) along with what is needed to turn them into volts. An
+ * averaged capture holds the sum of count sweeps' codes instead.
+ */
+struct capture {
+    unsigned long seq;              /* sweep sequence number; 0: none */
+    unsigned int count;             /* sweeps summed into code[] */
+    struct timeval tv;              /* completion time */
+    double sweep_time;
+    int sample_rate_divisor;
+    /* Trigger settings in effect */
+    int trigger_source;             /* enum cgr101_scope_trigger_source */
+    int trigger_chan;               /* channel the level applies to */
+    int trigger_polarity;
+    double trigger_level;
+    double trigger_offset;
+    double trigger_ref;
+    struct {
+        int low_range;
+        double step;
+        double offset;
+        uint16_t code[CAPTURE_NUM_SAMPLE];
+    } channel[CAPTURE_NUM_CHAN];
+};
+
+#endif /* CAPTURE_H_ */
@@ -12,13 +12,25 @@
 #include <stdarg.h>
 #include <unistd.h>
 #include <errno.h>
+#include <limits.h>
 #include <math.h>
 #include <sys/time.h>
 #include "worker.h"
 #include "spawn.h"
 #include "event.h"
+#include "capture.h"
+#include "history.h"
+#include "meas.h"
+#include "fft.h"
+#include "ets.h"
+#include "filter.h"
+#include "export.h"
+#include "binlog.h"
+#include "mathchan.h"
+#include "scpi_core.h"
 #include "scpi_output.h"
 #include "scpi_error.h"
+#include "scpi_input.h"
 #include "cgr101.h"
 
 #define ID_MAX 32       /* '*' identify message */
@@ -35,6 +47,9 @@
 #define STEP_LOW  0.00592
 #define MP8  128      /* 8 bit Input Offset midpoint */
 #define MP10 511      /* 10 bit sample midpoint */
+#define CODE8_MASK 0xff /* 8 bit Input Offset range */
+#define CODE10_MASK 0x3ff
+#define CODE10_SIZE (CODE10_MASK+1)
 
 static char *CMD[] = {
     "sp",
@@ -111,6 +126,17 @@ enum cgr101_scope_trigger_source {
     SCOPE_TRIGGER_SOURCE_IMM,
 };
 
+/* What to output when the sweep in progress completes. */
+enum cgr101_scope_output {
+    SCOPE_OUTPUT_DATA,
+    SCOPE_OUTPUT_DECIMATE,
+    SCOPE_OUTPUT_MEAS_VOLT,
+    SCOPE_OUTPUT_MEAS_TIME,
+    SCOPE_OUTPUT_SPECTRUM,
+    SCOPE_OUTPUT_PREAMBLE,
+    SCOPE_OUTPUT_PAIR,
+};
+
 enum cgr101_waveform_shape {
     WAV_NONE,
     WAV_RAND,
@@ -137,7 +163,92 @@ static struct cgr101_waveform_map_s cgr101_waveform_map[] = {
     { NULL, WAV_NONE},
 };
 
-#define SCOPE_NUM_CHAN 2
+/*
+ * Enumerated arguments arrive as the keyword the client typed, short
+ * or long form, and are decoded against these.
+ */
+struct cgr101_keyword_map_s {
+    const char *name;
+    int value;
+};
+
+static const struct cgr101_keyword_map_s cgr101_volt_func_map[] = {
+    { "ACRMs?", MEAS_VOLT_ACRMS},
+    { "AMPLitude?", MEAS_VOLT_AMPL},
+    { "AVERage?", MEAS_VOLT_AVER},
+    { "BASE?", MEAS_VOLT_BASE},
+    { "MAXimum?", MEAS_VOLT_MAX},
+    { "MINimum?", MEAS_VOLT_MIN},
+    { "OVERshoot?", MEAS_VOLT_OVER},
+    { "PTPeak?", MEAS_VOLT_PTP},
+    { "RMS?", MEAS_VOLT_RMS},
+    { "TOP?", MEAS_VOLT_TOP},
+    { NULL, 0},
+};
+
+static const struct cgr101_keyword_map_s cgr101_time_func_map[] = {
+    { "DCYCle?", MEAS_TIME_DCYC},
+    { "FREQuency?", MEAS_TIME_FREQ},
+    { "FTIMe?", MEAS_TIME_FTIM},
+    { "NWIDth?", MEAS_TIME_NWID},
+    { "PERiod?", MEAS_TIME_PER},
+    { "PWIDth?", MEAS_TIME_PWID},
+    { "RTIMe?", MEAS_TIME_RTIM},
+    { NULL, 0},
+};
+
+static const struct cgr101_keyword_map_s cgr101_pair_func_map[] = {
+    { "CORRelation?", MEAS_PAIR_XDELAY},
+    { "DELay?", MEAS_PAIR_DELAY},
+    { "PHASe?", MEAS_PAIR_PHASE},
+    { NULL, 0},
+};
+
+static const struct cgr101_keyword_map_s cgr101_decimate_map[] = {
+    { "MEAN", MEAS_DECIMATE_MEAN},
+    { "MINMax", MEAS_DECIMATE_MINMAX},
+    { "SAMPle", MEAS_DECIMATE_SAMPLE},
+    { NULL, 0},
+};
+
+static const struct cgr101_keyword_map_s cgr101_window_map[] = {
+    { "BHARris", FFT_WINDOW_BHARRIS},
+    { "FLATtop", FFT_WINDOW_FLATTOP},
+    { "HANNing", FFT_WINDOW_HANN},
+    { NULL, 0},
+};
+
+static const struct cgr101_keyword_map_s cgr101_filter_type_map[] = {
+    { "BPASs", FILTER_BPASS},
+    { "HPASs", FILTER_HPASS},
+    { "LPASs", FILTER_LPASS},
+    { NULL, 0},
+};
+
+static const struct cgr101_keyword_map_s cgr101_filter_form_map[] = {
+    { "FIR", FILTER_FIR},
+    { "IIR", FILTER_IIR},
+    { NULL, 0},
+};
+
+static const struct cgr101_keyword_map_s cgr101_math_func_map[] = {
+    { "ADD", MATHCHAN_ADD},
+    { "DERivative", MATHCHAN_DER},
+    { "DIVide", MATHCHAN_DIV},
+    { "INTegrate", MATHCHAN_INT},
+    { "MULTiply", MATHCHAN_MUL},
+    { "OFF", MATHCHAN_OFF},
+    { "SUBTract", MATHCHAN_SUB},
+    { NULL, 0},
+};
+
+#define SCOPE_NUM_CHAN CGR101_NUM_SCOPE
+#define SCOPE_NUM_MATH CGR101_NUM_MATH
+#define SCOPE_MATH_FIRST (CGR101_MATH_CHAN - 1) /* chan_mask bit */
+#define SCOPE_TRACE_END (SCOPE_MATH_FIRST + SCOPE_NUM_MATH)
+#define SCOPE_NUM_TRACE (SCOPE_NUM_CHAN + SCOPE_NUM_MATH)
+#define SCOPE_CHAN_MASK ((1L << SCOPE_NUM_CHAN) - 1)
+#define SCOPE_MATH_MASK (((1L << SCOPE_NUM_MATH) - 1) << SCOPE_MATH_FIRST)
 #define SCOPE_NUM_RANGE 2
 #define SCOPE_NUM_SAMPLE 1024
 #define SCOPE_DEFAULT_LOW (-25.0)
@@ -145,6 +256,16 @@ static struct cgr101_waveform_map_s cgr101_waveform_map[] = {
 #define SCOPE_DEFAULT_MIDPOINT 0.0
 #define SCOPE_DEFAULT_PTP 50.0
 #define SCOPE_SR_DIV_MAX 15
+#define SCOPE_AVERAGE_DEFAULT 16
+#define SCOPE_CAL_SWEEPS 16 /* CALibration:ZERO:COUNt default */
+#define SCOPE_AUTO_LOW_LIMIT 2.0 /* widest swing put on the low range */
+#define SCOPE_AUTO_MIN_PTP 8 /* codes; less is taken as no signal */
+#define SCOPE_AUTO_MIN_CYCLES 2 /* periods a sweep should show */
+#define SCOPE_AUTO_MAX_CYCLES 5
+#define SCOPE_RANGE_AUTO_FRAC 0.08 /* of the high range: 2 V */
+#define SCOPE_FILTER_TAPS 31
+#define SCOPE_FILTER_F1 1.0e3
+#define SCOPE_FILTER_F2 10.0e3
 #define SCOPE_SR_MAX 20.0e6 /* 20MHz */
 #define SCOPE_MIN_SWEEP_TIME ((double)SCOPE_NUM_SAMPLE/SCOPE_SR_MAX)
 #define SCOPE_NUM_DATA = (SCOPE_NUM_SAMPLE*SCOPE_NUM_CHAN*2)
@@ -260,17 +381,113 @@ struct cgr101 {
         enum cgr101_scope_data_state data_state;
         int data_count;
         int output_pending;
+        unsigned long output_seq;   /* capture.seq pending output waits for */
+        int rearm_pending;          /* EVENT_SCOPE_REARM sent, not run */
         long output_mask;
+        enum cgr101_scope_output output_kind;
+        int output_func;            /* enum meas_volt, meas_time, fft_window,
+                                       meas_decimate, meas_pair */
+        int output_points;          /* SCOPE_OUTPUT_DECIMATE */
+        int output_start;           /* SCOPE_OUTPUT_DATA slice */
+        int output_count;
+        int output_pair[2];         /* SCOPE_OUTPUT_PAIR traces */
+        int continuous;             /* SCPI INITiate:CONTinuous */
+        int average;                /* SCPI SENSe:AVERage[:STATe] */
+        int average_count;          /* SCPI SENSe:AVERage:COUNt */
+        int average_sweeps;         /* accumulated toward average_count */
+        struct capture capture;     /* last completed sweep */
+        struct history *history;    /* recently completed sweeps */
+        struct fft *fft;            /* spectrum tables */
+        enum fft_window fft_window; /* CALCulate:TRANsform:FREQuency:WINDow */
+        struct ets *ets;            /* equivalent time composite */
+        struct export *export;      /* shared memory ring; NULL: none */
+        struct binlog *binlog;      /* SYSTem:INTernal:LOG; NULL: none */
+        int binlog_packed;          /* SYSTem:INTernal:LOG:COMPress */
+        int ets_enable;             /* SCPI SENSe:ETS[:STATe] */
+        unsigned long ets_last;     /* last sweep binned */
+        unsigned long ets_sweeps;   /* sweeps binned */
+        unsigned long ets_rejected; /* sweeps without a trigger crossing */
+        unsigned long ets_skipped;  /* sweeps replaced before binning */
+        int ets_divisor;            /* composite's sample_rate_divisor */
+        double ets_t0;              /* composite's trigger point */
+        int mask_enable;            /* SCPI CALCulate:LIMit[:STATe] */
+        int mask_stop;              /* SCPI CALCulate:LIMit:STOP */
+        int mask_keep_fail;         /* SCPI CALCulate:LIMit:KEEP FAIL */
+        int mask_fail;              /* last sweep tested failed */
+        unsigned long mask_sweeps;  /* sweeps tested */
+        unsigned long mask_failures;/* sweeps that failed */
+        unsigned long mask_hits;    /* samples outside the mask */
+        int cal_range;              /* range being zeroed; -1: none */
+        int cal_store;              /* write the offsets to flash */
+        int cal_count;              /* SCPI CALibration:ZERO:COUNt */
+        int cal_sweeps;             /* sweeps in on cal_range */
+        uint64_t cal_sum[SCOPE_NUM_CHAN];
+        double cal_offset[SCOPE_NUM_CHAN][SCOPE_NUM_RANGE];
+        int auto_step;              /* autoscale step; -1: none */
+        int auto_lo;                /* divisor search bounds */
+        int auto_hi;
+        int auto_divisor;           /* sample_rate_divisor before */
+        int auto_low_range[SCOPE_NUM_CHAN];
+        double range_auto_frac;     /* SCPI ...:RANGe:AUTO:FRACtion */
+        int hist_enable;            /* SCPI CALCulate:HISTogram[:STATe] */
+        unsigned long hist_sweeps;  /* sweeps accumulated */
+        int filter_enable;          /* SCPI CALCulate:FILTer[:STATe] */
+        struct filter_spec filter;  /* CALCulate:FILTer settings */
+        unsigned long filter_gen;   /* bumped when filter changes */
+        struct {
+            unsigned long gen;      /* filter_gen designed for; 0: none */
+            struct filter_coef coef;
+        } filter_cache[SCOPE_SR_DIV_MAX+1]; /* by sample_rate_divisor */
+        struct capture filtered;    /* capture after the filter */
+        unsigned long filtered_seq; /* capture.seq filtered */
+        unsigned long filtered_gen; /* filter_gen filtered with */
+        struct mathchan_def math[SCOPE_NUM_MATH]; /* CALCulate:MATH */
+        unsigned long math_gen;     /* bumped when a definition changes */
+        struct {
+            unsigned long seq;      /* capture.seq computed from; 0: none */
+            unsigned long gen;      /* math_gen computed with */
+            unsigned long src;      /* filter_gen of the source; 0: raw */
+            double volts[SCOPE_NUM_SAMPLE];
+            uint16_t code[SCOPE_NUM_SAMPLE];
+            struct meas_scale scale;
+        } math_cache[SCOPE_NUM_MATH];
+        struct {
+            unsigned long seq;      /* capture.seq measured; 0: none */
+            unsigned long gen;      /* math_gen measured with */
+            unsigned long src;      /* filter_gen of the traces; 0: raw */
+            int a;                  /* traces measured */
+            int b;
+            int have_skew;          /* skew is valid */
+            int have_xdelay;        /* xdelay is valid */
+            struct meas_skew skew;
+            double xdelay;
+        } pair_cache;
         struct {
             double input_low;
             double input_high;
             double input_midpoint;
             double input_ptp;
             int input_low_range; /* derived from above */
+            int range_auto;      /* SCPI SENSe:VOLTage:RANGe:AUTO */
+            int clipped;         /* last capture reached a rail */
             double offset_low;
             double offset_high;
             int enable;
             int data[SCOPE_NUM_SAMPLE];
+            uint32_t acc[SCOPE_NUM_SAMPLE]; /* averaging, time order */
+            /* CALCulate:LIMit:UPPer and :LOWer, volts */
+            double mask_upper[SCOPE_NUM_SAMPLE];
+            double mask_lower[SCOPE_NUM_SAMPLE];
+            /* Mask as sample code bounds, indexed by input_low_range */
+            uint16_t mask_code_min[2][SCOPE_NUM_SAMPLE];
+            uint16_t mask_code_max[2][SCOPE_NUM_SAMPLE];
+            /* CALCulate:HISTogram sample counts, by code */
+            uint64_t hist[CODE10_SIZE];
+            int hist_low_range;     /* range hist[] is of */
+            double hist_step;       /* and its scale */
+            double hist_offset;
+            /* Sample code to voltage, indexed by input_low_range */
+            double volts[2][CODE10_SIZE];
         } channel[SCOPE_NUM_CHAN];
     } scope;
     struct {
@@ -619,6 +836,8 @@ static int cgr101_digitizer_v2d(double value,
     return cgr101_adc2c(midpoint, (int)round((value + offset) / step));
 }
 
+static void cgr101_digitizer_volts_update(struct info *info);
+
 static int cgr101_rcv_scope_offset(struct info *info, char c)
 {
     int err = 0;
@@ -645,6 +864,7 @@ static int cgr101_rcv_scope_offset(struct info *info, char c)
         value = cgr101_digitizer_d2v(data, MP8, STEP_LOW, 0.0);
         info->device->scope.channel[1].offset_low = value;
         info->device->scope.offset_state = STATE_SCOPE_OFFSET_COMPLETE;
+        cgr101_digitizer_volts_update(info);
         info->offset_status = 0;
         /* Done receiving. */
         cgr101_rcv_idle(info);
@@ -796,22 +1016,387 @@ static int cgr101_digitizer_voltage_to_data(struct info *info,
 }
 
 
-static double cgr101_digitizer_value(struct info *info,
-                                     int chan,
-                                     unsigned int idx)
+/*
+ * Mask Test
+ *
+ * The mask voltages are converted to sample code bounds for both
+ * input ranges whenever they or the offsets change, so testing a
+ * sweep is only integer compares of the codes as received. Codes
+ * decrease as voltage increases: the upper limit sets the smallest
+ * passing code, the lower limit the largest.
+ */
+
+static uint16_t cgr101_mask_code(struct info *info,
+                                 int chan,
+                                 int low_range,
+                                 double value)
+{
+    int data = cgr101_digitizer_voltage_to_data(info,
+                                                chan,
+                                                low_range,
+                                                MP10,
+                                                value);
+
+    if (data < 0) {
+        data = 0;
+    } else if (data > CODE10_MASK) {
+        data = CODE10_MASK;
+    }
+
+    return (uint16_t)data;
+}
+
+static void cgr101_mask_update(struct info *info)
 {
-    int data;
-    double value;
+    int chan;
     int range;
+    unsigned int j;
 
-    assert(idx < SCOPE_NUM_SAMPLE);
+    for (chan=0; chan<SCOPE_NUM_CHAN; chan++) {
+        for (range=0; range<2; range++) {
+            for (j=0; j<SCOPE_NUM_SAMPLE; j++) {
+                info->device->scope.channel[chan].mask_code_min[range][j] =
+                    cgr101_mask_code(
+                        info,
+                        chan,
+                        range,
+                        info->device->scope.channel[chan].mask_upper[j]);
+                info->device->scope.channel[chan].mask_code_max[range][j] =
+                    cgr101_mask_code(
+                        info,
+                        chan,
+                        range,
+                        info->device->scope.channel[chan].mask_lower[j]);
+            }
+        }
+    }
+}
 
-    range = info->device->scope.channel[chan].input_low_range;
-    data = info->device->scope.channel[chan].data[idx];
+static void cgr101_mask_stats_reset(struct info *info)
+{
+    info->device->scope.mask_fail = 0;
+    info->device->scope.mask_sweeps = 0;
+    info->device->scope.mask_failures = 0;
+    info->device->scope.mask_hits = 0;
+}
+
+/*
+ * Test a published capture against the mask, keeping statistics.
+ * The codes of an averaged capture are sums, so the bounds are
+ * scaled to match rather than the codes divided down.
+ */
+static int cgr101_mask_test(struct info *info, const struct capture *cap)
+{
+    const uint16_t *code;
+    const uint16_t *min;
+    const uint16_t *max;
+    unsigned int count = cap->count;
+    unsigned long hits = 0;
+    unsigned int j;
+    int range;
+    int chan;
+
+    for (chan=0; chan<SCOPE_NUM_CHAN; chan++) {
+        range = cap->channel[chan].low_range;
+        code = cap->channel[chan].code;
+        min = info->device->scope.channel[chan].mask_code_min[range];
+        max = info->device->scope.channel[chan].mask_code_max[range];
+        for (j=0; j<SCOPE_NUM_SAMPLE; j++) {
+            hits += (code[j] < min[j]*count) | (code[j] > max[j]*count);
+        }
+    }
 
-    value = cgr101_digitizer_data_to_voltage(info, chan, range, MP10, data);
+    info->device->scope.mask_fail = (hits != 0);
+    info->device->scope.mask_sweeps++;
+    info->device->scope.mask_failures += (hits != 0);
+    info->device->scope.mask_hits += hits;
 
-    return value;
+    return (hits != 0);
+}
+
+/* Rebuild the sample code to voltage tables after an offset change. */
+static void cgr101_digitizer_volts_update(struct info *info)
+{
+    int chan;
+    int range;
+    int code;
+    double *volts;
+
+    for (chan=0; chan<SCOPE_NUM_CHAN; chan++) {
+        for (range=0; range<2; range++) {
+            volts = info->device->scope.channel[chan].volts[range];
+            for (code=0; code<CODE10_SIZE; code++) {
+                volts[code] = cgr101_digitizer_data_to_voltage(info,
+                                                               chan,
+                                                               range,
+                                                               MP10,
+                                                               code);
+            }
+        }
+    }
+    cgr101_mask_update(info);
+}
+
+/*
+ * Convert a published capture to voltages with the step and offset it
+ * was taken with, so later offset changes leave it alone. An averaged
+ * capture keeps the resolution gained.
+ */
+static void cgr101_digitizer_gather(const struct capture *cap,
+                                    int chan,
+                                    double *dst)
+{
+    const uint16_t *code = cap->channel[chan].code;
+    double step = cap->channel[chan].step;
+    double offset = cap->channel[chan].offset;
+    int mid = MP10;
+    unsigned int j;
+
+    if (cap->count > 1) {
+        step /= cap->count;
+        mid *= (int)cap->count;
+    }
+    for (j=0; j<SCOPE_NUM_SAMPLE; j++) {
+        dst[j] = (mid - code[j])*step - offset;
+    }
+}
+
+/*
+ * 10 bit codes of a published capture. Those of an averaged capture
+ * are rounded into buf.
+ */
+static const uint16_t *cgr101_capture_codes(const struct capture *cap,
+                                            int chan,
+                                            uint16_t *buf)
+{
+    const uint16_t *code = cap->channel[chan].code;
+    unsigned int half = cap->count/2;
+    unsigned int j;
+
+    if (cap->count <= 1) {
+        return code;
+    }
+
+    for (j=0; j<SCOPE_NUM_SAMPLE; j++) {
+        buf[j] = (uint16_t)((code[j] + half) / cap->count);
+    }
+
+    return buf;
+}
+
+static void cgr101_measure_scale(const struct capture *cap,
+                                 int chan,
+                                 struct meas_scale *scale)
+{
+    scale->midpoint = MP10;
+    scale->step = cap->channel[chan].step;
+    scale->offset = cap->channel[chan].offset;
+}
+
+/*
+ * Math Channels
+ *
+ * Channels CGR101_MATH_CHAN on are computed from the sweep being read
+ * out when first asked for and kept until the next sweep, the filter
+ * or their definition changes, so any number of readouts and
+ * measurements of one capture compute each only once. Each is kept
+ * both in volts and as codes spanning its own range, which is how
+ * measurements and PACKed readout take it.
+ */
+
+static void cgr101_math_invalidate(struct info *info)
+{
+    info->device->scope.math_gen++;
+}
+
+/* The physical channels the math channels in chan_mask are made from. */
+static long cgr101_math_sources(struct info *info, long chan_mask)
+{
+    const struct mathchan_def *def;
+    long sources = 0;
+    int m;
+
+    for (m=0; m<SCOPE_NUM_MATH; m++) {
+        if (!(chan_mask & 1L<<(SCOPE_MATH_FIRST + m))) {
+            continue;
+        }
+        def = &info->device->scope.math[m];
+        sources |= 1L<<def->a;
+        if (def->func != MATHCHAN_INT && def->func != MATHCHAN_DER) {
+            sources |= 1L<<def->b;
+        }
+    }
+
+    return sources;
+}
+
+/* Nonzero if a math channel in chan_mask has no function. */
+static int cgr101_math_off(struct info *info, long chan_mask)
+{
+    int m;
+
+    for (m=0; m<SCOPE_NUM_MATH; m++) {
+        if ((chan_mask & 1L<<(SCOPE_MATH_FIRST + m)) &&
+            info->device->scope.math[m].func == MATHCHAN_OFF) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int cgr101_math_index(int chan)
+{
+    assert(chan >= SCOPE_MATH_FIRST && chan < SCOPE_TRACE_END);
+
+    return chan - SCOPE_MATH_FIRST;
+}
+
+static void cgr101_math_compute(struct info *info,
+                                const struct capture *cap,
+                                int m)
+{
+    const struct mathchan_def *def = &info->device->scope.math[m];
+    double a[SCOPE_NUM_SAMPLE];
+    double b[SCOPE_NUM_SAMPLE];
+
+    cgr101_digitizer_gather(cap, def->a, a);
+    cgr101_digitizer_gather(cap, def->b, b);
+    mathchan_eval(def,
+                  a,
+                  b,
+                  SCOPE_NUM_SAMPLE,
+                  cap->sweep_time / SCOPE_NUM_SAMPLE,
+                  info->device->scope.math_cache[m].volts);
+    mathchan_quantize(info->device->scope.math_cache[m].volts,
+                      SCOPE_NUM_SAMPLE,
+                      MP10,
+                      info->device->scope.math_cache[m].code,
+                      &info->device->scope.math_cache[m].scale);
+}
+
+/* The cache entry of math channel chan for cap, brought up to date. */
+static int cgr101_math_trace(struct info *info,
+                             const struct capture *cap,
+                             int chan)
+{
+    int m = cgr101_math_index(chan);
+    unsigned long src = 0;
+
+    assert(info->device->scope.math[m].func != MATHCHAN_OFF);
+    if (info->device->scope.filter_enable) {
+        src = info->device->scope.filter_gen;
+    }
+
+    if (info->device->scope.math_cache[m].seq != cap->seq ||
+        info->device->scope.math_cache[m].gen != info->device->scope.math_gen ||
+        info->device->scope.math_cache[m].src != src) {
+        cgr101_math_compute(info, cap, m);
+        info->device->scope.math_cache[m].seq = cap->seq;
+        info->device->scope.math_cache[m].gen = info->device->scope.math_gen;
+        info->device->scope.math_cache[m].src = src;
+    }
+
+    return m;
+}
+
+/* A channel's or math channel's sweep in volts; buf is for the former. */
+static const double *cgr101_trace_volts(struct info *info,
+                                        const struct capture *cap,
+                                        int chan,
+                                        double *buf)
+{
+    int m;
+
+    if (chan < SCOPE_NUM_CHAN) {
+        cgr101_digitizer_gather(cap, chan, buf);
+        return buf;
+    }
+
+    m = cgr101_math_trace(info, cap, chan);
+
+    return info->device->scope.math_cache[m].volts;
+}
+
+/* A channel's or math channel's sweep as 10 bit codes and their scale. */
+static const uint16_t *cgr101_trace_codes(struct info *info,
+                                          const struct capture *cap,
+                                          int chan,
+                                          uint16_t *buf,
+                                          struct meas_scale *scale)
+{
+    int m;
+
+    if (chan < SCOPE_NUM_CHAN) {
+        cgr101_measure_scale(cap, chan, scale);
+        return cgr101_capture_codes(cap, chan, buf);
+    }
+
+    m = cgr101_math_trace(info, cap, chan);
+    *scale = info->device->scope.math_cache[m].scale;
+
+    return info->device->scope.math_cache[m].code;
+}
+
+/*
+ * Amplitude Histogram
+ *
+ * Sample counts by raw code, so accumulating a sweep is an increment
+ * per sample. Counts taken on different input ranges or offsets
+ * don't mix; a change of either starts that channel's histogram over,
+ * and the counts are converted with the scale they were taken at.
+ */
+
+static void cgr101_hist_reset(struct info *info)
+{
+    int chan;
+
+    info->device->scope.hist_sweeps = 0;
+    for (chan=0; chan<SCOPE_NUM_CHAN; chan++) {
+        memset(info->device->scope.channel[chan].hist,
+               0,
+               sizeof(info->device->scope.channel[chan].hist));
+    }
+}
+
+static void cgr101_hist_add(struct info *info, const struct capture *cap)
+{
+    uint16_t buf[SCOPE_NUM_SAMPLE];
+    const uint16_t *code;
+    uint64_t *hist;
+    unsigned int j;
+    int chan;
+
+    for (chan=0; chan<SCOPE_NUM_CHAN; chan++) {
+        hist = info->device->scope.channel[chan].hist;
+        if (info->device->scope.hist_sweeps == 0 ||
+            cap->channel[chan].low_range !=
+            info->device->scope.channel[chan].hist_low_range ||
+            cap->channel[chan].offset !=
+            info->device->scope.channel[chan].hist_offset) {
+            memset(hist, 0, sizeof(info->device->scope.channel[chan].hist));
+            info->device->scope.channel[chan].hist_low_range =
+                cap->channel[chan].low_range;
+            info->device->scope.channel[chan].hist_step =
+                cap->channel[chan].step;
+            info->device->scope.channel[chan].hist_offset =
+                cap->channel[chan].offset;
+        }
+        code = cgr101_capture_codes(cap, chan, buf);
+        for (j=0; j<SCOPE_NUM_SAMPLE; j++) {
+            hist[code[j]]++;
+        }
+    }
+    info->device->scope.hist_sweeps++;
+}
+
+static void cgr101_hist_scale(struct info *info,
+                              int chan,
+                              struct meas_scale *scale)
+{
+    scale->midpoint = MP10;
+    scale->step = info->device->scope.channel[chan].hist_step;
+    scale->offset = info->device->scope.channel[chan].hist_offset;
 }
 
 static void cgr101_digitizer_update_control(struct info *info)
@@ -842,7 +1427,11 @@ static void cgr101_digitizer_update_control(struct info *info)
     assert(!err);
 }
 
-static void cgr101_digitizer_manual_trigger(struct info *info)
+/*
+ * 'settle' waits for the pre-trigger record to fill first; a sweep
+ * with none to fill can be triggered at once.
+ */
+static void cgr101_digitizer_manual_trigger(struct info *info, int settle)
 {
     int cur_ext_trig = info->device->scope.trigger_external;
     int err;
@@ -856,9 +1445,11 @@ static void cgr101_digitizer_manual_trigger(struct info *info)
     assert(info->device->scope.sample_rate_divisor >= 0);
     assert(info->device->scope.sample_rate_divisor <= SCOPE_SR_DIV_MAX);
     assert(COUNT_OF(cgr101_manual_trigger_delay_ms) == SCOPE_SR_DIV_MAX+1);
-    usleep(cgr101_manual_trigger_delay_ms[
-               info->device->scope.sample_rate_divisor
-               ]*1000);
+    if (settle) {
+        usleep(cgr101_manual_trigger_delay_ms[
+                   info->device->scope.sample_rate_divisor
+                   ]*1000);
+    }
 
     /* Manual Trigger; needs ext trigger */
     err = cgr101_device_send(info, "S D 5\n");
@@ -873,6 +1464,13 @@ static void cgr101_digitizer_manual_trigger(struct info *info)
     }
 }
 
+/* Sweeps are being taken for the server's own use. */
+static int cgr101_scope_internal(struct info *info)
+{
+    return (info->device->scope.cal_range >= 0 ||
+            info->device->scope.auto_step >= 0);
+}
+
 static int cgr101_digitizer_start(struct info *info, int manual)
 {
     int err = 1;
@@ -881,13 +1479,21 @@ static int cgr101_digitizer_start(struct info *info, int manual)
     int post_trigger = SCOPE_NUM_SAMPLE;
     int trigger_ref = (int)info->device->scope.trigger_ref;
     int trigger_offset = (int)info->device->scope.trigger_offset;
+    int cal = (info->device->scope.cal_range >= 0);
 
     do {
         /* Trigger Level - assume done */
 
         /* Post Trigger Sample Count */
-        post_trigger -= trigger_ref;
-        post_trigger -= trigger_offset;
+        if (cal) {
+            /* All but the first sample after the trigger; see
+             * cgr101_cal_sweep().
+             */
+            post_trigger = SCOPE_NUM_SAMPLE - 1;
+        } else {
+            post_trigger -= trigger_ref;
+            post_trigger -= trigger_offset;
+        }
 
         if (post_trigger < 0 || post_trigger >= SCOPE_NUM_SAMPLE) {
             /* Error: post_trigger out of bounds. */
@@ -913,11 +1519,17 @@ static int cgr101_digitizer_start(struct info *info, int manual)
         /* Manual Trigger handling */
         if (info->device->scope.trigger_source == SCOPE_TRIGGER_SOURCE_IMM ||
             manual) {
-            cgr101_digitizer_manual_trigger(info);
+            cgr101_digitizer_manual_trigger(info, !cal);
         }
 
-        info->overlapped = 1;
+        /* A continuous sweep never completes, so don't hold up *OPC
+         * or *WAI on it.
+         */
+        info->overlapped = (!info->device->scope.continuous ||
+                            cgr101_scope_internal(info));
         info->sweep_status = 1;
+        /* Any re-arm still queued is for the sweep this replaces. */
+        info->device->scope.rearm_pending = 0;
 
     } while (0);
 
@@ -957,1030 +1569,3276 @@ static int cgr101_rcv_scope_addr(struct info *info, char c)
     return err;
 }
 
-static void cgr101_digitizer_data_output(struct info *info, long chan_mask)
+/* Copy out the sweep just received in time order. */
+static void cgr101_digitizer_unrotate(struct info *info,
+                                      int chan,
+                                      uint16_t *code)
+{
+    const int *data = info->device->scope.channel[chan].data;
+    unsigned int first;
+    unsigned int n;
+    unsigned int j;
+
+    /* scope.addr is where the capture *ended*, so the start is just
+     * past that point. Split the ring at the wrap so each half is a
+     * straight copy.
+     */
+    first = info->device->scope.addr + 1;
+    if (first >= SCOPE_NUM_SAMPLE) {
+        first -= SCOPE_NUM_SAMPLE;
+    }
+    n = SCOPE_NUM_SAMPLE - first;
+
+    for (j=0; j<n; j++) {
+        code[j] = (uint16_t)(data[first + j] & CODE10_MASK);
+    }
+    for (j=0; j<first; j++) {
+        code[n + j] = (uint16_t)(data[j] & CODE10_MASK);
+    }
+}
+
+static void cgr101_digitizer_average_reset(struct info *info)
 {
     int chan;
+
+    info->device->scope.average_sweeps = 0;
+    for (chan=0; chan<SCOPE_NUM_CHAN; chan++) {
+        memset(info->device->scope.channel[chan].acc,
+               0,
+               sizeof(info->device->scope.channel[chan].acc));
+    }
+}
+
+/*
+ * Add the sweep just received to the averaging accumulators. Each
+ * sweep is unrotated first, so sample j is the same time relative to
+ * the trigger in every sweep. Returns nonzero once
+ * SENSe:AVERage:COUNt sweeps are in.
+ */
+static int cgr101_digitizer_accumulate(struct info *info)
+{
+    uint16_t code[SCOPE_NUM_SAMPLE];
+    uint32_t *acc;
     unsigned int j;
-    unsigned int idx;
-    double data;
+    int chan;
 
-    assert(info->device->scope.addr_state == STATE_SCOPE_ADDR_COMPLETE);
     for (chan=0; chan<SCOPE_NUM_CHAN; chan++) {
-        if (!(chan_mask & 1<<chan)) {
-            continue;
-        }
+        cgr101_digitizer_unrotate(info, chan, code);
+        acc = info->device->scope.channel[chan].acc;
         for (j=0; j<SCOPE_NUM_SAMPLE; j++) {
-            /* scope.addr is where the capture *ended*, so the start
-             * is just past that point.
-             */
-            idx = info->device->scope.addr + 1;
-            idx += j;
-            if (idx >= SCOPE_NUM_SAMPLE) {
-                /* wrapped */
-                idx -= SCOPE_NUM_SAMPLE;
-            }
-            data = cgr101_digitizer_value(info, chan, idx);
-            scpi_output_fp(info->output, data);
+            acc[j] += code[j];
         }
     }
-}
+    info->device->scope.average_sweeps++;
 
-static void cgr101_scope_data_output(struct info *info)
-{
-    assert(info->device->scope.output_pending);
-    cgr101_digitizer_data_output(info,info->device->scope.output_mask);
-    info->device->scope.output_pending = 0;
+    return (info->device->scope.average_sweeps >=
+            info->device->scope.average_count);
 }
 
-static void cgr101_rcv_scope_data_chan(struct info *info,
-                                       int chan,
-                                       int byte,
-                                       char c)
+/* Publish the sweep just received for clients to fetch. */
+static void cgr101_digitizer_publish(struct info *info)
 {
-    int idx = info->device->scope.data_count;
+    struct capture *cap = &info->device->scope.capture;
+    const uint32_t *acc;
+    uint16_t *code;
+    int averaged = (info->device->scope.average_sweeps != 0);
+    int failed = 0;
+    unsigned int j;
+    int chan;
 
-    assert(idx >= 0);
-    assert((size_t)idx < COUNT_OF(info->device->scope.channel[chan].data));
-    if (byte) {
-        info->device->scope.channel[chan].data[idx] =
-            (int)((unsigned char)c<<8);
+    if (averaged) {
+        cap->count = (unsigned int)info->device->scope.average_sweeps;
     } else {
-        info->device->scope.channel[chan].data[idx] +=
-            (int)(unsigned char)c;
+        /* Not averaging, or an aborted sweep straggling in. */
+        cap->count = 1;
     }
-}
+    assert(cap->count >= 1 && cap->count <= CAPTURE_MAX_COUNT);
 
-static void cgr101_scope_data_done(struct info *info,
-                                   enum cgr101_scope_data_state state)
-{
-    assert(info->device->scope.addr_state == STATE_SCOPE_ADDR_COMPLETE);
-    info->device->scope.data_state = state;
-    info->overlapped = 0;
-    info->sweep_status = 0;
-    event_send(info->event, EVENT_UNBLOCK);
+    for (chan=0; chan<SCOPE_NUM_CHAN; chan++) {
+        code = cap->channel[chan].code;
+        if (averaged) {
+            acc = info->device->scope.channel[chan].acc;
+            for (j=0; j<SCOPE_NUM_SAMPLE; j++) {
+                code[j] = (uint16_t)acc[j];
+            }
+        } else {
+            cgr101_digitizer_unrotate(info, chan, code);
+        }
+        cap->channel[chan].low_range =
+            info->device->scope.channel[chan].input_low_range;
+        cgr101_digitizer_step_offset(info,
+                                     chan,
+                                     cap->channel[chan].low_range,
+                                     &cap->channel[chan].step,
+                                     &cap->channel[chan].offset);
+    }
+    cap->sweep_time = info->device->scope.sweep_time;
+    cap->sample_rate_divisor = info->device->scope.sample_rate_divisor;
+    cap->trigger_source = (int)info->device->scope.trigger_source;
+    cap->trigger_chan = info->device->scope.trigger_external ?
+        1 : info->device->scope.internal_trigger_source;
+    cap->trigger_polarity = info->device->scope.trigger_polarity;
+    cap->trigger_level = info->device->scope.trigger_level;
+    cap->trigger_offset = info->device->scope.trigger_offset;
+    cap->trigger_ref = info->device->scope.trigger_ref;
+    gettimeofday(&cap->tv, NULL);
+    cap->seq++;
+    if (info->device->scope.mask_enable) {
+        failed = cgr101_mask_test(info, cap);
+        if (failed && info->device->scope.mask_stop) {
+            /* Leave the failure for the client to look at. */
+            info->device->scope.continuous = 0;
+        }
+    }
+    if (info->device->scope.hist_enable) {
+        cgr101_hist_add(info, cap);
+    }
+    if (failed ||
+        !info->device->scope.mask_enable ||
+        !info->device->scope.mask_keep_fail) {
+        history_add(info->device->scope.history, cap);
+    }
+    if (info->device->scope.export) {
+        export_add(info->device->scope.export, cap);
+    }
+    if (info->device->scope.binlog) {
+        /* A full queue drops the capture; SYST:INT:LOG? counts it. */
+        (void)binlog_add(info->device->scope.binlog, cap);
+    }
+    if (averaged) {
+        cgr101_digitizer_average_reset(info);
+    }
 }
 
-static int cgr101_rcv_scope_data(struct info *info, char c)
+static void cgr101_digitizer_data_output_ascii(struct info *info,
+                                               const struct capture *cap,
+                                               int start,
+                                               int count,
+                                               long chan_mask)
 {
-    int err = 0;
+    int chan;
+    int j;
+    double buf[SCOPE_NUM_SAMPLE];
+    const double *data;
 
-    switch (info->device->scope.data_state) {
-    case STATE_SCOPE_DATA_EXPECT_A_HIGH:
-        cgr101_rcv_scope_data_chan(info, 0, 1, c);
-        info->device->scope.data_state = STATE_SCOPE_DATA_EXPECT_A_LOW;
-        break;
-    case STATE_SCOPE_DATA_EXPECT_A_LOW:
-        cgr101_rcv_scope_data_chan(info, 0, 0, c);
-        info->device->scope.data_state = STATE_SCOPE_DATA_EXPECT_B_HIGH;
-        break;
-    case STATE_SCOPE_DATA_EXPECT_B_HIGH:
-        cgr101_rcv_scope_data_chan(info, 1, 1, c);
-        info->device->scope.data_state = STATE_SCOPE_DATA_EXPECT_B_LOW;
-        break;
-    case STATE_SCOPE_DATA_EXPECT_B_LOW:
-        cgr101_rcv_scope_data_chan(info, 1, 0, c);
-        info->device->scope.data_count++;
-        if (info->device->scope.data_count == SCOPE_NUM_SAMPLE) {
-            if (info->device->scope.output_pending) {
-                cgr101_scope_data_output(info);
-            }
-            cgr101_scope_data_done(info, STATE_SCOPE_DATA_COMPLETE);
-            /* Done receiving. */
-            cgr101_rcv_idle(info);
-        } else {
-            info->device->scope.data_state = STATE_SCOPE_DATA_EXPECT_A_HIGH;
+    for (chan=0; chan<SCOPE_TRACE_END; chan++) {
+        if (!(chan_mask & 1L<<chan)) {
+            continue;
+        }
+        data = cgr101_trace_volts(info, cap, chan, buf);
+        for (j=start; j<start+count; j++) {
+            scpi_output_fp(info->output, data[j]);
         }
-        break;
-    default:
-        assert(0);
-        break;
     }
-
-    return err;
 }
 
 /*
- * Device Error handler
+ * Packed Sample Format (FORMat PACKed)
+ *
+ * The response is a single IEEE 488.2 definite length block holding,
+ * for each requested channel in ascending order:
+ *
+ *   uint8_t  channel     one based channel number
+ *   uint8_t  low_range   1: low range, 0: high range or math channel
+ *   uint16_t midpoint    MP10
+ *   uint32_t points      SCOPE_NUM_SAMPLE, or the count of a slice
+ *   double   step        volts per code
+ *   double   offset      volts
+ *   uint8_t  code[]      points 10 bit codes, packed
+ *
+ * Multi-byte values are big endian (SCPI FORMat:BORDer NORMal) and the
+ * codes are packed MSB first, so four samples occupy five bytes; a
+ * slice of other than a multiple of four points is zero padded to a
+ * whole byte. The client recovers a voltage with
+ *
+ *   volts = ((midpoint - code) * step) - offset
  */
 
-static int cgr101_rcv_error_msg(struct info *info, char c)
-{
-    int err = 0;
+#define PACK_HDR_SIZE 24
+#define PACK_CODE_SIZE ((SCOPE_NUM_SAMPLE*10)/8)
+#define PACK_CHAN_SIZE (PACK_HDR_SIZE + PACK_CODE_SIZE)
 
-    if (c == '\n') {
-        /* Done receiving. */
-        info->device->error_msg[info->device->error_msg_len++] = 0;
-        scpi_error(info->error,
-                   SCPI_ERR_HARDWARE_ERROR,
-                   info->device->error_msg);
-        cgr101_rcv_idle(info);
-    } else if (c != '\r') {
-        info->device->error_msg[info->device->error_msg_len++] = c;
+static uint8_t *cgr101_pack_be(uint8_t *p, uint64_t value, size_t len)
+{
+    while (len--) {
+        *p++ = (uint8_t)(value >> (len*8));
     }
 
-    return err;
+    return p;
 }
 
-/*
- * Device Interrupt handler
- */
-
-static int cgr101_rcv_interrupt_msg(struct info *info, char c)
+static uint8_t *cgr101_pack_double(uint8_t *p, double value)
 {
-    int err = 0;
+    uint64_t u;
 
-    switch (c) {
-    case '\n':
-        /* Done receiving. */
-        if (info->device->event.chan_mask & INTERRUPT_CHANNEL_MASK) {
-            cgr101_digital_event(info, DIGITAL_EVENT_INTERRUPT);
-        }
-        cgr101_rcv_idle(info);
-    case '\r':
-    case '!':
-        break;
-    default:
-        assert(0);
-    }
+    assert(sizeof(u) == sizeof(value));
+    memcpy(&u, &value, sizeof(u));
 
-    return err;
+    return cgr101_pack_be(p, u, sizeof(u));
 }
 
-/*
- * Device Identify Handling
- */
-
-static int cgr101_identify_start(struct info *info)
+static uint8_t *cgr101_pack_codes(const uint16_t *code, int n, uint8_t *p)
 {
-    int err = cgr101_device_send(info, "i\n");
+    int j;
+    unsigned int bits = 0;
+    uint32_t acc = 0;
 
-    return err;
-}
+    for (j=0; j<n; j++) {
+        acc = (acc << 10) | code[j];
+        bits += 10;
+        while (bits >= 8) {
+            bits -= 8;
+            *p++ = (uint8_t)(acc >> bits);
+        }
+    }
+    if (bits) {
+        *p++ = (uint8_t)(acc << (8 - bits));
+    }
 
-static void cgr101_identify_done(struct info *info)
-{
-    event_send(info->event, EVENT_IDENTIFY_COMPLETE);
+    return p;
 }
 
-static int cgr101_rcv_ident(struct info *info, char c)
+static void cgr101_digitizer_data_output_packed(struct info *info,
+                                                const struct capture *cap,
+                                                int start,
+                                                int count,
+                                                long chan_mask)
 {
-    int err = 0;
+    uint8_t buf[SCOPE_NUM_TRACE * PACK_CHAN_SIZE];
+    uint8_t *p = buf;
+    uint16_t code[SCOPE_NUM_SAMPLE];
+    const uint16_t *c;
+    struct meas_scale scale;
+    int low_range;
+    int chan;
 
-    if (c == '\n') {
-        /* Done receiving. */
-        cgr101_identify_done(info);
-        cgr101_rcv_idle(info);
-    } else if (c != '\r') {
-        info->device->device_id[info->device->device_id_len++] = c;
+    for (chan=0; chan<SCOPE_TRACE_END; chan++) {
+        if (!(chan_mask & 1L<<chan)) {
+            continue;
+        }
+        c = cgr101_trace_codes(info, cap, chan, code, &scale);
+        low_range = (chan < SCOPE_NUM_CHAN) ? cap->channel[chan].low_range : 0;
+        p = cgr101_pack_be(p, (uint64_t)(chan + 1), 1);
+        p = cgr101_pack_be(p, (uint64_t)low_range, 1);
+        p = cgr101_pack_be(p, (uint64_t)scale.midpoint, 2);
+        p = cgr101_pack_be(p, (uint64_t)count, 4);
+        p = cgr101_pack_double(p, scale.step);
+        p = cgr101_pack_double(p, scale.offset);
+        p = cgr101_pack_codes(c + start, count, p);
     }
+    assert(p <= buf + sizeof(buf));
 
-    return err;
+    scpi_output_block(info->output, buf, (size_t)(p - buf));
 }
 
-int cgr101_identify(struct info *info)
+/*
+ * Real Format (FORMat REAL)
+ *
+ * A single IEEE 488.2 definite length block of big endian IEEE 754
+ * doubles (FORMat REAL,64), each requested channel's values in turn.
+ */
+
+static uint8_t *cgr101_pack_reals(uint8_t *p, const double *value, size_t n)
 {
-    info->device->identify_output_requested = 1;
-    event_send(info->event, EVENT_IDENTIFY_OUTPUT);
-    return 0;
+    size_t j;
+
+    for (j=0; j<n; j++) {
+        p = cgr101_pack_double(p, value[j]);
+    }
+
+    return p;
 }
 
-static void cgr101_identify_completion(void *arg)
+static void cgr101_digitizer_data_output_real(struct info *info,
+                                              const struct capture *cap,
+                                              int start,
+                                              int count,
+                                              long chan_mask)
 {
-    struct info *info = arg;
+    uint8_t buf[SCOPE_NUM_TRACE * SCOPE_NUM_SAMPLE * sizeof(double)];
+    uint8_t *p = buf;
+    double data[SCOPE_NUM_SAMPLE];
+    int chan;
 
-    assert(info->device->identify_state == STATE_IDENTIFY_PENDING);
-    info->device->identify_state = STATE_IDENTIFY_COMPLETE;
-    if (info->device->identify_output_requested) {
-        event_send(info->event, EVENT_IDENTIFY_OUTPUT);
+    for (chan=0; chan<SCOPE_TRACE_END; chan++) {
+        if (!(chan_mask & 1L<<chan)) {
+            continue;
+        }
+        p = cgr101_pack_reals(p,
+                              cgr101_trace_volts(info, cap, chan, data) + start,
+                              (size_t)count);
     }
+    assert(p <= buf + sizeof(buf));
+
+    scpi_output_block(info->output, buf, (size_t)(p - buf));
 }
 
-static void cgr101_identify_output(void *arg)
+/* Output samples start to start+count-1 of the capture. */
+static void cgr101_digitizer_capture_output(struct info *info,
+                                            const struct capture *cap,
+                                            int start,
+                                            int count,
+                                            long chan_mask)
 {
-    struct info *info = arg;
+    assert(start >= 0 && count > 0 && start + count <= SCOPE_NUM_SAMPLE);
 
-    switch (info->device->identify_state) {
-    case STATE_IDENTIFY_IDLE:
-    {
-        int err = cgr101_identify_start(info);
-        assert(!err);
-    }
+    switch (info->scpi->format) {
+    case SCPI_FORMAT_PACKED:
+        cgr101_digitizer_data_output_packed(info, cap, start, count,
+                                            chan_mask);
         break;
-    case STATE_IDENTIFY_PENDING:
-        /* Reschedule */
-        event_send(info->event, EVENT_IDENTIFY_OUTPUT);
-        break;
-    case STATE_IDENTIFY_COMPLETE:
-        scpi_output_printf(info->output,
-                           "GMP,CGR101-SCPI,1.0,%s",
-                           info->device->device_id);
-        event_send(info->event, EVENT_OUTPUT_FLUSH);
+    case SCPI_FORMAT_REAL:
+        cgr101_digitizer_data_output_real(info, cap, start, count,
+                                          chan_mask);
         break;
+    case SCPI_FORMAT_ASCII:
     default:
-        assert(0);
+        cgr101_digitizer_data_output_ascii(info, cap, start, count,
+                                           chan_mask);
         break;
     }
 }
 
 /*
- * Event Registration
+ * Waveform Preamble (WAVeform:PREamble?)
+ *
+ * Everything needed to scale a readout of the same capture on the
+ * client: points, x increment, x origin, then for each requested
+ * channel y increment, y origin and y reference. Sample j of the
+ * packed codes is at
+ *
+ *   time  = x_origin + j * x_increment        (0 at the trigger)
+ *   volts = (y_reference - code) * y_increment - y_origin
+ *
+ * which is the packed readout's own formula with its step, offset and
+ * midpoint.
  */
-
-static void cgr101_event_init(struct info *info)
+static void cgr101_waveform_preamble_output(struct info *info,
+                                            const struct capture *cap,
+                                            long chan_mask)
 {
-    int err;
-
-    err = event_add(info->event,
-                    EVENT_IDENTIFY_COMPLETE,
-                    cgr101_identify_completion,
-                    info);
-    assert(!err);
-
-    err = event_add(info->event,
-                    EVENT_IDENTIFY_OUTPUT,
-                    cgr101_identify_output,
-                    info);
-    assert(!err);
+    double interval = cap->sweep_time / SCOPE_NUM_SAMPLE;
+    uint16_t code[SCOPE_NUM_SAMPLE];
+    struct meas_scale scale;
+    int chan;
 
-    err = event_add(info->event,
-                    EVENT_DIGITAL_READ_COMPLETE,
-                    cgr101_digital_read_completion,
-                    info);
-    assert(!err);
+    scpi_output_int(info->output, SCOPE_NUM_SAMPLE);
+    scpi_output_fp(info->output, interval);
+    scpi_output_fp(info->output,
+                   -(cap->trigger_ref + cap->trigger_offset) * interval);
+    for (chan=0; chan<SCOPE_TRACE_END; chan++) {
+        if (!(chan_mask & 1L<<chan)) {
+            continue;
+        }
+        (void)cgr101_trace_codes(info, cap, chan, code, &scale);
+        scpi_output_fp(info->output, scale.step);
+        scpi_output_fp(info->output, scale.offset);
+        scpi_output_int(info->output, scale.midpoint);
+    }
+}
 
-    err = event_add(info->event,
-                    EVENT_DIGITAL_READ_OUTPUT,
-                    cgr101_digital_read_output,
-                    info);
-    assert(!err);
+/*
+ * Measurements
+ */
 
-    err = event_add(info->event,
-                    EVENT_SCOPE_STATUS_COMPLETE,
-                    cgr101_scope_status_completion,
-                    info);
-    assert(!err);
+static void cgr101_measure_voltage_output(struct info *info,
+                                          const struct capture *cap,
+                                          enum meas_volt func,
+                                          long chan_mask)
+{
+    struct meas_scale scale;
+    struct meas_amplitude m;
+    uint16_t code[SCOPE_NUM_SAMPLE];
+    int chan;
 
-    err = event_add(info->event,
-                    EVENT_SCOPE_STATUS_OUTPUT,
-                    cgr101_scope_status_output,
-                    info);
-    assert(!err);
+    for (chan=0; chan<SCOPE_TRACE_END; chan++) {
+        if (!(chan_mask & 1L<<chan)) {
+            continue;
+        }
+        meas_amplitude(cgr101_trace_codes(info, cap, chan, code, &scale),
+                       SCOPE_NUM_SAMPLE,
+                       &scale,
+                       &m);
+        scpi_output_fp(info->output, meas_amplitude_value(&m, func));
+    }
+}
 
-    err = event_add(info->event,
-                    EVENT_SCOPE_OFFSET_START,
-                    cgr101_scope_offset_start,
-                    info);
-    assert(!err);
+static void cgr101_measure_time_output(struct info *info,
+                                       const struct capture *cap,
+                                       enum meas_time func,
+                                       long chan_mask)
+{
+    struct meas_scale scale;
+    struct meas_timing m;
+    double dt = cap->sweep_time / SCOPE_NUM_SAMPLE;
+    uint16_t code[SCOPE_NUM_SAMPLE];
+    int chan;
 
+    for (chan=0; chan<SCOPE_TRACE_END; chan++) {
+        if (!(chan_mask & 1L<<chan)) {
+            continue;
+        }
+        meas_timing(cgr101_trace_codes(info, cap, chan, code, &scale),
+                    SCOPE_NUM_SAMPLE,
+                    &scale,
+                    dt,
+                    &m);
+        scpi_output_fp(info->output, meas_timing_value(&m, func));
+    }
 }
 
 /*
- * Recieve Output Channel Handling
+ * Pair Measurements
+ *
+ * Phase and delay of one trace relative to another. Both edge based
+ * results come from one pass and the cross correlation from another;
+ * each is kept for the capture it was computed from, so asking for
+ * the other, or again, costs nothing until the next sweep.
  */
 
-static int cgr101_rcv_sm(struct info *info, char c)
+static void cgr101_pair_xdelay(struct info *info,
+                               const struct capture *cap,
+                               int a,
+                               int b)
+{
+    double x[2][SCOPE_NUM_SAMPLE];
+    double r[2*SCOPE_NUM_SAMPLE - 1];
+    const double *v;
+    double mean;
+    double lag;
+    int chan[2];
+    int i;
+    unsigned int j;
+    int err;
+
+    chan[0] = a;
+    chan[1] = b;
+    for (i=0; i<2; i++) {
+        v = cgr101_trace_volts(info, cap, chan[i], x[i]);
+        mean = 0.0;
+        for (j=0; j<SCOPE_NUM_SAMPLE; j++) {
+            mean += v[j];
+        }
+        mean /= SCOPE_NUM_SAMPLE;
+        for (j=0; j<SCOPE_NUM_SAMPLE; j++) {
+            x[i][j] = v[j] - mean;
+        }
+    }
+
+    err = fft_xcorr(info->device->scope.fft,
+                    x[0],
+                    x[1],
+                    SCOPE_NUM_SAMPLE,
+                    r);
+    if (err) {
+        /* No FFT tables; the direct sum needs no memory. */
+        meas_xcorr(x[0], x[1], SCOPE_NUM_SAMPLE, r);
+    }
+    lag = meas_xcorr_lag(x[0], x[1], r, SCOPE_NUM_SAMPLE);
+    if (lag != MEAS_NAN) {
+        lag *= cap->sweep_time / SCOPE_NUM_SAMPLE;
+    }
+    info->device->scope.pair_cache.xdelay = lag;
+}
+
+static void cgr101_pair_output(struct info *info,
+                               const struct capture *cap,
+                               enum meas_pair func)
 {
-    int err = 1;
+    uint16_t code[2][SCOPE_NUM_SAMPLE];
+    struct meas_scale scale[2];
+    const uint16_t *ca;
+    const uint16_t *cb;
+    int a = info->device->scope.output_pair[0];
+    int b = info->device->scope.output_pair[1];
+    unsigned long src = 0;
+    double value = MEAS_NAN;
 
-    switch (info->device->rcv_state) {
-    case IDLE:
-        err = cgr101_rcv_start(info, c);
-        break;
-    case IDENTIFY:
-        err = cgr101_rcv_ident(info, c);
-        break;
-    case DIGITAL_READ:
-        err = cgr101_rcv_digital_read(info, c);
-        break;
-    case SCOPE_OFFSET:
-        err = cgr101_rcv_scope_offset(info, c);
-        break;
-    case SCOPE_STATUS:
-        err = cgr101_rcv_scope_status(info, c);
-        break;
-    case SCOPE_ADDR:
-        err = cgr101_rcv_scope_addr(info, c);
-        break;
-    case SCOPE_DATA:
-        err = cgr101_rcv_scope_data(info, c);
-        break;
-    case ERROR_MSG:
-        err = cgr101_rcv_error_msg(info, c);
+    if (info->device->scope.filter_enable) {
+        src = info->device->scope.filter_gen;
+    }
+    if (info->device->scope.pair_cache.seq != cap->seq ||
+        info->device->scope.pair_cache.gen != info->device->scope.math_gen ||
+        info->device->scope.pair_cache.src != src ||
+        info->device->scope.pair_cache.a != a ||
+        info->device->scope.pair_cache.b != b) {
+        info->device->scope.pair_cache.seq = cap->seq;
+        info->device->scope.pair_cache.gen = info->device->scope.math_gen;
+        info->device->scope.pair_cache.src = src;
+        info->device->scope.pair_cache.a = a;
+        info->device->scope.pair_cache.b = b;
+        info->device->scope.pair_cache.have_skew = 0;
+        info->device->scope.pair_cache.have_xdelay = 0;
+    }
+
+    switch (func) {
+    case MEAS_PAIR_PHASE:
+    case MEAS_PAIR_DELAY:
+        if (!info->device->scope.pair_cache.have_skew) {
+            ca = cgr101_trace_codes(info, cap, a, code[0], &scale[0]);
+            cb = cgr101_trace_codes(info, cap, b, code[1], &scale[1]);
+            meas_skew(ca,
+                      &scale[0],
+                      cb,
+                      &scale[1],
+                      SCOPE_NUM_SAMPLE,
+                      cap->sweep_time / SCOPE_NUM_SAMPLE,
+                      &info->device->scope.pair_cache.skew);
+            info->device->scope.pair_cache.have_skew = 1;
+        }
+        value = (func == MEAS_PAIR_PHASE) ?
+            info->device->scope.pair_cache.skew.phase :
+            info->device->scope.pair_cache.skew.delay;
         break;
-    case INTERRUPT_MSG:
-        err = cgr101_rcv_interrupt_msg(info, c);
+    case MEAS_PAIR_XDELAY:
+        if (!info->device->scope.pair_cache.have_xdelay) {
+            cgr101_pair_xdelay(info, cap, a, b);
+            info->device->scope.pair_cache.have_xdelay = 1;
+        }
+        value = info->device->scope.pair_cache.xdelay;
         break;
     default:
         assert(0);
+        break;
     }
 
-    assert(!err); /*FIXME: DEBUG*/
-    return err;
+    scpi_output_fp(info->output, value);
 }
 
-static int cgr101_rcv_data(struct info *info, const char *buf, size_t len)
-{
-    int err = 1;
-
-    while (len--) {
-        info->device->rcv_data_ptr = buf; /* For rcv debug */
-        err = cgr101_rcv_sm(info, *buf++);
-        if (err) {
-            assert(0); /*FIXME: DEBUG*/
+/*
+ * Decimated Data
+ *
+ * Each channel's sweep reduced to the requested number of points in
+ * a single pass over its codes. The codes of an averaged sweep are
+ * used as the sums they are, with the scale adjusted to match, so no
+ * resolution is lost; a math channel's are its own. Any binary
+ * FORMat gets a REAL block.
+ */
+static void cgr101_digitizer_decimate_output(struct info *info,
+                                             const struct capture *cap,
+                                             enum meas_decimate mode,
+                                             int points,
+                                             long chan_mask)
+{
+    uint8_t buf[SCOPE_NUM_TRACE * 2 * SCOPE_NUM_SAMPLE * sizeof(double)];
+    uint8_t *p = buf;
+    double data[2 * SCOPE_NUM_SAMPLE];
+    uint16_t math[SCOPE_NUM_SAMPLE];
+    const uint16_t *code;
+    struct meas_scale scale;
+    int binary = (info->scpi->format != SCPI_FORMAT_ASCII);
+    size_t n;
+    size_t j;
+    int chan;
 
-            break;
+    assert(points > 0 && points <= SCOPE_NUM_SAMPLE);
+    for (chan=0; chan<SCOPE_TRACE_END; chan++) {
+        if (!(chan_mask & 1L<<chan)) {
+            continue;
         }
-    }
-
-    return err;
-}
-
-static int cgr101_out(void *arg)
-{
-    struct info *info = arg;
-    int err = 0;
-    ssize_t len;
-
-    len = read(info->device->child.stdout, info->device->rcv_data, RCV_MAX);
-
-    if (len < 0) {
-        if (errno != EINTR && errno != EAGAIN) {
-            assert(0); /*FIXME: DEBUG*/
-            err = 1;
+        if (chan < SCOPE_NUM_CHAN) {
+            cgr101_measure_scale(cap, chan, &scale);
+            scale.midpoint *= (int)cap->count;
+            scale.step /= cap->count;
+            code = cap->channel[chan].code;
+        } else {
+            code = cgr101_trace_codes(info, cap, chan, math, &scale);
+        }
+        n = meas_decimate(code,
+                          SCOPE_NUM_SAMPLE,
+                          (size_t)points,
+                          mode,
+                          &scale,
+                          data);
+        if (binary) {
+            p = cgr101_pack_reals(p, data, n);
+        } else {
+            for (j=0; j<n; j++) {
+                scpi_output_fp(info->output, data[j]);
+            }
         }
-    } else if (len != 0 && info->device->sent) {
-        /* Only receive data once a command has been sent to flush any
-         pending stale data. */
-        info->device->rcv_data_len = (size_t)len;
-        err = cgr101_rcv_data(info,
-                              info->device->rcv_data,
-                              info->device->rcv_data_len);
     }
+    assert(p <= buf + sizeof(buf));
 
-    return err;
+    if (binary) {
+        scpi_output_block(info->output, buf, (size_t)(p - buf));
+    }
 }
 
 /*
- * Recieve Error Channel Handling
+ * Spectrum
  */
 
-static int cgr101_err(void *arg)
-{
-    struct info *info = arg;
-    int err = 0;
-    ssize_t len;
-
-    len = read(
-        info->device->child.stderr,
-        info->device->err_data,
-        sizeof(info->device->err_data));
-
-    assert(len > 0);
-    assert(len <= (ssize_t)sizeof(info->device->err_data));
-
-    return err;
-}
+#define SPECTRUM_NUM_BIN (SCOPE_NUM_SAMPLE/2 + 1)
 
 /*
- * Waveform programming
+ * RMS magnitude in dBV per bin, DC through Nyquist. Any binary
+ * FORMat gets a REAL block as there are no device codes to pack.
  */
+static void cgr101_spectrum_output(struct info *info,
+                                   const struct capture *cap,
+                                   enum fft_window window,
+                                   long chan_mask)
+{
+    uint8_t buf[SCOPE_NUM_TRACE * SPECTRUM_NUM_BIN * sizeof(double)];
+    uint8_t *p = buf;
+    double data[SCOPE_NUM_SAMPLE];
+    double dbv[SPECTRUM_NUM_BIN];
+    int binary = (info->scpi->format != SCPI_FORMAT_ASCII);
+    int chan;
+    unsigned int j;
+    int err;
 
-static void cgr101_waveform_lookup(const char *value,
-                                   enum cgr101_waveform_shape *shape)
-{
-    struct cgr101_waveform_map_s *p;
-
-    assert(value);
-    assert(shape);
-    for (p = cgr101_waveform_map; p != NULL; p++) {
-        if (!strcasecmp(value, p->name)) {
-            *shape = p->shape;
-            break;
+    assert(fft_bins(SCOPE_NUM_SAMPLE) == SPECTRUM_NUM_BIN);
+    for (chan=0; chan<SCOPE_TRACE_END; chan++) {
+        if (!(chan_mask & 1L<<chan)) {
+            continue;
         }
-    }
-    assert(p != NULL);
-}
-
-static const char *cgr101_waveform_name(enum cgr101_waveform_shape shape)
-{
-    struct cgr101_waveform_map_s *p;
-    const char *name = NULL;
-
-    for (p = cgr101_waveform_map; p != NULL; p++) {
-        if (shape == p->shape) {
-            name = p->name;
-            break;
+        err = fft_spectrum(info->device->scope.fft,
+                           cgr101_trace_volts(info, cap, chan, data),
+                           SCOPE_NUM_SAMPLE,
+                           window,
+                           dbv);
+        if (err) {
+            scpi_error(info->error, SCPI_ERR_OUT_OF_MEMORY, NULL);
+            return;
+        }
+        if (binary) {
+            p = cgr101_pack_reals(p, dbv, SPECTRUM_NUM_BIN);
+        } else {
+            for (j=0; j<SPECTRUM_NUM_BIN; j++) {
+                scpi_output_fp(info->output, dbv[j]);
+            }
         }
     }
-    assert(name != NULL);
+    assert(p <= buf + sizeof(buf));
 
-    return name;
+    if (binary) {
+        scpi_output_block(info->output, buf, (size_t)(p - buf));
+    }
 }
 
 /*
- * Waveform functions:
- *  phase: 0.0 .. 1.0
- *  amplitude: -1.0 .. 1.0
+ * Filter
+ *
+ * Coefficients depend only on the filter settings and the sample
+ * interval, so they are designed once per sample rate divisor and
+ * kept until the settings change. The filtered sweep is computed
+ * once per capture and stored as a capture of CAPTURE_MAX_COUNT
+ * sums, which keeps the resolution the filter gains and lets every
+ * consumer of a capture use it unchanged.
  */
 
-static double cgr101_fn_sin(double phase, void *arg)
+static const struct filter_coef *cgr101_filter_coef(struct info *info,
+                                                    const struct capture *cap)
 {
-    double angle = 2.0 * M_PI * phase;
-    (void)arg;
-    return ((double)sin(angle));
-}
+    int div = cap->sample_rate_divisor;
 
+    assert(div >= 0 && div <= SCOPE_SR_DIV_MAX);
+    if (info->device->scope.filter_cache[div].gen !=
+        info->device->scope.filter_gen) {
+        filter_design(&info->device->scope.filter,
+                      cap->sweep_time / SCOPE_NUM_SAMPLE,
+                      &info->device->scope.filter_cache[div].coef);
+        info->device->scope.filter_cache[div].gen =
+            info->device->scope.filter_gen;
+    }
 
-static double cgr101_fn_squ(double phase, void *arg)
-{
-    (void)arg;
-    return (double)((phase < 0.5) ? 1.0 : -1.0);
+    return &info->device->scope.filter_cache[div].coef;
 }
 
-static double cgr101_fn_tri(double phase, void *arg)
+static void cgr101_filter_invalidate(struct info *info)
 {
-    (void)arg;
-    phase *= 4.0;
-    return (phase < 2.0) ? (phase - 1.0) : (3.0 - phase);
+    info->device->scope.filter_gen++;
+    info->device->scope.filtered_seq = 0;
 }
 
-static double cgr101_fn_const(double phase, void *arg)
+static void cgr101_filter_capture(struct info *info,
+                                  const struct capture *cap,
+                                  struct capture *dst)
 {
-    double value = *(double *)arg;
-    (void)phase;
-    return (double)value;
+    const struct filter_coef *coef = cgr101_filter_coef(info, cap);
+    double in[SCOPE_NUM_SAMPLE];
+    double out[SCOPE_NUM_SAMPLE];
+    double scale;
+    double max = (double)(CODE10_MASK * CAPTURE_MAX_COUNT);
+    double v;
+    int chan;
+    unsigned int j;
+
+    *dst = *cap;
+    dst->count = CAPTURE_MAX_COUNT;
+    for (chan=0; chan<SCOPE_NUM_CHAN; chan++) {
+        cgr101_digitizer_gather(cap, chan, in);
+        filter_apply(coef, in, SCOPE_NUM_SAMPLE, out);
+        /* Inverse of cgr101_digitizer_gather() */
+        scale = CAPTURE_MAX_COUNT / cap->channel[chan].step;
+        for (j=0; j<SCOPE_NUM_SAMPLE; j++) {
+            v = MP10*CAPTURE_MAX_COUNT -
+                (out[j] + cap->channel[chan].offset) * scale;
+            if (v < 0.0) {
+                v = 0.0;
+            } else if (v > max) {
+                v = max;
+            }
+            dst->channel[chan].code[j] = (uint16_t)lround(v);
+        }
+    }
 }
 
-/*
- * Interpolate a set of points. 'phase' ranges from 0.0 to (almost) 1.0.
- */
-static double cgr101_fn_interp(double phase, void *arg)
+/* The last completed sweep as measurements and readout should see it. */
+static const struct capture *cgr101_scope_capture(struct info *info)
 {
-    struct cgr101_w_interp *interp = (struct cgr101_w_interp  *)arg;
-    double value = 0.0;
-    double in_phase;
-    double start_phase;
-    double end_phase;
-    double interp_phase;
-    double delta;
-    double v1;
-    double v2;
-    size_t start_idx;
-    size_t end_idx;
-    size_t segments;
+    const struct capture *cap = &info->device->scope.capture;
 
-    assert(interp);
-    assert(interp->data);
-    assert(interp->len > 1);
-    assert(interp->len <= WAVEFORM_USER_MAX);
-    /* Number of line segments to use. */
-    segments = interp->len - 1;
-    in_phase = phase * (double)segments;
-    /* Indexes for starting and ending interpolation points */
-    start_phase = floor(in_phase);
-    end_phase = start_phase + 1.0;
-    start_idx = (size_t)start_phase;
-    end_idx = (size_t)end_phase;
-    assert(start_idx < segments);
-    assert(end_idx < interp->len);
-    assert(end_idx > start_idx);
-    interp_phase = in_phase - start_phase;
-    assert(interp_phase >= 0);
-    assert(interp_phase < 1.0);
+    if (!info->device->scope.filter_enable || cap->seq == 0) {
+        return cap;
+    }
 
-    /* Get the endpoints of the interpolation segment. */
-    v1 = interp->data[start_idx];
-    v2 = interp->data[end_idx];
-    /* Calculate the interpolated value. */
-    delta = v2 - v1;
-    value = v1 + delta*interp_phase;
+    if (info->device->scope.filtered_seq != cap->seq ||
+        info->device->scope.filtered_gen != info->device->scope.filter_gen) {
+        cgr101_filter_capture(info, cap, &info->device->scope.filtered);
+        info->device->scope.filtered_seq = cap->seq;
+        info->device->scope.filtered_gen = info->device->scope.filter_gen;
+    }
 
-    return value;
+    return &info->device->scope.filtered;
 }
 
-typedef double (*wff_t)(double phase, void *arg);
-
-static void cgr101_waveform_create_fn(double *data,
-                                      size_t points,
-                                      wff_t wfn,
-                                      void *arg)
+/* Output whatever was asked of the last completed sweep. */
+static void cgr101_scope_output(struct info *info)
 {
-    size_t i;
-    double phase = 0.0;
-    double phase_incr = 1.0/((double)points);
-    for (i=0; i<points; i++) {
-        data[i] = (double)wfn(phase, arg);
-        phase += phase_incr;
+    const struct capture *cap = cgr101_scope_capture(info);
+    long chan_mask = info->device->scope.output_mask;
+    int func = info->device->scope.output_func;
+
+    if (cap->seq == 0) {
+        /* Nothing captured yet. */
+        scpi_error(info->error, SCPI_ERR_DATA_STALE, NULL);
+        return;
     }
-}
 
-static void cgr101_waveform_create(struct info *info,
-                                   enum cgr101_waveform_shape shape)
-{
-    switch (shape) {
-    case WAV_RAND:
-        /* Handled by device programming. */
+    switch (info->device->scope.output_kind) {
+    case SCOPE_OUTPUT_DATA:
+        cgr101_digitizer_capture_output(info,
+                                        cap,
+                                        info->device->scope.output_start,
+                                        info->device->scope.output_count,
+                                        chan_mask);
         break;
-    case WAV_SIN:
-        cgr101_waveform_create_fn(info->device->waveform.user,
-                                  COUNT_OF(info->device->waveform.user),
-                                  cgr101_fn_sin,
-                                  NULL);
+    case SCOPE_OUTPUT_DECIMATE:
+        cgr101_digitizer_decimate_output(info,
+                                         cap,
+                                         (enum meas_decimate)func,
+                                         info->device->scope.output_points,
+                                         chan_mask);
         break;
-    case WAV_SQU:
-        cgr101_waveform_create_fn(info->device->waveform.user,
-                                  COUNT_OF(info->device->waveform.user),
-                                  cgr101_fn_squ,
-                                  NULL);
+    case SCOPE_OUTPUT_MEAS_VOLT:
+        cgr101_measure_voltage_output(info, cap, (enum meas_volt)func,
+                                      chan_mask);
         break;
-    case WAV_TRI:
-        cgr101_waveform_create_fn(info->device->waveform.user,
-                                  COUNT_OF(info->device->waveform.user),
-                                  cgr101_fn_tri,
-                                  NULL);
+    case SCOPE_OUTPUT_MEAS_TIME:
+        cgr101_measure_time_output(info, cap, (enum meas_time)func,
+                                   chan_mask);
         break;
-    case WAV_NONE:
-        /* Nothing to do. */
+    case SCOPE_OUTPUT_SPECTRUM:
+        cgr101_spectrum_output(info, cap, (enum fft_window)func, chan_mask);
+        break;
+    case SCOPE_OUTPUT_PREAMBLE:
+        cgr101_waveform_preamble_output(info, cap, chan_mask);
+        break;
+    case SCOPE_OUTPUT_PAIR:
+        cgr101_pair_output(info, cap, (enum meas_pair)func);
         break;
     default:
         assert(0);
         break;
     }
+}
 
-    /* FIXME: only set if no error. */
-    info->device->waveform.shape = shape;
+static void cgr101_scope_data_output(struct info *info)
+{
+    assert(info->device->scope.output_pending);
+    cgr101_scope_output(info);
+    info->device->scope.output_pending = 0;
+}
+
+static void cgr101_rcv_scope_data_chan(struct info *info,
+                                       int chan,
+                                       int byte,
+                                       char c)
+{
+    int idx = info->device->scope.data_count;
+
+    assert(idx >= 0);
+    assert((size_t)idx < COUNT_OF(info->device->scope.channel[chan].data));
+    if (byte) {
+        info->device->scope.channel[chan].data[idx] =
+            (int)((unsigned char)c<<8);
+    } else {
+        info->device->scope.channel[chan].data[idx] +=
+            (int)(unsigned char)c;
+    }
+}
 
+/* Start the next sweep of this one once the event loop comes round. */
+static void cgr101_scope_rearm_send(struct info *info)
+{
+    info->device->scope.rearm_pending = 1;
+    event_send(info->event, EVENT_SCOPE_REARM);
 }
 
-static int cgr101_waveform_conv(double value)
+static void cgr101_scope_data_done(struct info *info,
+                                   enum cgr101_scope_data_state state)
 {
-    return (255 - (int)ceil((value * 127.5) + 127.0));
+    assert(info->device->scope.addr_state == STATE_SCOPE_ADDR_COMPLETE);
+    info->device->scope.data_state = state;
+    info->overlapped = 0;
+    if (info->device->scope.continuous &&
+        state == STATE_SCOPE_DATA_COMPLETE) {
+        /* Still sweeping; start the next one right away. */
+        cgr101_scope_rearm_send(info);
+    } else {
+        info->sweep_status = 0;
+    }
+    event_send(info->event, EVENT_UNBLOCK);
 }
 
-static void cgr101_waveform_program(struct info *info)
+/*
+ * Input Offset Calibration
+ *
+ * CALibration:ZERO runs cal_count free running sweeps on each range
+ * with the inputs as they are (grounded, for a meaningful result) and
+ * takes each channel's offset as its mean reading with no offset
+ * applied. The sums are of raw codes; nothing is published.
+ *
+ * A grounded input gives the internal trigger nothing to fire on, so
+ * each sweep is triggered as soon as it is armed. Every sample but
+ * the first is then taken after the trigger, so there is no
+ * pre-trigger record to wait for; the first is left out of the mean.
+ */
+
+static void cgr101_digitizer_set_midpoint_ptp(struct info *info, int chan);
+static void cgr101_digitizer_set_range(struct info *info, int chan);
+
+static void cgr101_cal_range(struct info *info, int low_range)
 {
+    int chan;
     int err;
-    size_t i;
-    double f;
-    int val;
 
-    if (info->device->waveform.shape == WAV_RAND) {
-        err = cgr101_device_printf(info, "W N\n");
+    for (chan=0; chan<SCOPE_NUM_CHAN; chan++) {
+        err = cgr101_device_printf(info, "S P %c\n",
+                                   cgr101_range_cmd[chan][low_range]);
         assert(!err);
+        info->device->scope.cal_sum[chan] = 0;
+    }
+    info->device->scope.cal_range = low_range;
+    info->device->scope.cal_sweeps = 0;
+}
+
+/* Back to the ranges the inputs are set for. */
+static void cgr101_cal_end(struct info *info)
+{
+    int chan;
+
+    info->device->scope.cal_range = -1;
+    info->cal_status = 0;
+    for (chan=0; chan<SCOPE_NUM_CHAN; chan++) {
+        cgr101_digitizer_set_range(info, chan);
+    }
+}
+
+/*
+ * Add the sweep just received; returns nonzero once the offsets for
+ * both ranges are in and applied.
+ */
+static int cgr101_cal_sweep(struct info *info)
+{
+    uint16_t code[SCOPE_NUM_SAMPLE];
+    int range = info->device->scope.cal_range;
+    double step = range ? STEP_LOW : STEP_HIGH;
+    double n;
+    double mean;
+    unsigned int j;
+    int chan;
+
+    for (chan=0; chan<SCOPE_NUM_CHAN; chan++) {
+        cgr101_digitizer_unrotate(info, chan, code);
+        for (j=1; j<SCOPE_NUM_SAMPLE; j++) {
+            info->device->scope.cal_sum[chan] += code[j];
+        }
+    }
+    info->device->scope.cal_sweeps++;
+    if (info->device->scope.cal_sweeps < info->device->scope.cal_count) {
+        return 0;
+    }
+
+    n = (double)info->device->scope.cal_count * (SCOPE_NUM_SAMPLE - 1);
+    for (chan=0; chan<SCOPE_NUM_CHAN; chan++) {
+        mean = (double)info->device->scope.cal_sum[chan] / n;
+        info->device->scope.cal_offset[chan][range] = (MP10 - mean) * step;
+    }
+
+    if (range == 0) {
+        /* High range done; now the low. */
+        cgr101_cal_range(info, 1);
+        return 0;
+    }
+
+    cgr101_digitizer_input_offset(info,
+                                  info->device->scope.cal_offset[0][1],
+                                  info->device->scope.cal_offset[0][0],
+                                  info->device->scope.cal_offset[1][1],
+                                  info->device->scope.cal_offset[1][0]);
+    if (info->device->scope.cal_store) {
+        cgr101_digitizer_input_offset_store(info);
+    }
+    cgr101_cal_end(info);
+
+    return 1;
+}
+
+/*
+ * Autoscale
+ *
+ * AUToscale takes free running sweeps to pick each channel's range
+ * and the sweep time. The first sweep is on the high range at the
+ * sweep time as set; a channel whose swing fits the low range with
+ * margin moves to it, and goes back should it later clip there. The
+ * sweep time is then found by bisection over sample_rate_divisor,
+ * counting periods of the channel with the widest swing, so at most
+ * five more sweeps are needed. With no signal anywhere the sweep time
+ * is left as it was.
+ */
+
+/* Set a channel up for the whole of one range or the other. */
+static void cgr101_digitizer_full_range(struct info *info,
+                                        int chan,
+                                        int low_range)
+{
+    double limit = low_range ? 2.5 : SCOPE_DEFAULT_HIGH;
+
+    info->device->scope.channel[chan].input_low = -limit;
+    info->device->scope.channel[chan].input_high = limit;
+    cgr101_digitizer_set_midpoint_ptp(info, chan);
+    cgr101_digitizer_set_range(info, chan);
+}
+
+static void cgr101_auto_range(struct info *info, int chan, int low_range)
+{
+    int err;
+
+    err = cgr101_device_printf(info, "S P %c\n",
+                               cgr101_range_cmd[chan][low_range]);
+    assert(!err);
+    info->device->scope.auto_low_range[chan] = low_range;
+}
+
+/* Apply the result, or with abandon just put things back. */
+static void cgr101_auto_end(struct info *info, int abandon)
+{
+    int chan;
+
+    info->device->scope.auto_step = -1;
+    info->range_status = 0;
+    if (abandon) {
+        info->device->scope.sample_rate_divisor =
+            info->device->scope.auto_divisor;
     } else {
-        for (i=0; i<COUNT_OF(info->device->waveform.user); i++) {
-            f = info->device->waveform.user[i];
-            val = cgr101_waveform_conv(f);
-            assert(val >= 0);
-            assert(val <= 255);
-            err = cgr101_device_printf(info, "W S %zu %d\n", i, val);
-            assert(!err);
+        info->device->scope.sweep_time = SCOPE_MIN_SWEEP_TIME *
+            (double)(1 << info->device->scope.sample_rate_divisor);
+    }
+    for (chan=0; chan<SCOPE_NUM_CHAN; chan++) {
+        if (abandon) {
+            cgr101_digitizer_set_range(info, chan);
+        } else {
+            cgr101_digitizer_full_range(
+                info, chan, info->device->scope.auto_low_range[chan]);
         }
-        err = cgr101_device_printf(info, "W P\n");
+    }
+}
+
+/*
+ * Periods seen in a sweep: rising crossings of the middle of the
+ * swing, with an eighth of the swing as hysteresis.
+ */
+static int cgr101_auto_cycles(const uint16_t *code, int min, int max)
+{
+    /* Codes fall as the voltage rises. */
+    int mid = (min + max) / 2;
+    int hyst = (max - min) / 8;
+    int armed = 0;
+    int cycles = 0;
+    unsigned int j;
+
+    for (j=0; j<SCOPE_NUM_SAMPLE; j++) {
+        if (code[j] > mid + hyst) {
+            armed = 1;
+        } else if (armed && code[j] < mid - hyst) {
+            armed = 0;
+            cycles++;
+        }
+    }
+
+    return cycles;
+}
+
+/* Look at the sweep just received; returns nonzero once done. */
+static int cgr101_auto_sweep(struct info *info)
+{
+    uint16_t code[SCOPE_NUM_CHAN][SCOPE_NUM_SAMPLE];
+    int min[SCOPE_NUM_CHAN];
+    int max[SCOPE_NUM_CHAN];
+    int widest = -1;
+    int ptp = SCOPE_AUTO_MIN_PTP - 1;
+    int div = info->device->scope.sample_rate_divisor;
+    int low_range;
+    int cycles;
+    double *volts;
+    unsigned int j;
+    int chan;
+
+    for (chan=0; chan<SCOPE_NUM_CHAN; chan++) {
+        cgr101_digitizer_unrotate(info, chan, code[chan]);
+        min[chan] = CODE10_MASK;
+        max[chan] = 0;
+        for (j=0; j<SCOPE_NUM_SAMPLE; j++) {
+            if (code[chan][j] < min[chan]) {
+                min[chan] = code[chan][j];
+            }
+            if (code[chan][j] > max[chan]) {
+                max[chan] = code[chan][j];
+            }
+        }
+        low_range = info->device->scope.auto_low_range[chan];
+        if (info->device->scope.auto_step == 0) {
+            volts = info->device->scope.channel[chan].volts[0];
+            if (fabs(volts[min[chan]]) <= SCOPE_AUTO_LOW_LIMIT &&
+                fabs(volts[max[chan]]) <= SCOPE_AUTO_LOW_LIMIT) {
+                cgr101_auto_range(info, chan, 1);
+            }
+        } else if (low_range &&
+                   (min[chan] == 0 || max[chan] == CODE10_MASK)) {
+            /* Clipped: the first sweep didn't see all of it. */
+            cgr101_auto_range(info, chan, 0);
+        }
+        if (max[chan] - min[chan] > ptp) {
+            ptp = max[chan] - min[chan];
+            widest = chan;
+        }
+    }
+
+    if (info->device->scope.auto_step == 0) {
+        /* Ranges picked; sweeps on them from here on. */
+        info->device->scope.auto_step = 1;
+        info->device->scope.sample_rate_divisor =
+            (info->device->scope.auto_lo + info->device->scope.auto_hi) / 2;
+        return 0;
+    }
+
+    if (widest < 0) {
+        /* Nothing to time; keep the sweep time as it was. */
+        info->device->scope.sample_rate_divisor =
+            info->device->scope.auto_divisor;
+        cgr101_auto_end(info, 0);
+        return 1;
+    }
+
+    cycles = cgr101_auto_cycles(code[widest], min[widest], max[widest]);
+    if (cycles < SCOPE_AUTO_MIN_CYCLES) {
+        info->device->scope.auto_lo = div + 1;
+    } else if (cycles > SCOPE_AUTO_MAX_CYCLES) {
+        info->device->scope.auto_hi = div - 1;
+    } else {
+        cgr101_auto_end(info, 0);
+        return 1;
+    }
+
+    if (info->device->scope.auto_lo > info->device->scope.auto_hi) {
+        /* No divisor in the window; the next faster one shows more. */
+        div = info->device->scope.auto_lo;
+        info->device->scope.sample_rate_divisor =
+            div > SCOPE_SR_DIV_MAX ? SCOPE_SR_DIV_MAX : div;
+        cgr101_auto_end(info, 0);
+        return 1;
+    }
+
+    info->device->scope.sample_rate_divisor =
+        (info->device->scope.auto_lo + info->device->scope.auto_hi) / 2;
+
+    return 0;
+}
+
+/*
+ * Range Tracking
+ *
+ * Every published capture is checked for samples at either rail of
+ * the 10 bit range; any sets QUEStionable VOLTage. A channel with
+ * RANGe:AUTO on then moves from the low range to the high, and from
+ * the high to the low once its peak reading is under FRACtion of the
+ * high range's 25 V. FRACtion is kept below 2.5/25 so there is a gap
+ * between the two thresholds and the range doesn't flap. The capture
+ * has already been tagged with the range it was taken on; the change
+ * applies from the next sweep. Only the range moves: LOWer and UPPer
+ * stay as the client set them.
+ */
+
+static void cgr101_range_switch(struct info *info, int chan, int low_range)
+{
+    int err;
+
+    info->device->scope.channel[chan].input_low_range = low_range;
+    err = cgr101_device_printf(info, "S P %c\n",
+                               cgr101_range_cmd[chan][low_range]);
+    assert(!err);
+}
+
+static void cgr101_range_track(struct info *info, const struct capture *cap)
+{
+    uint16_t buf[SCOPE_NUM_SAMPLE];
+    const uint16_t *code;
+    const double *volts;
+    double peak;
+    int clip_status = 0;
+    int low_range;
+    int min;
+    int max;
+    unsigned int j;
+    int chan;
+
+    for (chan=0; chan<SCOPE_NUM_CHAN; chan++) {
+        code = cgr101_capture_codes(cap, chan, buf);
+        min = CODE10_MASK;
+        max = 0;
+        for (j=0; j<SCOPE_NUM_SAMPLE; j++) {
+            if (code[j] < min) {
+                min = code[j];
+            }
+            if (code[j] > max) {
+                max = code[j];
+            }
+        }
+        info->device->scope.channel[chan].clipped =
+            (min == 0 || max == CODE10_MASK);
+        if (info->device->scope.channel[chan].enable) {
+            clip_status |= info->device->scope.channel[chan].clipped;
+        }
+
+        if (!info->device->scope.channel[chan].range_auto) {
+            continue;
+        }
+        low_range = cap->channel[chan].low_range;
+        if (low_range) {
+            if (info->device->scope.channel[chan].clipped) {
+                cgr101_range_switch(info, chan, 0);
+            }
+        } else if (!info->device->scope.channel[chan].clipped) {
+            volts = info->device->scope.channel[chan].volts[low_range];
+            peak = fmax(fabs(volts[min]), fabs(volts[max]));
+            if (peak < info->device->scope.range_auto_frac *
+                SCOPE_DEFAULT_HIGH) {
+                cgr101_range_switch(info, chan, 1);
+            }
+        }
+    }
+
+    info->clip_status = clip_status;
+    scpi_status_questionable_update(info);
+}
+
+/* Handle an internal sweep; returns nonzero when no more are needed. */
+static int cgr101_scope_internal_sweep(struct info *info)
+{
+    if (info->device->scope.cal_range >= 0) {
+        return cgr101_cal_sweep(info);
+    }
+
+    return cgr101_auto_sweep(info);
+}
+
+/*
+ * Equivalent Time Sampling
+ */
+
+static void cgr101_ets_restart(struct info *info, unsigned int factor)
+{
+    ets_reset(info->device->scope.ets, factor);
+    info->device->scope.ets_last = info->device->scope.capture.seq;
+    info->device->scope.ets_sweeps = 0;
+    info->device->scope.ets_rejected = 0;
+    info->device->scope.ets_skipped = 0;
+}
+
+static void cgr101_ets_add(struct info *info, const struct capture *cap)
+{
+    struct ets *ets = info->device->scope.ets;
+    double data[SCOPE_NUM_SAMPLE];
+    double t0 = cap->trigger_ref + cap->trigger_offset;
+    double shift;
+    int chan;
+
+    if (cap->trigger_source != SCOPE_TRIGGER_SOURCE_INT) {
+        /* No trigger crossing on an input to take the phase from. */
+        info->device->scope.ets_rejected++;
+        return;
+    }
+
+    if (cap->sample_rate_divisor != info->device->scope.ets_divisor ||
+        t0 != info->device->scope.ets_t0) {
+        /* The composite's time base no longer applies. */
+        cgr101_ets_restart(info, ets_factor(ets));
+        info->device->scope.ets_divisor = cap->sample_rate_divisor;
+        info->device->scope.ets_t0 = t0;
+    }
+
+    cgr101_digitizer_gather(cap, cap->trigger_chan, data);
+    /* trigger_polarity 0 is SLOPe POSitive */
+    if (ets_phase(data,
+                  SCOPE_NUM_SAMPLE,
+                  t0,
+                  cap->trigger_level,
+                  !cap->trigger_polarity,
+                  &shift)) {
+        info->device->scope.ets_rejected++;
+        return;
+    }
+
+    ets_add(ets, cap->trigger_chan, data, shift);
+    for (chan=0; chan<SCOPE_NUM_CHAN; chan++) {
+        if (chan != cap->trigger_chan) {
+            cgr101_digitizer_gather(cap, chan, data);
+            ets_add(ets, chan, data, shift);
+        }
+    }
+    info->device->scope.ets_sweeps++;
+}
+
+/*
+ * Bin the sweep just published. Any published in the meantime were
+ * replaced before they could be binned and are only counted.
+ */
+static void cgr101_ets_bin(void *arg)
+{
+    struct info *info = arg;
+    const struct capture *cap = &info->device->scope.capture;
+
+    if (!info->device->scope.ets_enable ||
+        cap->seq == info->device->scope.ets_last) {
+        return;
+    }
+
+    info->device->scope.ets_skipped +=
+        cap->seq - info->device->scope.ets_last - 1;
+    cgr101_ets_add(info, cap);
+    info->device->scope.ets_last = cap->seq;
+}
+
+/*
+ * Whatever asked for the re-arm -- INITiate:CONTinuous, a partial
+ * average -- may have been turned off since; if so the sweep ends
+ * here, or nothing would ever clear sweep_status.
+ */
+static void cgr101_scope_rearm(void *arg)
+{
+    struct info *info = arg;
+    int err;
+
+    if (!info->device->scope.rearm_pending) {
+        return;
+    }
+    info->device->scope.rearm_pending = 0;
+
+    if (!info->sweep_status) {
+        return;
+    }
+    if (info->device->scope.continuous ||
+        info->device->scope.average_sweeps != 0 ||
+        cgr101_scope_internal(info)) {
+        /* Internal sweeps don't wait for a trigger. */
+        err = cgr101_digitizer_start(info, cgr101_scope_internal(info));
         assert(!err);
+    } else {
+        if (info->device->scope.output_pending) {
+            /* From the last sweep published. */
+            cgr101_scope_data_output(info);
+        }
+        cgr101_scope_data_done(info, STATE_SCOPE_DATA_IDLE);
+    }
+}
+
+static int cgr101_rcv_scope_data(struct info *info, char c)
+{
+    int err = 0;
+
+    switch (info->device->scope.data_state) {
+    case STATE_SCOPE_DATA_EXPECT_A_HIGH:
+        cgr101_rcv_scope_data_chan(info, 0, 1, c);
+        info->device->scope.data_state = STATE_SCOPE_DATA_EXPECT_A_LOW;
+        break;
+    case STATE_SCOPE_DATA_EXPECT_A_LOW:
+        cgr101_rcv_scope_data_chan(info, 0, 0, c);
+        info->device->scope.data_state = STATE_SCOPE_DATA_EXPECT_B_HIGH;
+        break;
+    case STATE_SCOPE_DATA_EXPECT_B_HIGH:
+        cgr101_rcv_scope_data_chan(info, 1, 1, c);
+        info->device->scope.data_state = STATE_SCOPE_DATA_EXPECT_B_LOW;
+        break;
+    case STATE_SCOPE_DATA_EXPECT_B_LOW:
+        cgr101_rcv_scope_data_chan(info, 1, 0, c);
+        info->device->scope.data_count++;
+        if (info->device->scope.data_count == SCOPE_NUM_SAMPLE) {
+            if (cgr101_scope_internal(info) &&
+                info->sweep_status) {
+                if (cgr101_scope_internal_sweep(info)) {
+                    /* Not a sweep for clients; nothing to publish. */
+                    cgr101_scope_data_done(info, STATE_SCOPE_DATA_IDLE);
+                } else {
+                    info->device->scope.data_state =
+                        STATE_SCOPE_DATA_COMPLETE;
+                    cgr101_scope_rearm_send(info);
+                }
+            } else if (info->device->scope.average &&
+                info->sweep_status &&
+                !cgr101_digitizer_accumulate(info)) {
+                /* More sweeps to average; the sweep is still on. */
+                info->device->scope.data_state = STATE_SCOPE_DATA_COMPLETE;
+                cgr101_scope_rearm_send(info);
+            } else {
+                cgr101_digitizer_publish(info);
+                cgr101_range_track(info, &info->device->scope.capture);
+                if (info->device->scope.output_pending &&
+                    info->device->scope.capture.seq >=
+                    info->device->scope.output_seq) {
+                    cgr101_scope_data_output(info);
+                }
+                cgr101_scope_data_done(info, STATE_SCOPE_DATA_COMPLETE);
+                if (info->device->scope.ets_enable) {
+                    /* After any re-arm, so binning overlaps the sweep */
+                    event_send(info->event, EVENT_ETS_BIN);
+                }
+            }
+            /* Done receiving. */
+            cgr101_rcv_idle(info);
+        } else {
+            info->device->scope.data_state = STATE_SCOPE_DATA_EXPECT_A_HIGH;
+        }
+        break;
+    default:
+        assert(0);
+        break;
+    }
+
+    return err;
+}
+
+/*
+ * Device Error handler
+ */
+
+static int cgr101_rcv_error_msg(struct info *info, char c)
+{
+    int err = 0;
+
+    if (c == '\n') {
+        /* Done receiving. */
+        info->device->error_msg[info->device->error_msg_len++] = 0;
+        scpi_error(info->error,
+                   SCPI_ERR_HARDWARE_ERROR,
+                   info->device->error_msg);
+        cgr101_rcv_idle(info);
+    } else if (c != '\r') {
+        info->device->error_msg[info->device->error_msg_len++] = c;
     }
+
+    return err;
+}
+
+/*
+ * Device Interrupt handler
+ */
+
+static int cgr101_rcv_interrupt_msg(struct info *info, char c)
+{
+    int err = 0;
+
+    switch (c) {
+    case '\n':
+        /* Done receiving. */
+        if (info->device->event.chan_mask & INTERRUPT_CHANNEL_MASK) {
+            cgr101_digital_event(info, DIGITAL_EVENT_INTERRUPT);
+        }
+        cgr101_rcv_idle(info);
+    case '\r':
+    case '!':
+        break;
+    default:
+        assert(0);
+    }
+
+    return err;
+}
+
+/*
+ * Device Identify Handling
+ */
+
+static int cgr101_identify_start(struct info *info)
+{
+    int err = cgr101_device_send(info, "i\n");
+
+    return err;
+}
+
+static void cgr101_identify_done(struct info *info)
+{
+    event_send(info->event, EVENT_IDENTIFY_COMPLETE);
+}
+
+static int cgr101_rcv_ident(struct info *info, char c)
+{
+    int err = 0;
+
+    if (c == '\n') {
+        /* Done receiving. */
+        cgr101_identify_done(info);
+        cgr101_rcv_idle(info);
+    } else if (c != '\r') {
+        info->device->device_id[info->device->device_id_len++] = c;
+    }
+
+    return err;
+}
+
+int cgr101_identify(struct info *info)
+{
+    info->device->identify_output_requested = 1;
+    event_send(info->event, EVENT_IDENTIFY_OUTPUT);
+    return 0;
+}
+
+static void cgr101_identify_completion(void *arg)
+{
+    struct info *info = arg;
+
+    assert(info->device->identify_state == STATE_IDENTIFY_PENDING);
+    info->device->identify_state = STATE_IDENTIFY_COMPLETE;
+    if (info->device->identify_output_requested) {
+        event_send(info->event, EVENT_IDENTIFY_OUTPUT);
+    }
+}
+
+static void cgr101_identify_output(void *arg)
+{
+    struct info *info = arg;
+
+    switch (info->device->identify_state) {
+    case STATE_IDENTIFY_IDLE:
+    {
+        int err = cgr101_identify_start(info);
+        assert(!err);
+    }
+        break;
+    case STATE_IDENTIFY_PENDING:
+        /* Reschedule */
+        event_send(info->event, EVENT_IDENTIFY_OUTPUT);
+        break;
+    case STATE_IDENTIFY_COMPLETE:
+        scpi_output_printf(info->output,
+                           "GMP,CGR101-SCPI,1.0,%s",
+                           info->device->device_id);
+        event_send(info->event, EVENT_OUTPUT_FLUSH);
+        break;
+    default:
+        assert(0);
+        break;
+    }
+}
+
+/*
+ * Event Registration
+ */
+
+static void cgr101_event_init(struct info *info)
+{
+    int err;
+
+    err = event_add(info->event,
+                    EVENT_IDENTIFY_COMPLETE,
+                    cgr101_identify_completion,
+                    info);
+    assert(!err);
+
+    err = event_add(info->event,
+                    EVENT_IDENTIFY_OUTPUT,
+                    cgr101_identify_output,
+                    info);
+    assert(!err);
+
+    err = event_add(info->event,
+                    EVENT_DIGITAL_READ_COMPLETE,
+                    cgr101_digital_read_completion,
+                    info);
+    assert(!err);
+
+    err = event_add(info->event,
+                    EVENT_DIGITAL_READ_OUTPUT,
+                    cgr101_digital_read_output,
+                    info);
+    assert(!err);
+
+    err = event_add(info->event,
+                    EVENT_SCOPE_STATUS_COMPLETE,
+                    cgr101_scope_status_completion,
+                    info);
+    assert(!err);
+
+    err = event_add(info->event,
+                    EVENT_SCOPE_STATUS_OUTPUT,
+                    cgr101_scope_status_output,
+                    info);
+    assert(!err);
+
+    err = event_add(info->event,
+                    EVENT_SCOPE_OFFSET_START,
+                    cgr101_scope_offset_start,
+                    info);
+    assert(!err);
+
+    err = event_add(info->event,
+                    EVENT_SCOPE_REARM,
+                    cgr101_scope_rearm,
+                    info);
+    assert(!err);
+
+    err = event_add(info->event,
+                    EVENT_ETS_BIN,
+                    cgr101_ets_bin,
+                    info);
+    assert(!err);
+
+}
+
+/*
+ * Recieve Output Channel Handling
+ */
+
+static int cgr101_rcv_sm(struct info *info, char c)
+{
+    int err = 1;
+
+    switch (info->device->rcv_state) {
+    case IDLE:
+        err = cgr101_rcv_start(info, c);
+        break;
+    case IDENTIFY:
+        err = cgr101_rcv_ident(info, c);
+        break;
+    case DIGITAL_READ:
+        err = cgr101_rcv_digital_read(info, c);
+        break;
+    case SCOPE_OFFSET:
+        err = cgr101_rcv_scope_offset(info, c);
+        break;
+    case SCOPE_STATUS:
+        err = cgr101_rcv_scope_status(info, c);
+        break;
+    case SCOPE_ADDR:
+        err = cgr101_rcv_scope_addr(info, c);
+        break;
+    case SCOPE_DATA:
+        err = cgr101_rcv_scope_data(info, c);
+        break;
+    case ERROR_MSG:
+        err = cgr101_rcv_error_msg(info, c);
+        break;
+    case INTERRUPT_MSG:
+        err = cgr101_rcv_interrupt_msg(info, c);
+        break;
+    default:
+        assert(0);
+    }
+
+    assert(!err); /*FIXME: DEBUG*/
+    return err;
+}
+
+static int cgr101_rcv_data(struct info *info, const char *buf, size_t len)
+{
+    int err = 1;
+
+    while (len--) {
+        info->device->rcv_data_ptr = buf; /* For rcv debug */
+        err = cgr101_rcv_sm(info, *buf++);
+        if (err) {
+            assert(0); /*FIXME: DEBUG*/
+
+            break;
+        }
+    }
+
+    return err;
+}
+
+static int cgr101_out(void *arg)
+{
+    struct info *info = arg;
+    int err = 0;
+    ssize_t len;
+
+    len = read(info->device->child.stdout, info->device->rcv_data, RCV_MAX);
+
+    if (len < 0) {
+        if (errno != EINTR && errno != EAGAIN) {
+            assert(0); /*FIXME: DEBUG*/
+            err = 1;
+        }
+    } else if (len != 0 && info->device->sent) {
+        /* Only receive data once a command has been sent to flush any
+         pending stale data. */
+        info->device->rcv_data_len = (size_t)len;
+        err = cgr101_rcv_data(info,
+                              info->device->rcv_data,
+                              info->device->rcv_data_len);
+    }
+
+    return err;
+}
+
+/*
+ * Recieve Error Channel Handling
+ */
+
+static int cgr101_err(void *arg)
+{
+    struct info *info = arg;
+    int err = 0;
+    ssize_t len;
+
+    len = read(
+        info->device->child.stderr,
+        info->device->err_data,
+        sizeof(info->device->err_data));
+
+    assert(len > 0);
+    assert(len <= (ssize_t)sizeof(info->device->err_data));
+
+    return err;
+}
+
+static int cgr101_keyword_lookup(const struct cgr101_keyword_map_s *map,
+                                 const char *value)
+{
+    const struct cgr101_keyword_map_s *p;
+
+    assert(value);
+    for (p = map; p->name != NULL; p++) {
+        if (scpi_input_keyword(value, p->name)) {
+            break;
+        }
+    }
+    assert(p->name != NULL); /* The grammar only passes known keywords. */
+
+    return p->value;
+}
+
+/*
+ * Waveform programming
+ */
+
+static void cgr101_waveform_lookup(const char *value,
+                                   enum cgr101_waveform_shape *shape)
+{
+    struct cgr101_waveform_map_s *p;
+
+    assert(value);
+    assert(shape);
+    for (p = cgr101_waveform_map; p != NULL; p++) {
+        if (!strcasecmp(value, p->name)) {
+            *shape = p->shape;
+            break;
+        }
+    }
+    assert(p != NULL);
+}
+
+static const char *cgr101_waveform_name(enum cgr101_waveform_shape shape)
+{
+    struct cgr101_waveform_map_s *p;
+    const char *name = NULL;
+
+    for (p = cgr101_waveform_map; p != NULL; p++) {
+        if (shape == p->shape) {
+            name = p->name;
+            break;
+        }
+    }
+    assert(name != NULL);
+
+    return name;
+}
+
+/*
+ * Waveform functions:
+ *  phase: 0.0 .. 1.0
+ *  amplitude: -1.0 .. 1.0
+ */
+
+static double cgr101_fn_sin(double phase, void *arg)
+{
+    double angle = 2.0 * M_PI * phase;
+    (void)arg;
+    return ((double)sin(angle));
+}
+
+
+static double cgr101_fn_squ(double phase, void *arg)
+{
+    (void)arg;
+    return (double)((phase < 0.5) ? 1.0 : -1.0);
+}
+
+static double cgr101_fn_tri(double phase, void *arg)
+{
+    (void)arg;
+    phase *= 4.0;
+    return (phase < 2.0) ? (phase - 1.0) : (3.0 - phase);
+}
+
+static double cgr101_fn_const(double phase, void *arg)
+{
+    double value = *(double *)arg;
+    (void)phase;
+    return (double)value;
+}
+
+/*
+ * Interpolate a set of points. 'phase' ranges from 0.0 to (almost) 1.0.
+ */
+static double cgr101_fn_interp(double phase, void *arg)
+{
+    struct cgr101_w_interp *interp = (struct cgr101_w_interp  *)arg;
+    double value = 0.0;
+    double in_phase;
+    double start_phase;
+    double end_phase;
+    double interp_phase;
+    double delta;
+    double v1;
+    double v2;
+    size_t start_idx;
+    size_t end_idx;
+    size_t segments;
+
+    assert(interp);
+    assert(interp->data);
+    assert(interp->len > 1);
+    assert(interp->len <= WAVEFORM_USER_MAX);
+    /* Number of line segments to use. */
+    segments = interp->len - 1;
+    in_phase = phase * (double)segments;
+    /* Indexes for starting and ending interpolation points */
+    start_phase = floor(in_phase);
+    end_phase = start_phase + 1.0;
+    start_idx = (size_t)start_phase;
+    end_idx = (size_t)end_phase;
+    assert(start_idx < segments);
+    assert(end_idx < interp->len);
+    assert(end_idx > start_idx);
+    interp_phase = in_phase - start_phase;
+    assert(interp_phase >= 0);
+    assert(interp_phase < 1.0);
+
+    /* Get the endpoints of the interpolation segment. */
+    v1 = interp->data[start_idx];
+    v2 = interp->data[end_idx];
+    /* Calculate the interpolated value. */
+    delta = v2 - v1;
+    value = v1 + delta*interp_phase;
+
+    return value;
+}
+
+typedef double (*wff_t)(double phase, void *arg);
+
+static void cgr101_waveform_create_fn(double *data,
+                                      size_t points,
+                                      wff_t wfn,
+                                      void *arg)
+{
+    size_t i;
+    double phase = 0.0;
+    double phase_incr = 1.0/((double)points);
+    for (i=0; i<points; i++) {
+        data[i] = (double)wfn(phase, arg);
+        phase += phase_incr;
+    }
+}
+
+static void cgr101_waveform_create(struct info *info,
+                                   enum cgr101_waveform_shape shape)
+{
+    switch (shape) {
+    case WAV_RAND:
+        /* Handled by device programming. */
+        break;
+    case WAV_SIN:
+        cgr101_waveform_create_fn(info->device->waveform.user,
+                                  COUNT_OF(info->device->waveform.user),
+                                  cgr101_fn_sin,
+                                  NULL);
+        break;
+    case WAV_SQU:
+        cgr101_waveform_create_fn(info->device->waveform.user,
+                                  COUNT_OF(info->device->waveform.user),
+                                  cgr101_fn_squ,
+                                  NULL);
+        break;
+    case WAV_TRI:
+        cgr101_waveform_create_fn(info->device->waveform.user,
+                                  COUNT_OF(info->device->waveform.user),
+                                  cgr101_fn_tri,
+                                  NULL);
+        break;
+    case WAV_NONE:
+        /* Nothing to do. */
+        break;
+    default:
+        assert(0);
+        break;
+    }
+
+    /* FIXME: only set if no error. */
+    info->device->waveform.shape = shape;
+
+}
+
+static int cgr101_waveform_conv(double value)
+{
+    return (255 - (int)ceil((value * 127.5) + 127.0));
+}
+
+static void cgr101_waveform_program(struct info *info)
+{
+    int err;
+    size_t i;
+    double f;
+    int val;
+
+    if (info->device->waveform.shape == WAV_RAND) {
+        err = cgr101_device_printf(info, "W N\n");
+        assert(!err);
+    } else {
+        for (i=0; i<COUNT_OF(info->device->waveform.user); i++) {
+            f = info->device->waveform.user[i];
+            val = cgr101_waveform_conv(f);
+            assert(val >= 0);
+            assert(val <= 255);
+            err = cgr101_device_printf(info, "W S %zu %d\n", i, val);
+            assert(!err);
+        }
+        err = cgr101_device_printf(info, "W P\n");
+        assert(!err);
+    }
+}
+
+static void cgr101_waveform_user(struct info *info,
+                                 size_t len,
+                                 double *data)
+{
+    if (len == 1) {
+        cgr101_waveform_create_fn(info->device->waveform.user,
+                                  COUNT_OF(info->device->waveform.user),
+                                  cgr101_fn_const,
+                                  data);
+    } else if (len <= COUNT_OF(info->device->waveform.user)) {
+        struct cgr101_w_interp interp = {
+            .len = len,
+            .data = data
+        };
+        cgr101_waveform_create_fn(info->device->waveform.user,
+                                  COUNT_OF(info->device->waveform.user),
+                                  cgr101_fn_interp,
+                                  &interp);
+    } else {
+        /* Handle this case someday or return an error. */
+        assert(0);
+    }
+}
+
+static void cgr101_waveform_userq(struct info *info)
+{
+    size_t i;
+
+    for (i=0; i<COUNT_OF(info->device->waveform.user); i++) {
+        scpi_output_fp(info->output, info->device->waveform.user[i]);
+    }
+}
+
+/*
+ * Oscilloscope Handling
+ */
+
+static void cgr101_digitizer_set_midpoint_ptp(struct info *info, int chan)
+{
+    double low = info->device->scope.channel[chan].input_low;
+    double high = info->device->scope.channel[chan].input_high;
+    double ptp = high - low;
+    double midpoint = low + (ptp/2.0);
+    info->device->scope.channel[chan].input_ptp = ptp;
+    info->device->scope.channel[chan].input_midpoint = midpoint;
+}
+
+static void cgr101_digitizer_set_high_low(struct info *info, int chan)
+{
+    double ptp = info->device->scope.channel[chan].input_ptp;
+    double midpoint = info->device->scope.channel[chan].input_midpoint;
+    double low = midpoint - (ptp/2.0);
+    double high = midpoint + (ptp/2.0);
+    info->device->scope.channel[chan].input_low = low;
+    info->device->scope.channel[chan].input_high = high;
+}
+
+static void cgr101_digitizer_set_range(struct info *info,int chan)
+{
+    int err;
+    int low_range = (info->device->scope.channel[chan].input_low >= -2.5 &&
+                     info->device->scope.channel[chan].input_high <= 2.5);
+    assert(chan >= 0 && chan < SCOPE_NUM_CHAN);
+    assert(low_range >= 0 && low_range < SCOPE_NUM_RANGE);
+    info->device->scope.channel[chan].input_low_range = low_range;
+    err = cgr101_device_printf(info, "S P %c\n",
+                               cgr101_range_cmd[chan][low_range]);
+    assert(!err);
+}
+
+static int cgr101_sweep_time(struct info *info, double time)
+{
+    double sweep_time = SCOPE_MIN_SWEEP_TIME;
+    double sweep_time2 = sweep_time * 2.0;
+    int sweep_div;
+    int err = 1;
+
+    for (sweep_div = 0; sweep_div <= SCOPE_SR_DIV_MAX; sweep_div++) {
+        if (time >= sweep_time && time < sweep_time2) {
+            break;
+        }
+        sweep_time = sweep_time2;
+        sweep_time2 = sweep_time * 2.0;
+    }
+
+    if (sweep_div >= 0 && sweep_div <= SCOPE_SR_DIV_MAX) {
+        info->device->scope.sweep_time = sweep_time;
+        info->device->scope.sample_rate_divisor = sweep_div;
+        err = 0;
+    }
+
+    return err;
+}
+
+/*
+ * Output something derived from a sweep once capture seq is in: right
+ * away if it already is, otherwise when the sweeps in progress publish
+ * it.
+ */
+static void cgr101_digitizer_fetch_seq(struct info *info,
+                                       enum cgr101_scope_output kind,
+                                       int func,
+                                       long chan_mask,
+                                       unsigned long seq)
+{
+    if (cgr101_math_off(info, chan_mask)) {
+        scpi_error(info->error, SCPI_ERR_SETTINGS_CONFLICT, NULL);
+        return;
+    }
+
+    info->device->scope.output_kind = kind;
+    info->device->scope.output_func = func;
+    info->device->scope.output_mask = chan_mask & (SCOPE_CHAN_MASK |
+                                                   SCOPE_MATH_MASK);
+
+    if (info->device->scope.capture.seq >= seq) {
+        cgr101_scope_output(info);
+    } else {
+        assert(info->sweep_status);
+        info->block_input = 1;
+        info->device->scope.output_pending = 1;
+        info->device->scope.output_seq = seq;
+    }
+}
+
+/*
+ * FETCh: right away from the last sweep if it will do, otherwise when
+ * the sweep in progress completes.
+ */
+static void cgr101_digitizer_fetch(struct info *info,
+                                   enum cgr101_scope_output kind,
+                                   int func,
+                                   long chan_mask)
+{
+    unsigned long seq = info->device->scope.capture.seq;
+
+    if (info->sweep_status &&
+        !(info->device->scope.continuous && seq != 0)) {
+        /* Wait on the sweep in progress. */
+        seq++;
+    }
+    cgr101_digitizer_fetch_seq(info, kind, func, chan_mask, seq);
+}
+
+
+/*
+ * Initialization
+ */
+
+static void cgr101_device_reset(struct info *info)
+{
+    int chan;
+    int m;
+    double midpoint = (double)SCOPE_NUM_SAMPLE/2;
+    unsigned int j;
+    int err;
+
+    /*Consistency check*/
+    assert(COUNT_OF(info->device->scope.channel) == SCOPE_NUM_CHAN);
+    assert(CAPTURE_NUM_CHAN == SCOPE_NUM_CHAN);
+    assert(CAPTURE_NUM_SAMPLE == SCOPE_NUM_SAMPLE);
+    /* Set Defaults */
+    info->device->scope.continuous = 0;
+    info->device->scope.average = 0;
+    info->device->scope.average_count = SCOPE_AVERAGE_DEFAULT;
+    cgr101_digitizer_average_reset(info);
+    info->device->scope.fft_window = FFT_WINDOW_HANN;
+    info->device->scope.ets_enable = 0;
+    info->device->scope.filter_enable = 0;
+    info->device->scope.filter.type = FILTER_LPASS;
+    info->device->scope.filter.form = FILTER_FIR;
+    info->device->scope.filter.taps = SCOPE_FILTER_TAPS;
+    info->device->scope.filter.f1 = SCOPE_FILTER_F1;
+    info->device->scope.filter.f2 = SCOPE_FILTER_F2;
+    cgr101_filter_invalidate(info);
+    for (m=0; m<SCOPE_NUM_MATH; m++) {
+        info->device->scope.math[m].func = MATHCHAN_OFF;
+        info->device->scope.math[m].a = 0;
+        info->device->scope.math[m].b = 1;
+        info->device->scope.math[m].scale = 1.0;
+        info->device->scope.math[m].offset = 0.0;
+    }
+    cgr101_math_invalidate(info);
+    info->device->scope.mask_enable = 0;
+    info->device->scope.mask_stop = 0;
+    info->device->scope.mask_keep_fail = 0;
+    cgr101_mask_stats_reset(info);
+    info->device->scope.hist_enable = 0;
+    cgr101_hist_reset(info);
+    info->device->scope.cal_count = SCOPE_CAL_SWEEPS;
+    info->device->scope.range_auto_frac = SCOPE_RANGE_AUTO_FRAC;
+    info->clip_status = 0;
+    err = history_resize(info->device->scope.history, HISTORY_DEFAULT_DEPTH);
+    assert(!err);
+    info->device->scope.trigger_offset = 0;
+    info->device->scope.trigger_ref = midpoint;
+    err = cgr101_sweep_time(info, SCOPE_MIN_SWEEP_TIME);
+    assert(!err);
+    cgr101_ets_restart(info, ETS_DEFAULT_FACTOR);
+    for (chan=0; chan<SCOPE_NUM_CHAN; chan++) {
+        info->device->scope.channel[chan].enable = 0;
+        info->device->scope.channel[chan].input_low = SCOPE_DEFAULT_LOW;
+        info->device->scope.channel[chan].input_high = SCOPE_DEFAULT_HIGH;
+        info->device->scope.channel[chan].input_midpoint =
+            SCOPE_DEFAULT_MIDPOINT;
+        info->device->scope.channel[chan].input_ptp = SCOPE_DEFAULT_PTP;
+        for (j=0; j<SCOPE_NUM_SAMPLE; j++) {
+            info->device->scope.channel[chan].mask_upper[j] =
+                SCOPE_DEFAULT_HIGH;
+            info->device->scope.channel[chan].mask_lower[j] =
+                SCOPE_DEFAULT_LOW;
+        }
+        info->device->scope.channel[chan].range_auto = 0;
+        info->device->scope.channel[chan].clipped = 0;
+        /* Force */
+        info->device->scope.channel[chan].input_low_range = 0;
+    }
+    cgr101_mask_update(info);
+}
+
+static void cgr101_device_init(struct info *info)
+{
+    int chan;
+
+    info->device->scope.cal_range = -1;
+    info->device->scope.auto_step = -1;
+    cgr101_device_reset(info);
+    for (chan=0; chan<SCOPE_NUM_CHAN; chan++) {
+        cgr101_digitizer_set_range(info, chan);
+    }
+    cgr101_digitizer_volts_update(info);
+
+    /* Query device for offsets. Send as an event to allow any stale
+     data still being sent by the device to be flushed. */
+    if (info->device->scope.offset_state != STATE_SCOPE_OFFSET_EXPECT_A_HIGH) {
+        event_send(info->event, EVENT_SCOPE_OFFSET_START);
+    }
+    info->offset_status = 1; /* Cleared when all offsets received. */
+}
+
+/*
+ * PWM Programming
+ */
+
+static void cgr101_pwm_duty_cycle(struct info *info, double value)
+{
+    int err;
+    int n;
+
+    n = (int)floor(value*255.0);
+    info->device->pwm.duty_cycle = (double)n/255.0;
+    err = cgr101_device_printf(info, "D D %d\n", n);
+    assert(!err);
+}
+
+static void cgr101_pwm_frequency(struct info *info, double value)
+{
+    int err;
+    size_t idx;
+    size_t last;
+    double f1;
+    double f2;
+
+    /* Don't include sentinel in iteration. */
+    last = COUNT_OF(cgr101_pwm_freq)-1;
+    for (idx=0; idx < last; idx++) {
+        f1 = cgr101_pwm_freq[idx];
+        f2 = cgr101_pwm_freq[idx+1];
+        if (value <= f1 && value > f2) {
+            info->device->pwm.frequency = f1;
+            break;
+        }
+    }
+    err = cgr101_device_printf(info, "D F %zu\n", idx);
+    assert(!err);
+
+}
+
+
+/*
+ * Device Open/Close
+ */
+
+int cgr101_open(struct info *info)
+{
+    int err;
+    struct cgr101 *cgr101;
+
+    cgr101 = calloc(1,sizeof(*cgr101));
+    assert(cgr101);
+    if (info->debug && strchr(info->debug,'E')) {
+        info->emulation = 1;
+    }
+
+    info->device = cgr101;
+
+    do {
+        err = spawn(CMD, &info->device->child);
+        if (err) {
+            break;
+        }
+
+        err = worker_add(
+            info->worker,
+            info->device->child.stdout,
+            cgr101_out,
+            info);
+        if (err) {
+            break;
+        }
+
+        err = worker_add(
+            info->worker,
+            info->device->child.stderr,
+            cgr101_err,
+            info);
+        if (err) {
+            break;
+        }
+
+        cgr101_event_init(info);
+
+        info->device->scope.history = history_init(HISTORY_DEFAULT_DEPTH);
+        if (!info->device->scope.history) {
+            err = -1;
+            break;
+        }
+
+        info->device->scope.fft = fft_init();
+        if (!info->device->scope.fft) {
+            err = -1;
+            break;
+        }
+
+        info->device->scope.ets = ets_init(SCOPE_NUM_SAMPLE, SCOPE_NUM_CHAN);
+        if (!info->device->scope.ets) {
+            err = -1;
+            break;
+        }
+
+        if (info->export_name) {
+            info->device->scope.export = export_init(info->export_name,
+                                                     EXPORT_DEPTH);
+            if (!info->device->scope.export) {
+                fprintf(stderr, "Shared memory export %s failed.\n",
+                        info->export_name);
+                err = -1;
+                break;
+            }
+        }
+
+        /* Initialize device. */
+        cgr101_device_init(info);
+    } while (0);
+
+    return err;
+}
+
+int cgr101_close(struct info *info)
+{
+    unspawn(&info->device->child);
+    if (info->device) {
+        history_done(info->device->scope.history);
+        fft_done(info->device->scope.fft);
+        ets_done(info->device->scope.ets);
+        export_done(info->device->scope.export);
+        if (info->device->scope.binlog) {
+            (void)binlog_close(info->device->scope.binlog);
+        }
+        free(info->device);
+    }
+
+    return 0;
+}
+
+/*
+ * SCPI Interfaces
+ */
+
+int cgr101_initiate(struct info *info)
+{
+    int err;
+
+    if (info->device->digital_read_requested) {
+        err = cgr101_digital_read_start(info);
+        assert(!err);
+    }
+
+    if (info->device->scope.channel[0].enable ||
+        info->device->scope.channel[1].enable) {
+        err = cgr101_digitizer_start(info, 0);
+        assert(!err);
+    }
+
+    if (info->device->event.chan_mask & INTERRUPT_CHANNEL_MASK) {
+        cgr101_interrupt_mode(info);
+    }
+
+    if (info->device->event.chan_mask & DIGITAL_DATA_CHANNEL_MASK) {
+        cgr101_digital_auto_update(info);
+    }
+
+    if ((info->device->event.chan_mask) != 0) {
+        info->digital_event_status = 1;
+    }
+
+    return 0;
+}
+
+int cgr101_initiate_immediate(struct info *info)
+{
+    int err;
+
+    if (info->device->digital_read_requested) {
+        err = cgr101_digital_read_start(info);
+        assert(!err);
+    }
+
+    if (info->device->scope.channel[0].enable ||
+        info->device->scope.channel[1].enable) {
+        err = cgr101_digitizer_start(info, 1);
+        assert(!err);
+    }
+
+    return 0;
+}
+
+void cgr101_initiate_continuous(struct info *info, int value)
+{
+    int err;
+
+    info->device->scope.continuous = value;
+    if (value &&
+        !info->sweep_status &&
+        (info->device->scope.channel[0].enable ||
+         info->device->scope.channel[1].enable)) {
+        err = cgr101_digitizer_start(info, 0);
+        assert(!err);
+    }
+}
+
+void cgr101_initiate_continuousq(struct info *info)
+{
+    scpi_output_int(info->output, info->device->scope.continuous);
+}
+
+void cgr101_ets(struct info *info, int value)
+{
+    if (value &&
+        info->device->scope.trigger_source != SCOPE_TRIGGER_SOURCE_INT) {
+        /* The phase comes from the internal trigger's crossing. */
+        scpi_error(info->error, SCPI_ERR_SETTINGS_CONFLICT, NULL);
+        return;
+    }
+    if (value && !info->device->scope.ets_enable) {
+        cgr101_ets_restart(info, ets_factor(info->device->scope.ets));
+    }
+    info->device->scope.ets_enable = value;
+}
+
+void cgr101_etsq(struct info *info)
+{
+    scpi_output_int(info->output, info->device->scope.ets_enable);
+}
+
+void cgr101_ets_factor(struct info *info, long value)
+{
+    assert(value >= 1 && value <= ETS_MAX_FACTOR);
+    cgr101_ets_restart(info, (unsigned int)value);
+}
+
+void cgr101_ets_factorq(struct info *info)
+{
+    scpi_output_int(info->output,
+                    (int)ets_factor(info->device->scope.ets));
+}
+
+void cgr101_ets_reset(struct info *info)
+{
+    cgr101_ets_restart(info, ets_factor(info->device->scope.ets));
+}
+
+/* Sweeps binned, sweeps rejected, sweeps skipped */
+void cgr101_ets_countq(struct info *info)
+{
+    scpi_output_printf(info->output, "%lu", info->device->scope.ets_sweeps);
+    scpi_output_printf(info->output, "%lu", info->device->scope.ets_rejected);
+    scpi_output_printf(info->output, "%lu", info->device->scope.ets_skipped);
+}
+
+/* Percentage of composite points filled, worst channel */
+void cgr101_ets_fillq(struct info *info)
+{
+    struct ets *ets = info->device->scope.ets;
+    size_t filled = ets_points(ets);
+    size_t n;
+    int chan;
+
+    for (chan=0; chan<SCOPE_NUM_CHAN; chan++) {
+        n = ets_filled(ets, chan);
+        filled = (n < filled) ? n : filled;
+    }
+    scpi_output_fp(info->output,
+                   100.0 * (double)filled / (double)ets_points(ets));
+}
+
+/*
+ * Composite record per channel, SENSe:SWEep:POINts * FACTor points
+ * at SENSe:SWEep:TINTerval / FACTor. Points no sweep has reached yet
+ * are 9.91E37. Any binary FORMat gets a REAL block.
+ */
+void cgr101_ets_dataq(struct info *info, long chan_mask)
+{
+    struct ets *ets = info->device->scope.ets;
+    size_t points = ets_points(ets);
+    int binary = (info->scpi->format != SCPI_FORMAT_ASCII);
+    double *data;
+    uint8_t *buf = NULL;
+    uint8_t *p = NULL;
+    size_t j;
+    int chan;
+
+    data = calloc(points, sizeof(*data));
+    if (binary) {
+        buf = calloc(SCOPE_NUM_CHAN * points, sizeof(double));
+        p = buf;
+    }
+    if (!data || (binary && !buf)) {
+        scpi_error(info->error, SCPI_ERR_OUT_OF_MEMORY, NULL);
+        free(data);
+        free(buf);
+        return;
+    }
+
+    for (chan=0; chan<SCOPE_NUM_CHAN; chan++) {
+        if (!(chan_mask & 1<<chan)) {
+            continue;
+        }
+        ets_result(ets, chan, MEAS_NAN, data);
+        if (binary) {
+            p = cgr101_pack_reals(p, data, points);
+        } else {
+            for (j=0; j<points; j++) {
+                scpi_output_fp(info->output, data[j]);
+            }
+        }
+    }
+
+    if (binary) {
+        scpi_output_block(info->output, buf, (size_t)(p - buf));
+    }
+    free(data);
+    free(buf);
+}
+
+/*
+ * Changing how sweeps are averaged starts the average over. The sum
+ * so far is dropped, and a sweep waiting to re-arm for more of it
+ * ends instead (see cgr101_scope_rearm()), so *WAI, *OPC and pending
+ * output don't wait on it.
+ */
+void cgr101_average(struct info *info, int value)
+{
+    info->device->scope.average = value;
+    cgr101_digitizer_average_reset(info);
+}
+
+void cgr101_averageq(struct info *info)
+{
+    scpi_output_int(info->output, info->device->scope.average);
+}
+
+void cgr101_average_count(struct info *info, long value)
+{
+    assert(value >= 1 && value <= CAPTURE_MAX_COUNT);
+    info->device->scope.average_count = (int)value;
+    cgr101_digitizer_average_reset(info);
+}
+
+void cgr101_average_countq(struct info *info)
+{
+    scpi_output_int(info->output, info->device->scope.average_count);
+}
+
+int cgr101_configure_digital_data(struct info *info)
+{
+    info->device->digital_read_requested = 1;
+
+    return 0;
+}
+
+int cgr101_digital_data_configured(struct info *info)
+{
+    return info->device->digital_read_requested;
+}
+
+void cgr101_fetch_digital_data(struct info *info)
+{
+    event_send(info->event, EVENT_DIGITAL_READ_OUTPUT);
+}
+
+void cgr101_source_digital_data(struct info *info, int value)
+{
+    int err;
+
+    info->device->digital_write_data = value;
+    err = cgr101_device_printf(info, "D O %d\n", value);
+    assert(!err);
+}
+
+void cgr101_source_digital_dataq(struct info *info)
+{
+    scpi_output_int(info->output, info->device->digital_write_data);
+}
+
+#define K1 0.09313225746
+void cgr101_source_waveform_frequency(struct info *info, double value)
+{
+    int phase_incr = (int)floor(value/K1);
+    int f0 = (phase_incr >> 24) & 0xff;
+    int f1 = (phase_incr >> 16) & 0xff;
+    int f2 = (phase_incr >>  8) & 0xff;
+    int f3 = (phase_incr)       & 0xff;
+    int err;
+
+    err = cgr101_device_printf(info, "W F %d %d %d %d\n", f0, f1, f2, f3);
+    assert(!err);
+    info->device->waveform.frequency = value;
+}
+
+void cgr101_source_waveform_frequencyq(struct info *info)
+{
+    scpi_output_fp(info->output, info->device->waveform.frequency);
+}
+
+void cgr101_source_waveform_level(struct info *info, double value)
+{
+    int err;
+    int amp;
+
+    if (value >= 0.0 && value <= 1.0) {
+        info->device->waveform.amplitude = value;
+        amp = (int)floor(value * 255.0);
+        assert(amp >= 0);
+        assert(amp <= 255);
+        err = cgr101_device_printf(info, "W A %d\n", amp);
+        assert(!err);
+    } else {
+        /* Range error */
+    }
+}
+
+void cgr101_source_waveform_levelq(struct info *info)
+{
+    scpi_output_fp(info->output, info->device->waveform.amplitude);
+}
+
+void cgr101_source_waveform_function(struct info *info,
+                                     const char *value)
+{
+    enum cgr101_waveform_shape shape;
+
+    cgr101_waveform_lookup(value, &shape);
+    if (shape != WAV_NONE) {
+        cgr101_waveform_create(info, shape);
+        cgr101_waveform_program(info);
+    }
+}
+
+void cgr101_source_waveform_functionq(struct info *info)
+{
+    const char *name;
+
+    name = cgr101_waveform_name(info->device->waveform.shape);
+    assert(name);
+    scpi_output_str(info->output, name);
+}
+
+void cgr101_source_waveform_user(struct info *info, size_t len, double *data)
+{
+    info->device->waveform.shape = WAV_USER;
+    cgr101_waveform_user(info, len, data);
+    cgr101_waveform_program(info);
+}
+
+void cgr101_source_waveform_userq(struct info *info)
+{
+    cgr101_waveform_userq(info);
+}
+
+void cgr101_source_pwm_duty_cycle(struct info *info, double value)
+{
+    cgr101_pwm_duty_cycle(info, value);
+}
+
+void cgr101_source_pwm_duty_cycleq(struct info *info)
+{
+    scpi_output_fp(info->output, info->device->pwm.duty_cycle);
+}
+
+void cgr101_source_pwm_frequency(struct info *info, double value)
+{
+    cgr101_pwm_frequency(info, value);
+}
+
+void cgr101_source_pwm_frequencyq(struct info *info)
+{
+    scpi_output_fp(info->output, info->device->pwm.frequency);
+}
+
+void cgr101_digitizer_coupling(struct info *info, const char *value)
+{
+    (void)info;
+    (void)value;
+}
+
+void cgr101_digitizer_dataq(struct info *info, long chan_mask)
+{
+    cgr101_digitizer_partialq(info, 0, SCOPE_NUM_SAMPLE, chan_mask);
+}
+
+void cgr101_digitizer_partialq(struct info *info,
+                               long start,
+                               long count,
+                               long chan_mask)
+{
+    assert(start >= 0 && count > 0 && start + count <= SCOPE_NUM_SAMPLE);
+    info->device->scope.output_start = (int)start;
+    info->device->scope.output_count = (int)count;
+    cgr101_digitizer_fetch(info, SCOPE_OUTPUT_DATA, 0, chan_mask);
 }
 
-static void cgr101_waveform_user(struct info *info,
-                                 size_t len,
-                                 double *data)
+void cgr101_digitizer_decimateq(struct info *info,
+                                long points,
+                                const char *mode,
+                                long chan_mask)
 {
-    if (len == 1) {
-        cgr101_waveform_create_fn(info->device->waveform.user,
-                                  COUNT_OF(info->device->waveform.user),
-                                  cgr101_fn_const,
-                                  data);
-    } else if (len <= COUNT_OF(info->device->waveform.user)) {
-        struct cgr101_w_interp interp = {
-            .len = len,
-            .data = data
-        };
-        cgr101_waveform_create_fn(info->device->waveform.user,
-                                  COUNT_OF(info->device->waveform.user),
-                                  cgr101_fn_interp,
-                                  &interp);
-    } else {
-        /* Handle this case someday or return an error. */
-        assert(0);
+    int func = MEAS_DECIMATE_SAMPLE;
+
+    assert(points > 0 && points <= SCOPE_NUM_SAMPLE);
+    if (mode) {
+        func = cgr101_keyword_lookup(cgr101_decimate_map, mode);
     }
+    info->device->scope.output_points = (int)points;
+    cgr101_digitizer_fetch(info, SCOPE_OUTPUT_DECIMATE, func, chan_mask);
 }
 
-static void cgr101_waveform_userq(struct info *info)
+void cgr101_waveform_preambleq(struct info *info, long chan_mask)
 {
-    size_t i;
+    cgr101_digitizer_fetch(info, SCOPE_OUTPUT_PREAMBLE, 0, chan_mask);
+}
 
-    for (i=0; i<COUNT_OF(info->device->waveform.user); i++) {
-        scpi_output_fp(info->output, info->device->waveform.user[i]);
-    }
+void cgr101_fetch_voltage(struct info *info,
+                          const char *func,
+                          long chan_mask)
+{
+    cgr101_digitizer_fetch(info,
+                           SCOPE_OUTPUT_MEAS_VOLT,
+                           cgr101_keyword_lookup(cgr101_volt_func_map, func),
+                           chan_mask);
 }
 
 /*
- * Oscilloscope Handling
+ * Sweep the given channels unless continuous acquisition will, and
+ * return the first capture.seq taken entirely under the current
+ * settings. A continuous sweep or average already under way was armed
+ * before them, so skip past it.
  */
-
-static void cgr101_digitizer_set_midpoint_ptp(struct info *info, int chan)
+static unsigned long cgr101_measure_start(struct info *info, long chan_mask)
 {
-    double low = info->device->scope.channel[chan].input_low;
-    double high = info->device->scope.channel[chan].input_high;
-    double ptp = high - low;
-    double midpoint = low + (ptp/2.0);
-    info->device->scope.channel[chan].input_ptp = ptp;
-    info->device->scope.channel[chan].input_midpoint = midpoint;
+    unsigned long seq = info->device->scope.capture.seq + 1;
+    int err;
+
+    chan_mask |= cgr101_math_sources(info, chan_mask);
+    cgr101_digitizer_channel_state(info, chan_mask, 1);
+    if (!info->sweep_status) {
+        err = cgr101_digitizer_start(info, 0);
+        assert(!err);
+    } else if (info->device->scope.continuous &&
+               !(info->device->scope.rearm_pending &&
+                 info->device->scope.average_sweeps == 0)) {
+        seq++;
+    }
+
+    return seq;
 }
 
-static void cgr101_digitizer_set_high_low(struct info *info, int chan)
+void cgr101_measure_voltage(struct info *info,
+                            const char *func,
+                            long chan_mask)
 {
-    double ptp = info->device->scope.channel[chan].input_ptp;
-    double midpoint = info->device->scope.channel[chan].input_midpoint;
-    double low = midpoint - (ptp/2.0);
-    double high = midpoint + (ptp/2.0);
-    info->device->scope.channel[chan].input_low = low;
-    info->device->scope.channel[chan].input_high = high;
+    unsigned long seq = cgr101_measure_start(info, chan_mask);
+
+    cgr101_digitizer_fetch_seq(info,
+                               SCOPE_OUTPUT_MEAS_VOLT,
+                               cgr101_keyword_lookup(cgr101_volt_func_map,
+                                                     func),
+                               chan_mask,
+                               seq);
 }
 
-static void cgr101_digitizer_set_range(struct info *info,int chan)
+void cgr101_fetch_time(struct info *info, const char *func, long chan_mask)
 {
-    int err;
-    int low_range = (info->device->scope.channel[chan].input_low >= -2.5 &&
-                     info->device->scope.channel[chan].input_high <= 2.5);
-    assert(chan >= 0 && chan < SCOPE_NUM_CHAN);
-    assert(low_range >= 0 && low_range < SCOPE_NUM_RANGE);
-    info->device->scope.channel[chan].input_low_range = low_range;
-    err = cgr101_device_printf(info, "S P %c\n",
-                               cgr101_range_cmd[chan][low_range]);
-    assert(!err);
+    cgr101_digitizer_fetch(info,
+                           SCOPE_OUTPUT_MEAS_TIME,
+                           cgr101_keyword_lookup(cgr101_time_func_map, func),
+                           chan_mask);
 }
 
-static int cgr101_sweep_time(struct info *info, double time)
+void cgr101_measure_time(struct info *info, const char *func, long chan_mask)
 {
-    double sweep_time = SCOPE_MIN_SWEEP_TIME;
-    double sweep_time2 = sweep_time * 2.0;
-    int sweep_div;
-    int err = 1;
+    unsigned long seq = cgr101_measure_start(info, chan_mask);
 
-    for (sweep_div = 0; sweep_div <= SCOPE_SR_DIV_MAX; sweep_div++) {
-        if (time >= sweep_time && time < sweep_time2) {
-            break;
-        }
-        sweep_time = sweep_time2;
-        sweep_time2 = sweep_time * 2.0;
-    }
+    cgr101_digitizer_fetch_seq(info,
+                               SCOPE_OUTPUT_MEAS_TIME,
+                               cgr101_keyword_lookup(cgr101_time_func_map,
+                                                     func),
+                               chan_mask,
+                               seq);
+}
 
-    if (sweep_div >= 0 && sweep_div <= SCOPE_SR_DIV_MAX) {
-        info->device->scope.sweep_time = sweep_time;
-        info->device->scope.sample_rate_divisor = sweep_div;
-        err = 0;
+/* Index of the one trace in chan_mask. */
+static int cgr101_trace_index(long chan_mask)
+{
+    int chan = 0;
+
+    assert(chan_mask != 0 && (chan_mask & (chan_mask - 1)) == 0);
+    assert((chan_mask & ~(SCOPE_CHAN_MASK | SCOPE_MATH_MASK)) == 0);
+    while (!(chan_mask & 1L<<chan)) {
+        chan++;
     }
 
-    return err;
+    return chan;
 }
 
-static void cgr101_digitizer_data_pending(struct info *info, long chan_mask)
+void cgr101_fetch_pair(struct info *info,
+                       const char *func,
+                       long a_mask,
+                       long b_mask)
 {
-    info->block_input = 1;
-    info->device->scope.output_pending = 1;
-    info->device->scope.output_mask = chan_mask;
+    info->device->scope.output_pair[0] = cgr101_trace_index(a_mask);
+    info->device->scope.output_pair[1] = cgr101_trace_index(b_mask);
+    cgr101_digitizer_fetch(info,
+                           SCOPE_OUTPUT_PAIR,
+                           cgr101_keyword_lookup(cgr101_pair_func_map, func),
+                           a_mask | b_mask);
 }
 
+void cgr101_measure_pair(struct info *info,
+                         const char *func,
+                         long a_mask,
+                         long b_mask)
+{
+    unsigned long seq = cgr101_measure_start(info, a_mask | b_mask);
 
-/*
- * Initialization
- */
+    info->device->scope.output_pair[0] = cgr101_trace_index(a_mask);
+    info->device->scope.output_pair[1] = cgr101_trace_index(b_mask);
+    cgr101_digitizer_fetch_seq(info,
+                               SCOPE_OUTPUT_PAIR,
+                               cgr101_keyword_lookup(cgr101_pair_func_map,
+                                                     func),
+                               a_mask | b_mask,
+                               seq);
+}
 
-static void cgr101_device_reset(struct info *info)
+void cgr101_spectrum_dataq(struct info *info, long chan_mask)
 {
-    int chan;
-    double midpoint = (double)SCOPE_NUM_SAMPLE/2;
-    int err;
+    cgr101_digitizer_fetch(info,
+                           SCOPE_OUTPUT_SPECTRUM,
+                           (int)info->device->scope.fft_window,
+                           chan_mask);
+}
 
-    /*Consistency check*/
-    assert(COUNT_OF(info->device->scope.channel) == SCOPE_NUM_CHAN);
-    /* Set Defaults */
-    info->device->scope.trigger_offset = 0;
-    info->device->scope.trigger_ref = midpoint;
-    err = cgr101_sweep_time(info, SCOPE_MIN_SWEEP_TIME);
-    assert(!err);
-    for (chan=0; chan<SCOPE_NUM_CHAN; chan++) {
-        info->device->scope.channel[chan].enable = 0;
-        info->device->scope.channel[chan].input_low = SCOPE_DEFAULT_LOW;
-        info->device->scope.channel[chan].input_high = SCOPE_DEFAULT_HIGH;
-        info->device->scope.channel[chan].input_midpoint =
-            SCOPE_DEFAULT_MIDPOINT;
-        info->device->scope.channel[chan].input_ptp = SCOPE_DEFAULT_PTP;
-        /* Force */
-        info->device->scope.channel[chan].input_low_range = 0;
+/* Bin spacing in Hz: bin k is at k/sweep_time. */
+void cgr101_spectrum_stepq(struct info *info)
+{
+    const struct capture *cap = &info->device->scope.capture;
+    double sweep_time = info->device->scope.sweep_time;
+
+    if (cap->seq != 0) {
+        /* Describe the sweep the spectrum is computed from. */
+        sweep_time = cap->sweep_time;
     }
+    scpi_output_fp(info->output, 1.0/sweep_time);
 }
 
-static void cgr101_device_init(struct info *info)
+void cgr101_spectrum_window(struct info *info, const char *value)
 {
-    int chan;
+    info->device->scope.fft_window =
+        (enum fft_window)cgr101_keyword_lookup(cgr101_window_map, value);
+}
 
-    cgr101_device_reset(info);
-    for (chan=0; chan<SCOPE_NUM_CHAN; chan++) {
-        cgr101_digitizer_set_range(info, chan);
-    }
+void cgr101_spectrum_windowq(struct info *info)
+{
+    const char *str = NULL;
 
-    /* Query device for offsets. Send as an event to allow any stale
-     data still being sent by the device to be flushed. */
-    if (info->device->scope.offset_state != STATE_SCOPE_OFFSET_EXPECT_A_HIGH) {
-        event_send(info->event, EVENT_SCOPE_OFFSET_START);
+    switch (info->device->scope.fft_window) {
+    case FFT_WINDOW_HANN:
+        str = "HANN";
+        break;
+    case FFT_WINDOW_FLATTOP:
+        str = "FLAT";
+        break;
+    case FFT_WINDOW_BHARRIS:
+        str = "BHAR";
+        break;
+    default:
+        assert(0);
     }
-    info->offset_status = 1; /* Cleared when all offsets received. */
+    scpi_output_str(info->output, str);
 }
 
-/*
- * PWM Programming
- */
+void cgr101_filter(struct info *info, int value)
+{
+    info->device->scope.filter_enable = value;
+}
 
-static void cgr101_pwm_duty_cycle(struct info *info, double value)
+void cgr101_filterq(struct info *info)
 {
-    int err;
-    int n;
+    scpi_output_int(info->output, info->device->scope.filter_enable);
+}
 
-    n = (int)floor(value*255.0);
-    info->device->pwm.duty_cycle = (double)n/255.0;
-    err = cgr101_device_printf(info, "D D %d\n", n);
-    assert(!err);
+void cgr101_filter_type(struct info *info, const char *value)
+{
+    info->device->scope.filter.type =
+        (enum filter_type)cgr101_keyword_lookup(cgr101_filter_type_map, value);
+    cgr101_filter_invalidate(info);
 }
 
-static void cgr101_pwm_frequency(struct info *info, double value)
+void cgr101_filter_typeq(struct info *info)
 {
-    int err;
-    size_t idx;
-    size_t last;
-    double f1;
-    double f2;
+    const char *str = NULL;
 
-    /* Don't include sentinel in iteration. */
-    last = COUNT_OF(cgr101_pwm_freq)-1;
-    for (idx=0; idx < last; idx++) {
-        f1 = cgr101_pwm_freq[idx];
-        f2 = cgr101_pwm_freq[idx+1];
-        if (value <= f1 && value > f2) {
-            info->device->pwm.frequency = f1;
-            break;
-        }
+    switch (info->device->scope.filter.type) {
+    case FILTER_LPASS:
+        str = "LPAS";
+        break;
+    case FILTER_HPASS:
+        str = "HPAS";
+        break;
+    case FILTER_BPASS:
+        str = "BPAS";
+        break;
+    default:
+        assert(0);
     }
-    err = cgr101_device_printf(info, "D F %zu\n", idx);
-    assert(!err);
+    scpi_output_str(info->output, str);
+}
 
+void cgr101_filter_form(struct info *info, const char *value)
+{
+    info->device->scope.filter.form =
+        (enum filter_form)cgr101_keyword_lookup(cgr101_filter_form_map, value);
+    cgr101_filter_invalidate(info);
 }
 
+void cgr101_filter_formq(struct info *info)
+{
+    scpi_output_str(info->output,
+                    info->device->scope.filter.form == FILTER_IIR ?
+                    "IIR" : "FIR");
+}
 
 /*
- * Device Open/Close
+ * Cutoff, or band edges f1 < f2 for the band pass; f2 of 0 leaves the
+ * upper edge alone. f2 > f1 always holds so any type can be selected.
  */
-
-int cgr101_open(struct info *info)
+void cgr101_filter_frequency(struct info *info, double f1, double f2)
 {
-    int err;
-    struct cgr101 *cgr101;
+    struct filter_spec *filter = &info->device->scope.filter;
 
-    cgr101 = calloc(1,sizeof(*cgr101));
-    assert(cgr101);
-    if (info->debug && strchr(info->debug,'E')) {
-        info->emulation = 1;
+    if (!(f1 > 0.0) || (f2 != 0.0 && !(f2 > f1))) {
+        scpi_error(info->error, SCPI_ERR_DATA_OUT_OF_RANGE, NULL);
+        return;
     }
-
-    info->device = cgr101;
-
-    do {
-        err = spawn(CMD, &info->device->child);
-        if (err) {
-            break;
+    if (f2 == 0.0 && !(filter->f2 > f1)) {
+        if (filter->type == FILTER_BPASS) {
+            /* Would leave an empty band. */
+            scpi_error(info->error, SCPI_ERR_SETTINGS_CONFLICT, NULL);
+            return;
         }
+        f2 = f1 * 10.0;
+    }
+    filter->f1 = f1;
+    if (f2 != 0.0) {
+        filter->f2 = f2;
+    }
+    cgr101_filter_invalidate(info);
+}
 
-        err = worker_add(
-            info->worker,
-            info->device->child.stdout,
-            cgr101_out,
-            info);
-        if (err) {
-            break;
-        }
+void cgr101_filter_frequencyq(struct info *info)
+{
+    scpi_output_fp(info->output, info->device->scope.filter.f1);
+    scpi_output_fp(info->output, info->device->scope.filter.f2);
+}
 
-        err = worker_add(
-            info->worker,
-            info->device->child.stderr,
-            cgr101_err,
-            info);
-        if (err) {
-            break;
-        }
+void cgr101_filter_taps(struct info *info, long value)
+{
+    if (value < 3 || value > FILTER_MAX_TAPS || !(value & 1)) {
+        scpi_error(info->error, SCPI_ERR_DATA_OUT_OF_RANGE, NULL);
+        return;
+    }
+    info->device->scope.filter.taps = (int)value;
+    cgr101_filter_invalidate(info);
+}
 
-        cgr101_event_init(info);
+void cgr101_filter_tapsq(struct info *info)
+{
+    scpi_output_int(info->output, info->device->scope.filter.taps);
+}
 
-        /* Initialize device. */
-        cgr101_device_init(info);
-    } while (0);
+void cgr101_math_function(struct info *info,
+                          long chan_mask,
+                          const char *value)
+{
+    int func = cgr101_keyword_lookup(cgr101_math_func_map, value);
+    int m;
 
-    return err;
+    for (m=0; m<SCOPE_NUM_MATH; m++) {
+        if (chan_mask & 1L<<(SCOPE_MATH_FIRST + m)) {
+            info->device->scope.math[m].func = (enum mathchan_func)func;
+        }
+    }
+    cgr101_math_invalidate(info);
 }
 
-int cgr101_close(struct info *info)
+void cgr101_math_functionq(struct info *info, long chan_mask)
 {
-    unspawn(&info->device->child);
-    if (info->device) {
-        free(info->device);
-    }
+    const char *str = NULL;
+    int m;
 
-    return 0;
+    for (m=0; m<SCOPE_NUM_MATH; m++) {
+        if (!(chan_mask & 1L<<(SCOPE_MATH_FIRST + m))) {
+            continue;
+        }
+        switch (info->device->scope.math[m].func) {
+        case MATHCHAN_OFF:
+            str = "OFF";
+            break;
+        case MATHCHAN_ADD:
+            str = "ADD";
+            break;
+        case MATHCHAN_SUB:
+            str = "SUBT";
+            break;
+        case MATHCHAN_MUL:
+            str = "MULT";
+            break;
+        case MATHCHAN_DIV:
+            str = "DIV";
+            break;
+        case MATHCHAN_INT:
+            str = "INT";
+            break;
+        case MATHCHAN_DER:
+            str = "DER";
+            break;
+        default:
+            assert(0);
+        }
+        scpi_output_str(info->output, str);
+    }
 }
 
-/*
- * SCPI Interfaces
- */
-
-int cgr101_initiate(struct info *info)
+/* a and b are one based channel numbers. */
+void cgr101_math_source(struct info *info, long chan_mask, long a, long b)
 {
-    int err;
+    int m;
 
-    if (info->device->digital_read_requested) {
-        err = cgr101_digital_read_start(info);
-        assert(!err);
+    assert(a >= 1 && a <= SCOPE_NUM_CHAN);
+    assert(b >= 1 && b <= SCOPE_NUM_CHAN);
+    for (m=0; m<SCOPE_NUM_MATH; m++) {
+        if (chan_mask & 1L<<(SCOPE_MATH_FIRST + m)) {
+            info->device->scope.math[m].a = (int)a - 1;
+            info->device->scope.math[m].b = (int)b - 1;
+        }
     }
+    cgr101_math_invalidate(info);
+}
 
-    if (info->device->scope.channel[0].enable ||
-        info->device->scope.channel[1].enable) {
-        err = cgr101_digitizer_start(info, 0);
-        assert(!err);
-    }
+void cgr101_math_sourceq(struct info *info, long chan_mask)
+{
+    int m;
 
-    if (info->device->event.chan_mask & INTERRUPT_CHANNEL_MASK) {
-        cgr101_interrupt_mode(info);
+    for (m=0; m<SCOPE_NUM_MATH; m++) {
+        if (chan_mask & 1L<<(SCOPE_MATH_FIRST + m)) {
+            scpi_output_int(info->output, info->device->scope.math[m].a + 1);
+            scpi_output_int(info->output, info->device->scope.math[m].b + 1);
+        }
     }
+}
 
-    if (info->device->event.chan_mask & DIGITAL_DATA_CHANNEL_MASK) {
-        cgr101_digital_auto_update(info);
-    }
+void cgr101_math_scale(struct info *info, long chan_mask, double value)
+{
+    int m;
 
-    if ((info->device->event.chan_mask) != 0) {
-        info->digital_event_status = 1;
+    for (m=0; m<SCOPE_NUM_MATH; m++) {
+        if (chan_mask & 1L<<(SCOPE_MATH_FIRST + m)) {
+            info->device->scope.math[m].scale = value;
+        }
     }
-
-    return 0;
+    cgr101_math_invalidate(info);
 }
 
-int cgr101_initiate_immediate(struct info *info)
+void cgr101_math_scaleq(struct info *info, long chan_mask)
 {
-    int err;
+    int m;
 
-    if (info->device->digital_read_requested) {
-        err = cgr101_digital_read_start(info);
-        assert(!err);
+    for (m=0; m<SCOPE_NUM_MATH; m++) {
+        if (chan_mask & 1L<<(SCOPE_MATH_FIRST + m)) {
+            scpi_output_fp(info->output, info->device->scope.math[m].scale);
+        }
     }
+}
 
-    if (info->device->scope.channel[0].enable ||
-        info->device->scope.channel[1].enable) {
-        err = cgr101_digitizer_start(info, 1);
-        assert(!err);
-    }
+void cgr101_math_offset(struct info *info, long chan_mask, double value)
+{
+    int m;
 
-    return 0;
+    for (m=0; m<SCOPE_NUM_MATH; m++) {
+        if (chan_mask & 1L<<(SCOPE_MATH_FIRST + m)) {
+            info->device->scope.math[m].offset = value;
+        }
+    }
+    cgr101_math_invalidate(info);
 }
 
-int cgr101_configure_digital_data(struct info *info)
+void cgr101_math_offsetq(struct info *info, long chan_mask)
 {
-    info->device->digital_read_requested = 1;
+    int m;
 
-    return 0;
+    for (m=0; m<SCOPE_NUM_MATH; m++) {
+        if (chan_mask & 1L<<(SCOPE_MATH_FIRST + m)) {
+            scpi_output_fp(info->output, info->device->scope.math[m].offset);
+        }
+    }
 }
 
-int cgr101_digital_data_configured(struct info *info)
+void cgr101_mask(struct info *info, int value)
 {
-    return info->device->digital_read_requested;
+    info->device->scope.mask_enable = value;
 }
 
-void cgr101_fetch_digital_data(struct info *info)
+void cgr101_maskq(struct info *info)
 {
-    event_send(info->event, EVENT_DIGITAL_READ_OUTPUT);
+    scpi_output_int(info->output, info->device->scope.mask_enable);
 }
 
-void cgr101_source_digital_data(struct info *info, int value)
+/* A single value applies to every sample. */
+void cgr101_mask_limit(struct info *info,
+                       int upper,
+                       long chan_mask,
+                       size_t len,
+                       const double *value)
 {
-    int err;
+    double *limit;
+    unsigned int j;
+    int chan;
 
-    info->device->digital_write_data = value;
-    err = cgr101_device_printf(info, "D O %d\n", value);
-    assert(!err);
+    if (len != 1 && len != SCOPE_NUM_SAMPLE) {
+        scpi_error(info->error, SCPI_ERR_DATA_OUT_OF_RANGE, NULL);
+        return;
+    }
+
+    for (chan=0; chan<SCOPE_NUM_CHAN; chan++) {
+        if (!(chan_mask & 1<<chan)) {
+            continue;
+        }
+        limit = upper ?
+            info->device->scope.channel[chan].mask_upper :
+            info->device->scope.channel[chan].mask_lower;
+        for (j=0; j<SCOPE_NUM_SAMPLE; j++) {
+            limit[j] = value[(len == 1) ? 0 : j];
+        }
+    }
+    cgr101_mask_update(info);
 }
 
-void cgr101_source_digital_dataq(struct info *info)
+void cgr101_mask_limitq(struct info *info, int upper, long chan_mask)
 {
-    scpi_output_int(info->output, info->device->digital_write_data);
+    const double *limit;
+    unsigned int j;
+    int chan;
+
+    for (chan=0; chan<SCOPE_NUM_CHAN; chan++) {
+        if (!(chan_mask & 1<<chan)) {
+            continue;
+        }
+        limit = upper ?
+            info->device->scope.channel[chan].mask_upper :
+            info->device->scope.channel[chan].mask_lower;
+        for (j=0; j<SCOPE_NUM_SAMPLE; j++) {
+            scpi_output_fp(info->output, limit[j]);
+        }
+    }
 }
 
-#define K1 0.09313225746
-void cgr101_source_waveform_frequency(struct info *info, double value)
+void cgr101_mask_failq(struct info *info)
 {
-    int phase_incr = (int)floor(value/K1);
-    int f0 = (phase_incr >> 24) & 0xff;
-    int f1 = (phase_incr >> 16) & 0xff;
-    int f2 = (phase_incr >>  8) & 0xff;
-    int f3 = (phase_incr)       & 0xff;
-    int err;
+    scpi_output_int(info->output, info->device->scope.mask_fail);
+}
 
-    err = cgr101_device_printf(info, "W F %d %d %d %d\n", f0, f1, f2, f3);
-    assert(!err);
-    info->device->waveform.frequency = value;
+/* Sweeps tested, sweeps failed, samples outside the mask. */
+void cgr101_mask_countq(struct info *info)
+{
+    scpi_output_printf(info->output, "%lu", info->device->scope.mask_sweeps);
+    scpi_output_printf(info->output, "%lu",
+                       info->device->scope.mask_failures);
+    scpi_output_printf(info->output, "%lu", info->device->scope.mask_hits);
 }
 
-void cgr101_source_waveform_frequencyq(struct info *info)
+void cgr101_mask_clear(struct info *info)
 {
-    scpi_output_fp(info->output, info->device->waveform.frequency);
+    cgr101_mask_stats_reset(info);
 }
 
-void cgr101_source_waveform_level(struct info *info, double value)
+void cgr101_mask_stop(struct info *info, int value)
 {
-    int err;
-    int amp;
+    info->device->scope.mask_stop = value;
+}
 
-    if (value >= 0.0 && value <= 1.0) {
-        info->device->waveform.amplitude = value;
-        amp = (int)floor(value * 255.0);
-        assert(amp >= 0);
-        assert(amp <= 255);
-        err = cgr101_device_printf(info, "W A %d\n", amp);
-        assert(!err);
+void cgr101_mask_stopq(struct info *info)
+{
+    scpi_output_int(info->output, info->device->scope.mask_stop);
+}
+
+void cgr101_mask_keep(struct info *info, const char *value)
+{
+    assert(value);
+    if (!strcasecmp(value, "ALL")) {
+        info->device->scope.mask_keep_fail = 0;
+    } else if (!strcasecmp(value, "FAIL")) {
+        info->device->scope.mask_keep_fail = 1;
     } else {
-        /* Range error */
+        assert(0);
     }
 }
 
-void cgr101_source_waveform_levelq(struct info *info)
+void cgr101_mask_keepq(struct info *info)
 {
-    scpi_output_fp(info->output, info->device->waveform.amplitude);
+    scpi_output_str(info->output,
+                    info->device->scope.mask_keep_fail ? "FAIL" : "ALL");
 }
 
-void cgr101_source_waveform_function(struct info *info,
-                                     const char *value)
+void cgr101_hist(struct info *info, int value)
 {
-    enum cgr101_waveform_shape shape;
+    info->device->scope.hist_enable = value;
+}
 
-    cgr101_waveform_lookup(value, &shape);
-    if (shape != WAV_NONE) {
-        cgr101_waveform_create(info, shape);
-        cgr101_waveform_program(info);
-    }
+void cgr101_histq(struct info *info)
+{
+    scpi_output_int(info->output, info->device->scope.hist_enable);
 }
 
-void cgr101_source_waveform_functionq(struct info *info)
+void cgr101_hist_dataq(struct info *info, long chan_mask)
 {
-    const char *name;
+    const uint64_t *hist;
+    int chan;
+    int code;
 
-    name = cgr101_waveform_name(info->device->waveform.shape);
-    assert(name);
-    scpi_output_str(info->output, name);
+    for (chan=0; chan<SCOPE_NUM_CHAN; chan++) {
+        if (!(chan_mask & 1<<chan)) {
+            continue;
+        }
+        hist = info->device->scope.channel[chan].hist;
+        for (code=0; code<CODE10_SIZE; code++) {
+            scpi_output_printf(info->output,
+                               "%llu",
+                               (unsigned long long)hist[code]);
+        }
+    }
 }
 
-void cgr101_source_waveform_user(struct info *info, size_t len, double *data)
+void cgr101_hist_countq(struct info *info)
 {
-    info->device->waveform.shape = WAV_USER;
-    cgr101_waveform_user(info, len, data);
-    cgr101_waveform_program(info);
+    scpi_output_printf(info->output, "%lu", info->device->scope.hist_sweeps);
 }
 
-void cgr101_source_waveform_userq(struct info *info)
+void cgr101_hist_clear(struct info *info)
 {
-    cgr101_waveform_userq(info);
+    cgr101_hist_reset(info);
 }
 
-void cgr101_source_pwm_duty_cycle(struct info *info, double value)
+/* Mean or standard deviation of each channel's samples. */
+void cgr101_hist_statq(struct info *info, int sdev, long chan_mask)
 {
-    cgr101_pwm_duty_cycle(info, value);
+    struct meas_scale scale;
+    struct meas_histogram m;
+    int chan;
+
+    for (chan=0; chan<SCOPE_NUM_CHAN; chan++) {
+        if (!(chan_mask & 1<<chan)) {
+            continue;
+        }
+        cgr101_hist_scale(info, chan, &scale);
+        meas_histogram(info->device->scope.channel[chan].hist, &scale, &m);
+        scpi_output_fp(info->output, sdev ? m.sdev : m.mean);
+    }
 }
 
-void cgr101_source_pwm_duty_cycleq(struct info *info)
+void cgr101_hist_percentq(struct info *info, double pct, long chan_mask)
 {
-    scpi_output_fp(info->output, info->device->pwm.duty_cycle);
+    struct meas_scale scale;
+    int chan;
+
+    for (chan=0; chan<SCOPE_NUM_CHAN; chan++) {
+        if (!(chan_mask & 1<<chan)) {
+            continue;
+        }
+        cgr101_hist_scale(info, chan, &scale);
+        scpi_output_fp(info->output,
+                       meas_histogram_percentile(
+                           info->device->scope.channel[chan].hist,
+                           &scale,
+                           pct));
+    }
 }
 
-void cgr101_source_pwm_frequency(struct info *info, double value)
+void cgr101_history_depth(struct info *info, long value)
 {
-    cgr101_pwm_frequency(info, value);
+    if (history_resize(info->device->scope.history, (size_t)value)) {
+        scpi_error(info->error, SCPI_ERR_DATA_OUT_OF_RANGE, NULL);
+    }
 }
 
-void cgr101_source_pwm_frequencyq(struct info *info)
+void cgr101_history_depthq(struct info *info)
 {
-    scpi_output_fp(info->output, info->device->pwm.frequency);
+    scpi_output_int(info->output,
+                    (int)history_depth(info->device->scope.history));
 }
 
-void cgr101_digitizer_coupling(struct info *info, const char *value)
+void cgr101_history_sequenceq(struct info *info)
 {
-    (void)info;
-    (void)value;
+    struct history *history = info->device->scope.history;
+
+    scpi_output_printf(info->output, "%lu", history_first(history));
+    scpi_output_printf(info->output, "%lu", history_last(history));
 }
 
-void cgr101_digitizer_dataq(struct info *info, long chan_mask)
+/*
+ * Output the retained captures after sequence number 'after', each
+ * preceded by its sequence.
+ */
+static void cgr101_history_output(struct info *info,
+                                  unsigned long after,
+                                  long chan_mask)
+{
+    struct history *history = info->device->scope.history;
+    const struct capture *cap;
+    unsigned long seq;
+
+    for (seq=history_next(history, after);
+         seq!=0;
+         seq=history_next(history, seq)) {
+        cap = history_find(history, seq);
+        assert(cap);
+        scpi_output_printf(info->output, "%lu", seq);
+        cgr101_digitizer_capture_output(info,
+                                        cap,
+                                        0,
+                                        SCOPE_NUM_SAMPLE,
+                                        chan_mask & SCOPE_CHAN_MASK);
+    }
+}
+
+void cgr101_history_dataq(struct info *info, long seq, long chan_mask)
 {
-    if (info->sweep_status) {
-        cgr101_digitizer_data_pending(info, chan_mask);
+    const struct capture *cap;
+
+    cap = history_find(info->device->scope.history, (unsigned long)seq);
+    if (cap) {
+        cgr101_digitizer_capture_output(info,
+                                        cap,
+                                        0,
+                                        SCOPE_NUM_SAMPLE,
+                                        chan_mask & SCOPE_CHAN_MASK);
     } else {
-        cgr101_digitizer_data_output(info, chan_mask);
+        scpi_error(info->error, SCPI_ERR_DATA_STALE, NULL);
     }
 }
 
+void cgr101_history_latestq(struct info *info, long count, long chan_mask)
+{
+    /* After the one just older than the newest 'count'; 0 if none. */
+    cgr101_history_output(info,
+                          history_nth(info->device->scope.history,
+                                      (size_t)count),
+                          chan_mask);
+}
+
+void cgr101_history_sinceq(struct info *info, long seq, long chan_mask)
+{
+    /* Anything older than the first retained capture is gone; the gap
+     * in the returned sequence numbers tells the client what was lost.
+     */
+    cgr101_history_output(info, (unsigned long)seq, chan_mask);
+}
+
 void cgr101_digitizer_concurrent(struct info *info, int value)
 {
     (void)info;
@@ -2199,6 +5057,41 @@ void cgr101_digitizer_voltage_up(struct info *info,
     }
 }
 
+void cgr101_digitizer_range_auto(struct info *info,
+                                 long chan_mask,
+                                 int value)
+{
+    int chan;
+
+    for (chan=0; chan<SCOPE_NUM_CHAN; chan++) {
+        if (chan_mask & 1<<chan) {
+            info->device->scope.channel[chan].range_auto = value;
+        }
+    }
+}
+
+void cgr101_digitizer_range_autoq(struct info *info, long chan_mask)
+{
+    int chan;
+
+    for (chan=0; chan<SCOPE_NUM_CHAN; chan++) {
+        if (chan_mask & 1<<chan) {
+            scpi_output_int(info->output,
+                            info->device->scope.channel[chan].range_auto);
+        }
+    }
+}
+
+void cgr101_digitizer_range_auto_fraction(struct info *info, double value)
+{
+    info->device->scope.range_auto_frac = value;
+}
+
+void cgr101_digitizer_range_auto_fractionq(struct info *info)
+{
+    scpi_output_fp(info->output, info->device->scope.range_auto_frac);
+}
+
 void cgr101_digitizer_lowq(struct info *info, long chan_mask)
 {
     int chan;
@@ -2280,6 +5173,7 @@ void cgr101_digitizer_input_offset(struct info *info,
     info->device->scope.channel[0].offset_high = f2;
     info->device->scope.channel[1].offset_low  = f3;
     info->device->scope.channel[1].offset_high = f4;
+    cgr101_digitizer_volts_update(info);
 }
 
 void cgr101_digitizer_input_offset_store(struct info *info)
@@ -2307,6 +5201,15 @@ void cgr101_digitizer_input_offset_store(struct info *info)
                               STEP_LOW,
                               0.0);
 
+    if (v1 < 0 || v1 > CODE8_MASK ||
+        v2 < 0 || v2 > CODE8_MASK ||
+        v3 < 0 || v3 > CODE8_MASK ||
+        v4 < 0 || v4 > CODE8_MASK) {
+        /* Not representable; leave the stored offsets alone. */
+        scpi_error(info->error, SCPI_ERR_DATA_OUT_OF_RANGE, NULL);
+        return;
+    }
+
     if (info->enable_flash_writes) {
         err = cgr101_device_printf(info, "S F %d %d %d %d\n", v1, v2, v3, v4);
         assert(!err);
@@ -2317,6 +5220,58 @@ void cgr101_digitizer_input_offset_store(struct info *info)
     }
 }
 
+/* Zero the input offsets of both channels on both ranges. */
+void cgr101_cal_zero(struct info *info, int store)
+{
+    int err;
+
+    if (info->sweep_status) {
+        scpi_error(info->error, SCPI_ERR_SETTINGS_CONFLICT, NULL);
+        return;
+    }
+
+    info->device->scope.cal_store = store;
+    info->cal_status = 1;
+    cgr101_cal_range(info, 0);
+    err = cgr101_digitizer_start(info, 1);
+    assert(!err);
+}
+
+/* Pick ranges and sweep time to suit the signals present. */
+void cgr101_autoscale(struct info *info)
+{
+    int chan;
+    int err;
+
+    if (info->sweep_status) {
+        scpi_error(info->error, SCPI_ERR_SETTINGS_CONFLICT, NULL);
+        return;
+    }
+
+    info->range_status = 1;
+    info->device->scope.auto_step = 0;
+    info->device->scope.auto_lo = 0;
+    info->device->scope.auto_hi = SCOPE_SR_DIV_MAX;
+    info->device->scope.auto_divisor =
+        info->device->scope.sample_rate_divisor;
+    for (chan=0; chan<SCOPE_NUM_CHAN; chan++) {
+        cgr101_auto_range(info, chan, 0);
+    }
+    err = cgr101_digitizer_start(info, 1);
+    assert(!err);
+}
+
+void cgr101_cal_zero_count(struct info *info, long value)
+{
+    assert(value >= 1 && value <= CGR101_CAL_MAX_COUNT);
+    info->device->scope.cal_count = (int)value;
+}
+
+void cgr101_cal_zero_countq(struct info *info)
+{
+    scpi_output_int(info->output, info->device->scope.cal_count);
+}
+
 void cgr101_digitizer_input_offsetq(struct info *info)
 {
     scpi_output_fp(info->output, info->device->scope.channel[0].offset_low);
@@ -2325,6 +5280,78 @@ void cgr101_digitizer_input_offsetq(struct info *info)
     scpi_output_fp(info->output, info->device->scope.channel[1].offset_high);
 }
 
+/*
+ * Log every published capture to a new file, replacing any log open.
+ * Started with -l dir, path is a plain file name in that directory.
+ * An existing file is never overwritten.
+ */
+void cgr101_log(struct info *info, const char *path)
+{
+    char name[PATH_MAX];
+    struct binlog *log;
+    int len;
+
+    if (info->log_dir) {
+        if (*path == 0 || *path == '.' || strchr(path, '/')) {
+            scpi_error(info->error, SCPI_ERR_ILLEGAL_PARAMETER_VALUE, path);
+            return;
+        }
+        len = snprintf(name, sizeof(name), "%s/%s", info->log_dir, path);
+        if (len < 0 || (size_t)len >= sizeof(name)) {
+            scpi_error(info->error, SCPI_ERR_ILLEGAL_PARAMETER_VALUE, path);
+            return;
+        }
+        path = name;
+    }
+
+    log = binlog_open(path, info->device->scope.binlog_packed);
+    if (!log) {
+        /* Any log already open carries on. */
+        scpi_error(info->error, SCPI_ERR_MASS_STORAGE_ERROR, strerror(errno));
+        return;
+    }
+    cgr101_log_stop(info);
+    info->device->scope.binlog = log;
+}
+
+void cgr101_log_stop(struct info *info)
+{
+    int err;
+
+    if (info->device->scope.binlog) {
+        err = binlog_close(info->device->scope.binlog);
+        info->device->scope.binlog = NULL;
+        if (err) {
+            scpi_error(info->error, SCPI_ERR_MASS_STORAGE_ERROR,
+                       strerror(err));
+        }
+    }
+}
+
+/* Captures written and dropped by the log open, if any. */
+void cgr101_logq(struct info *info)
+{
+    unsigned long written = 0;
+    unsigned long dropped = 0;
+
+    if (info->device->scope.binlog) {
+        written = binlog_written(info->device->scope.binlog);
+        dropped = binlog_dropped(info->device->scope.binlog);
+    }
+    scpi_output_printf(info->output, "%lu,%lu", written, dropped);
+}
+
+/* Pack the captures of logs started from now on. */
+void cgr101_log_compress(struct info *info, int value)
+{
+    info->device->scope.binlog_packed = value;
+}
+
+void cgr101_log_compressq(struct info *info)
+{
+    scpi_output_int(info->output, info->device->scope.binlog_packed);
+}
+
 void cgr101_trigger_coupling(struct info *info, const char *value)
 {
     /* Ignore for now. */
@@ -2431,6 +5458,15 @@ void cgr101_rst(struct info *info)
 void cgr101_abort(struct info *info)
 {
     /* Scope */
+    info->device->scope.continuous = 0;
+    cgr101_digitizer_average_reset(info);
+    if (info->device->scope.cal_range >= 0) {
+        /* Abandon calibration; the offsets are as they were. */
+        cgr101_cal_end(info);
+    }
+    if (info->device->scope.auto_step >= 0) {
+        cgr101_auto_end(info, 1);
+    }
     if (info->sweep_status) {
         cgr101_scope_data_done(info, STATE_SCOPE_DATA_IDLE);
     }
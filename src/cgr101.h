@@ -11,13 +11,20 @@
 #include "info.h"
 
 #define CGR101_MIN_CHAN 1
-#define CGR101_MAX_CHAN 7
+#define CGR101_MAX_CHAN 9
+#define CGR101_NUM_SCOPE 2      /* oscilloscope channels, from 1 */
+#define CGR101_MATH_CHAN 8      /* first math channel */
+#define CGR101_NUM_MATH 2
+#define CGR101_CAL_MAX_COUNT 1024 /* CALibration:ZERO:COUNt limit */
+#define CGR101_RANGE_AUTO_MAX_FRAC 0.09 /* under the low range's 2.5 V */
 
 extern int cgr101_identify(struct info *info);
 extern int cgr101_open(struct info *info);
 extern int cgr101_close(struct info *info);
 extern int cgr101_initiate(struct info *info);
 extern int cgr101_initiate_immediate(struct info *info);
+extern void cgr101_initiate_continuous(struct info *info, int value);
+extern void cgr101_initiate_continuousq(struct info *info);
 extern int cgr101_configure_digital_data(struct info *info);
 extern int cgr101_digital_data_configured(struct info *info);
 extern void cgr101_fetch_digital_data(struct info *info);
@@ -40,6 +47,109 @@ extern void cgr101_source_pwm_frequency(struct info *info, double value);
 extern void cgr101_source_pwm_frequencyq(struct info *info);
 extern void cgr101_digitizer_coupling(struct info *info, const char *value);
 extern void cgr101_digitizer_dataq(struct info *info, long chan_mask);
+extern void cgr101_digitizer_partialq(struct info *info,
+                                      long start,
+                                      long count,
+                                      long chan_mask);
+extern void cgr101_digitizer_decimateq(struct info *info,
+                                       long points,
+                                       const char *mode,
+                                       long chan_mask);
+extern void cgr101_history_depth(struct info *info, long value);
+extern void cgr101_history_depthq(struct info *info);
+extern void cgr101_history_sequenceq(struct info *info);
+extern void cgr101_history_dataq(struct info *info, long seq, long chan_mask);
+extern void cgr101_history_latestq(struct info *info,
+                                   long count,
+                                   long chan_mask);
+extern void cgr101_history_sinceq(struct info *info, long seq, long chan_mask);
+extern void cgr101_fetch_voltage(struct info *info,
+                                 const char *func,
+                                 long chan_mask);
+extern void cgr101_measure_voltage(struct info *info,
+                                   const char *func,
+                                   long chan_mask);
+extern void cgr101_fetch_time(struct info *info,
+                              const char *func,
+                              long chan_mask);
+extern void cgr101_measure_time(struct info *info,
+                                const char *func,
+                                long chan_mask);
+extern void cgr101_fetch_pair(struct info *info,
+                              const char *func,
+                              long a_mask,
+                              long b_mask);
+extern void cgr101_measure_pair(struct info *info,
+                                const char *func,
+                                long a_mask,
+                                long b_mask);
+extern void cgr101_ets(struct info *info, int value);
+extern void cgr101_etsq(struct info *info);
+extern void cgr101_ets_factor(struct info *info, long value);
+extern void cgr101_ets_factorq(struct info *info);
+extern void cgr101_ets_reset(struct info *info);
+extern void cgr101_ets_countq(struct info *info);
+extern void cgr101_ets_fillq(struct info *info);
+extern void cgr101_ets_dataq(struct info *info, long chan_mask);
+extern void cgr101_average(struct info *info, int value);
+extern void cgr101_averageq(struct info *info);
+extern void cgr101_average_count(struct info *info, long value);
+extern void cgr101_average_countq(struct info *info);
+extern void cgr101_spectrum_dataq(struct info *info, long chan_mask);
+extern void cgr101_spectrum_stepq(struct info *info);
+extern void cgr101_spectrum_window(struct info *info, const char *value);
+extern void cgr101_spectrum_windowq(struct info *info);
+extern void cgr101_filter(struct info *info, int value);
+extern void cgr101_filterq(struct info *info);
+extern void cgr101_filter_type(struct info *info, const char *value);
+extern void cgr101_filter_typeq(struct info *info);
+extern void cgr101_filter_form(struct info *info, const char *value);
+extern void cgr101_filter_formq(struct info *info);
+extern void cgr101_filter_frequency(struct info *info, double f1, double f2);
+extern void cgr101_filter_frequencyq(struct info *info);
+extern void cgr101_filter_taps(struct info *info, long value);
+extern void cgr101_filter_tapsq(struct info *info);
+extern void cgr101_math_function(struct info *info,
+                                 long chan_mask,
+                                 const char *value);
+extern void cgr101_math_functionq(struct info *info, long chan_mask);
+extern void cgr101_math_source(struct info *info,
+                               long chan_mask,
+                               long a,
+                               long b);
+extern void cgr101_math_sourceq(struct info *info, long chan_mask);
+extern void cgr101_math_scale(struct info *info, long chan_mask, double value);
+extern void cgr101_math_scaleq(struct info *info, long chan_mask);
+extern void cgr101_math_offset(struct info *info, long chan_mask, double value);
+extern void cgr101_math_offsetq(struct info *info, long chan_mask);
+extern void cgr101_mask(struct info *info, int value);
+extern void cgr101_maskq(struct info *info);
+extern void cgr101_mask_limit(struct info *info,
+                              int upper,
+                              long chan_mask,
+                              size_t len,
+                              const double *value);
+extern void cgr101_mask_limitq(struct info *info, int upper, long chan_mask);
+extern void cgr101_mask_failq(struct info *info);
+extern void cgr101_mask_countq(struct info *info);
+extern void cgr101_mask_clear(struct info *info);
+extern void cgr101_mask_stop(struct info *info, int value);
+extern void cgr101_mask_stopq(struct info *info);
+extern void cgr101_mask_keep(struct info *info, const char *value);
+extern void cgr101_mask_keepq(struct info *info);
+extern void cgr101_hist(struct info *info, int value);
+extern void cgr101_histq(struct info *info);
+extern void cgr101_hist_dataq(struct info *info, long chan_mask);
+extern void cgr101_hist_countq(struct info *info);
+extern void cgr101_hist_clear(struct info *info);
+extern void cgr101_hist_statq(struct info *info, int sdev, long chan_mask);
+extern void cgr101_hist_percentq(struct info *info,
+                                 double pct,
+                                 long chan_mask);
+extern void cgr101_autoscale(struct info *info);
+extern void cgr101_cal_zero(struct info *info, int store);
+extern void cgr101_cal_zero_count(struct info *info, long value);
+extern void cgr101_cal_zero_countq(struct info *info);
 extern void cgr101_digitizer_concurrent(struct info *info, int value);
 extern void cgr101_digitizer_channel_state(struct info *info,
                                            long chan_mask,
@@ -73,6 +183,13 @@ extern void cgr101_digitizer_voltage_range(struct info *info,
 extern void cgr101_digitizer_voltage_up(struct info *info,
                                         long chan_mask,
                                         double value);
+extern void cgr101_digitizer_range_auto(struct info *info,
+                                        long chan_mask,
+                                        int value);
+extern void cgr101_digitizer_range_autoq(struct info *info, long chan_mask);
+extern void cgr101_digitizer_range_auto_fraction(struct info *info,
+                                                 double value);
+extern void cgr101_digitizer_range_auto_fractionq(struct info *info);
 extern void cgr101_digitizer_lowq(struct info *info, long chan_mask);
 extern void cgr101_digitizer_offsetq(struct info *info, long chan_mask);
 extern void cgr101_digitizer_ptpq(struct info *info, long chan_mask);
@@ -88,6 +205,11 @@ extern void cgr101_digitizer_input_offset(struct info *info,
                                           double f4);
 extern void cgr101_digitizer_input_offset_store(struct info *info);
 extern void cgr101_digitizer_input_offsetq(struct info *info);
+extern void cgr101_log(struct info *info, const char *path);
+extern void cgr101_log_stop(struct info *info);
+extern void cgr101_logq(struct info *info);
+extern void cgr101_log_compress(struct info *info, int value);
+extern void cgr101_log_compressq(struct info *info);
 
 extern void cgr101_trigger_coupling(struct info *info,const char *value);
 extern void cgr101_trigger_level(struct info *info, double value);
@@ -96,6 +218,7 @@ extern void cgr101_trigger_slope(struct info *info, const char *value);
 extern void cgr101_trigger_slopeq(struct info *info);
 extern void cgr101_trigger_source(struct info *info, const char *value);
 extern void cgr101_trigger_sourceq(struct info *info);
+extern void cgr101_waveform_preambleq(struct info *info, long chan_mask);
 extern void cgr101_rst(struct info *info);
 extern void cgr101_abort(struct info *info);
 
@@ -0,0 +1,210 @@
+/*
+   codec.c
+
+   Copyright (c) 2026 by Daniel Kelley
+
+*/
+
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+#include "codec.h"
+
+/*
+ * A packed capture is self contained:
+ *
+ *   the struct capture fields ahead of channel[], as is
+ *   per channel:
+ *     low_range, step, offset, as is
+ *     uint16_t n: bytes of packed codes that follow
+ *     packed codes
+ *
+ * Codes are packed as the first code, 16 bits, then the differences
+ * between successive codes, zigzag mapped to unsigned, in blocks of
+ * CODEC_BLOCK. Each block is a byte giving the bit width w of its
+ * largest value followed by CODEC_BLOCK values of w bits, LSB first.
+ * Sweeps are mostly smooth, so w is usually a few bits where the raw
+ * codes take 10; a block of a flat trace takes one byte. Averaged
+ * captures hold sums of up to 64 codes, so a difference can need 17
+ * bits.
+ *
+ * Nothing refers outside the capture, so any one can be unpacked
+ * without the others.
+ */
+
+static uint32_t codec_zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t codec_unzigzag(uint32_t u)
+{
+    return (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+}
+
+static unsigned int codec_width(uint32_t v)
+{
+    unsigned int w = 0;
+
+    while (v) {
+        w++;
+        v >>= 1;
+    }
+
+    return w;
+}
+
+static size_t codec_pack_codes(const uint16_t *code, uint8_t *out)
+{
+    uint32_t z[CODEC_BLOCK];
+    uint32_t any;
+    uint64_t bits;
+    unsigned int nbits;
+    unsigned int w;
+    size_t len = 0;
+    size_t j;
+    size_t k;
+
+    out[len++] = (uint8_t)code[0];
+    out[len++] = (uint8_t)(code[0] >> 8);
+
+    for (j=0; j<CAPTURE_NUM_SAMPLE; j+=CODEC_BLOCK) {
+        any = 0;
+        for (k=0; k<CODEC_BLOCK; k++) {
+            /* The last block's last difference is of nothing. */
+            size_t i = j + k + 1;
+            z[k] = (i < CAPTURE_NUM_SAMPLE) ?
+                codec_zigzag((int32_t)code[i] - (int32_t)code[i-1]) : 0;
+            any |= z[k];
+        }
+        w = codec_width(any);
+        out[len++] = (uint8_t)w;
+
+        bits = 0;
+        nbits = 0;
+        for (k=0; w && k<CODEC_BLOCK; k++) {
+            bits |= (uint64_t)z[k] << nbits;
+            nbits += w;
+            while (nbits >= 8) {
+                out[len++] = (uint8_t)bits;
+                bits >>= 8;
+                nbits -= 8;
+            }
+        }
+        if (nbits) {
+            out[len++] = (uint8_t)bits;
+        }
+    }
+
+    return len;
+}
+
+static int codec_unpack_codes(const uint8_t *in, size_t len, uint16_t *code)
+{
+    const uint8_t *end = in + len;
+    const uint8_t *blk;
+    uint64_t bits;
+    uint64_t mask;
+    unsigned int nbits;
+    unsigned int w;
+    int32_t v;
+    size_t j;
+    size_t k;
+
+    if (len < 2) {
+        return -1;
+    }
+    v = in[0] | (in[1] << 8);
+    in += 2;
+    code[0] = (uint16_t)v;
+
+    for (j=0; j<CAPTURE_NUM_SAMPLE; j+=CODEC_BLOCK) {
+        if (in >= end) {
+            return -1;
+        }
+        w = *in++;
+        if (w > 17 || (size_t)(end - in) < (CODEC_BLOCK*w + 7)/8) {
+            return -1;
+        }
+        blk = in;
+        mask = ((uint64_t)1 << w) - 1;
+        bits = 0;
+        nbits = 0;
+        for (k=0; k<CODEC_BLOCK && j+k+1<CAPTURE_NUM_SAMPLE; k++) {
+            while (nbits < w) {
+                bits |= (uint64_t)*in++ << nbits;
+                nbits += 8;
+            }
+            v += codec_unzigzag((uint32_t)(bits & mask));
+            bits >>= w;
+            nbits -= w;
+            code[j+k+1] = (uint16_t)v;
+        }
+        /* Past any padding; the last block is a difference short. */
+        in = blk + (CODEC_BLOCK*w + 7)/8;
+    }
+
+    return 0;
+}
+
+/* Pack cap into out, at least CODEC_MAX_BYTES; returns the length. */
+size_t codec_pack(const struct capture *cap, uint8_t *out)
+{
+    size_t head = offsetof(struct capture, channel);
+    size_t len = head;
+    size_t n;
+    int chan;
+
+    memcpy(out, cap, head);
+    for (chan=0; chan<CAPTURE_NUM_CHAN; chan++) {
+        memcpy(out + len, &cap->channel[chan].low_range, sizeof(int));
+        len += sizeof(int);
+        memcpy(out + len, &cap->channel[chan].step, sizeof(double));
+        len += sizeof(double);
+        memcpy(out + len, &cap->channel[chan].offset, sizeof(double));
+        len += sizeof(double);
+        n = codec_pack_codes(cap->channel[chan].code, out + len + 2);
+        assert(n <= CODEC_MAX_CHAN_BYTES);
+        out[len] = (uint8_t)n;
+        out[len+1] = (uint8_t)(n >> 8);
+        len += 2 + n;
+    }
+    assert(len <= CODEC_MAX_BYTES);
+
+    return len;
+}
+
+/* Unpack what codec_pack() made; -1 if it doesn't hold together. */
+int codec_unpack(const uint8_t *in, size_t len, struct capture *cap)
+{
+    size_t head = offsetof(struct capture, channel);
+    size_t meta = sizeof(int) + 2*sizeof(double);
+    size_t pos = head;
+    size_t n;
+    int chan;
+
+    if (len < head) {
+        return -1;
+    }
+    memcpy(cap, in, head);
+    for (chan=0; chan<CAPTURE_NUM_CHAN; chan++) {
+        if (len - pos < meta + 2) {
+            return -1;
+        }
+        memcpy(&cap->channel[chan].low_range, in + pos, sizeof(int));
+        pos += sizeof(int);
+        memcpy(&cap->channel[chan].step, in + pos, sizeof(double));
+        pos += sizeof(double);
+        memcpy(&cap->channel[chan].offset, in + pos, sizeof(double));
+        pos += sizeof(double);
+        n = (size_t)(in[pos] | (in[pos+1] << 8));
+        pos += 2;
+        if (len - pos < n ||
+            codec_unpack_codes(in + pos, n, cap->channel[chan].code)) {
+            return -1;
+        }
+        pos += n;
+    }
+
+    return 0;
+}
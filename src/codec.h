@@ -0,0 +1,28 @@
+/*
+   codec.h
+
+   Copyright (c) 2026 by Daniel Kelley
+
+   Lossless packing of a capture's sample codes for archiving.
+
+*/
+
+#ifndef   CODEC_H_
+#define   CODEC_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "capture.h"
+
+#define CODEC_BLOCK 32              /* deltas sharing a bit width */
+
+/* Largest packed capture: incompressible codes cost a little extra. */
+#define CODEC_MAX_CHAN_BYTES \
+    (2 + (CAPTURE_NUM_SAMPLE/CODEC_BLOCK) * (1 + CODEC_BLOCK*17/8) + 8)
+#define CODEC_MAX_BYTES \
+    (sizeof(struct capture) + CAPTURE_NUM_CHAN * (2 + CODEC_MAX_CHAN_BYTES))
+
+extern size_t codec_pack(const struct capture *cap, uint8_t *out);
+extern int codec_unpack(const uint8_t *in, size_t len, struct capture *cap);
+
+#endif /* CODEC_H_ */
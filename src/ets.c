@@ -0,0 +1,187 @@
+/*
+   ets.c
+
+   Copyright (c) 2026 by Daniel Kelley
+
+*/
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ets.h"
+
+/*
+ * The sample clock free runs relative to the trigger, so each sweep
+ * samples the signal at a slightly different phase. Shifting every
+ * sweep so its interpolated trigger crossing lands on the same
+ * instant and dropping the samples into bins factor times finer than
+ * the sample interval builds up the composite a sweep at a time.
+ * Only a running sum and count per bin are kept, allocated once for
+ * ETS_MAX_FACTOR, so memory does not grow with the number of sweeps.
+ */
+struct ets {
+    size_t n;                   /* samples per sweep */
+    int nchan;
+    unsigned int factor;
+    double *sum;                /* [nchan][n*ETS_MAX_FACTOR] */
+    unsigned int *count;
+};
+
+struct ets *ets_init(size_t n, int nchan)
+{
+    struct ets *ets;
+    size_t size = n * ETS_MAX_FACTOR * (size_t)nchan;
+
+    assert(n > 1);
+    assert(nchan > 0);
+
+    ets = calloc(1, sizeof(*ets));
+    if (ets) {
+        ets->n = n;
+        ets->nchan = nchan;
+        ets->factor = ETS_DEFAULT_FACTOR;
+        ets->sum = calloc(size, sizeof(*ets->sum));
+        ets->count = calloc(size, sizeof(*ets->count));
+        if (!ets->sum || !ets->count) {
+            ets_done(ets);
+            ets = NULL;
+        }
+    }
+
+    return ets;
+}
+
+void ets_done(struct ets *ets)
+{
+    if (ets) {
+        free(ets->sum);
+        free(ets->count);
+        free(ets);
+    }
+}
+
+/* Discard the composite, and start a new one at factor. */
+void ets_reset(struct ets *ets, unsigned int factor)
+{
+    size_t size = ets->n * ETS_MAX_FACTOR * (size_t)ets->nchan;
+
+    assert(factor >= 1 && factor <= ETS_MAX_FACTOR);
+    ets->factor = factor;
+    memset(ets->sum, 0, size * sizeof(*ets->sum));
+    memset(ets->count, 0, size * sizeof(*ets->count));
+}
+
+unsigned int ets_factor(const struct ets *ets)
+{
+    return ets->factor;
+}
+
+/* Composite record length */
+size_t ets_points(const struct ets *ets)
+{
+    return ets->n * ets->factor;
+}
+
+/*
+ * Find where v crosses level on the triggered slope (rising if
+ * 'rising', else falling) closest to the nominal trigger sample t0,
+ * interpolating between samples. A crossing the other way is not the
+ * trigger event however close it is. The shift that moves that
+ * crossing onto t0 is returned in *shift. Returns nonzero if there is
+ * no such crossing within ETS_WINDOW samples.
+ */
+int ets_phase(const double *v,
+              size_t n,
+              double t0,
+              double level,
+              int rising,
+              double *shift)
+{
+    double lo = floor(t0 - ETS_WINDOW);
+    double hi = ceil(t0 + ETS_WINDOW);
+    double best = ETS_WINDOW;
+    size_t k0;
+    size_t k1;
+    size_t k;
+    int err = 1;
+
+    k0 = (lo < 0.0) ? 0 : (size_t)lo;
+    k1 = (hi > (double)(n - 1)) ? n - 1 : (size_t)hi;
+
+    for (k=k0; k<k1; k++) {
+        double a = v[k] - level;
+        double b = v[k+1] - level;
+        double t;
+
+        if ((a < 0.0 && b < 0.0) || (a > 0.0 && b > 0.0) || a == b) {
+            continue;
+        }
+        if (rising ? (b < a) : (b > a)) {
+            continue;
+        }
+        t = (double)k + a/(a - b);
+        if (fabs(t - t0) <= best) {
+            best = fabs(t - t0);
+            *shift = t0 - t;
+            err = 0;
+        }
+    }
+
+    return err;
+}
+
+/* Bin one channel of a sweep, shifted by ets_phase()'s result. */
+void ets_add(struct ets *ets, int chan, const double *v, double shift)
+{
+    size_t points = ets_points(ets);
+    size_t base = (size_t)chan * ets->n * ETS_MAX_FACTOR;
+    double f = (double)ets->factor;
+    size_t j;
+
+    assert(chan >= 0 && chan < ets->nchan);
+    assert(fabs(shift) <= ETS_WINDOW);
+
+    for (j=0; j<ets->n; j++) {
+        double b = floor(((double)j + shift) * f + 0.5);
+        size_t bin;
+
+        if (b < 0.0 || b >= (double)points) {
+            continue;
+        }
+        bin = base + (size_t)b;
+        ets->sum[bin] += v[j];
+        ets->count[bin]++;
+    }
+}
+
+/* Number of composite points holding at least one sample */
+size_t ets_filled(const struct ets *ets, int chan)
+{
+    const unsigned int *count;
+    size_t points = ets_points(ets);
+    size_t filled = 0;
+    size_t j;
+
+    assert(chan >= 0 && chan < ets->nchan);
+    count = ets->count + (size_t)chan * ets->n * ETS_MAX_FACTOR;
+    for (j=0; j<points; j++) {
+        filled += (count[j] != 0);
+    }
+
+    return filled;
+}
+
+/* Composite record, the mean of each bin or empty where none yet. */
+void ets_result(const struct ets *ets, int chan, double empty, double *out)
+{
+    size_t points = ets_points(ets);
+    size_t base = (size_t)chan * ets->n * ETS_MAX_FACTOR;
+    size_t j;
+
+    assert(chan >= 0 && chan < ets->nchan);
+    for (j=0; j<points; j++) {
+        unsigned int c = ets->count[base + j];
+        out[j] = c ? ets->sum[base + j] / c : empty;
+    }
+}
@@ -0,0 +1,41 @@
+/*
+   ets.h
+
+   Copyright (c) 2026 by Daniel Kelley
+
+   Equivalent time sampling: many triggered sweeps of a repetitive
+   signal interleaved by their sub-sample trigger phase into one
+   higher resolution record.
+
+*/
+
+#ifndef   ETS_H_
+#define   ETS_H_
+
+#include <stddef.h>
+
+#define ETS_MAX_FACTOR 16
+#define ETS_DEFAULT_FACTOR 8
+#define ETS_WINDOW 2.0          /* samples searched either side of t0 */
+
+struct ets;
+
+extern struct ets *ets_init(size_t n, int nchan);
+extern void ets_done(struct ets *ets);
+extern void ets_reset(struct ets *ets, unsigned int factor);
+extern unsigned int ets_factor(const struct ets *ets);
+extern size_t ets_points(const struct ets *ets);
+extern int ets_phase(const double *v,
+                     size_t n,
+                     double t0,
+                     double level,
+                     int rising,
+                     double *shift);
+extern void ets_add(struct ets *ets, int chan, const double *v, double shift);
+extern size_t ets_filled(const struct ets *ets, int chan);
+extern void ets_result(const struct ets *ets,
+                       int chan,
+                       double empty,
+                       double *out);
+
+#endif /* ETS_H_ */
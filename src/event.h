@@ -20,6 +20,8 @@ enum event_id {
     EVENT_SCOPE_STATUS_OUTPUT,
     EVENT_SCOPE_STATUS_COMPLETE,
     EVENT_SCOPE_OFFSET_START,
+    EVENT_SCOPE_REARM,
+    EVENT_ETS_BIN,
     EVENT_UNBLOCK,
     EVENT_OUTPUT_FLUSH,
     EVENT_PROCESS_LINE,
@@ -0,0 +1,111 @@
+/*
+   export.c
+
+   Copyright (c) 2026 by Daniel Kelley
+
+*/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "export.h"
+
+/*
+ * The server is the only writer. It owns the object from export_init
+ * to export_done and removes it then, so a consumer that finds it
+ * can trust the header.
+ */
+struct export {
+    char *name;
+    size_t size;
+    struct export_header *hdr;
+};
+
+struct export *export_init(const char *name, uint32_t depth)
+{
+    struct export *ex;
+    void *map;
+    int fd;
+
+    assert(depth > 0);
+
+    ex = calloc(1, sizeof(*ex));
+    if (!ex) {
+        return NULL;
+    }
+
+    do {
+        ex->name = strdup(name);
+        if (!ex->name) {
+            break;
+        }
+        ex->size = sizeof(struct export_header) +
+            depth * sizeof(struct export_slot);
+
+        /* Whatever an earlier run left behind is stale. */
+        (void)shm_unlink(name);
+        fd = shm_open(name, O_RDWR|O_CREAT|O_EXCL, 0644);
+        if (fd < 0) {
+            break;
+        }
+        if (ftruncate(fd, (off_t)ex->size) < 0) {
+            close(fd);
+            shm_unlink(name);
+            break;
+        }
+        map = mmap(NULL, ex->size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (map == MAP_FAILED) {
+            shm_unlink(name);
+            break;
+        }
+
+        /* ftruncate() zeroed it: every lock even, seq 0. */
+        ex->hdr = map;
+        ex->hdr->depth = depth;
+        ex->hdr->slot_size = sizeof(struct export_slot);
+        ex->hdr->version = EXPORT_VERSION;
+        __atomic_store_n(&ex->hdr->magic, EXPORT_MAGIC, __ATOMIC_RELEASE);
+
+        return ex;
+    } while (0);
+
+    free(ex->name);
+    free(ex);
+
+    return NULL;
+}
+
+void export_done(struct export *ex)
+{
+    if (ex) {
+        munmap(ex->hdr, ex->size);
+        shm_unlink(ex->name);
+        free(ex->name);
+        free(ex);
+    }
+}
+
+void export_add(struct export *ex, const struct capture *cap)
+{
+    struct export_header *hdr = ex->hdr;
+    struct export_slot *slot = &hdr->slot[cap->seq % hdr->depth];
+    uint64_t lock = slot->lock;
+
+    __atomic_store_n(&slot->lock, lock + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(&slot->cap, cap, sizeof(*cap));
+    __atomic_store_n(&slot->lock, lock + 2, __ATOMIC_RELEASE);
+
+    __atomic_store_n(&hdr->seq, (uint64_t)cap->seq, __ATOMIC_RELEASE);
+    __atomic_store_n(&hdr->futex, (uint32_t)cap->seq, __ATOMIC_RELEASE);
+    (void)syscall(SYS_futex, &hdr->futex, FUTEX_WAKE, INT_MAX,
+                  NULL, NULL, 0);
+}
@@ -0,0 +1,61 @@
+/*
+   export.h
+
+   Copyright (c) 2026 by Daniel Kelley
+
+   POSIX shared memory ring of published oscilloscope captures, for
+   consumers on the same host.
+
+*/
+
+#ifndef   EXPORT_H_
+#define   EXPORT_H_
+
+#include <stdint.h>
+#include "capture.h"
+
+#define EXPORT_MAGIC 0x31524743u    /* "CGR1" */
+#define EXPORT_VERSION 1
+#define EXPORT_DEPTH 64
+
+/*
+ * The object holds a struct export_header followed by depth slots.
+ * Capture seq goes in slot seq % depth. Each slot's lock is a
+ * sequence lock: odd while the server is writing the slot, bumped to
+ * the next even value when done. To read capture seq in place:
+ *
+ *   l1 = lock (acquire); odd: try again
+ *   use slot->cap, checking cap.seq == seq
+ *   l2 = lock (after an acquire fence); l1 != l2: it was overwritten
+ *
+ * header.seq is the newest capture written, 0 for none yet. The low
+ * 32 bits of it are also in header.futex, which is FUTEX_WAKEd after
+ * every capture, so a consumer that has seen everything can
+ * FUTEX_WAIT on it with the value it last read.
+ *
+ * Samples are the raw codes of struct capture; the volts for code c
+ * of a count sweep capture are (511 - c/count) * step - offset.
+ */
+struct export_slot {
+    uint64_t lock;
+    struct capture cap;
+};
+
+struct export_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t depth;                 /* slots */
+    uint32_t slot_size;             /* sizeof(struct export_slot) */
+    uint32_t futex;                 /* low 32 bits of seq */
+    uint32_t reserved;
+    uint64_t seq;                   /* newest capture; 0: none */
+    struct export_slot slot[];
+};
+
+struct export;
+
+extern struct export *export_init(const char *name, uint32_t depth);
+extern void export_done(struct export *ex);
+extern void export_add(struct export *ex, const struct capture *cap);
+
+#endif /* EXPORT_H_ */
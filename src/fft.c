@@ -0,0 +1,362 @@
+/*
+   fft.c
+
+   Copyright (c) 2026 by Daniel Kelley
+
+*/
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include "fft.h"
+
+/*
+ * A real record of n samples is transformed as an n/2 point complex
+ * FFT of the even/odd sample pairs followed by a split step, so the
+ * cost is about half that of a complex transform of the same size.
+ *
+ * Everything that depends only on the record size -- twiddle factors,
+ * the bit reversal permutation, window coefficients and scratch
+ * space -- is computed the first time a size is used and kept until
+ * fft_done().
+ */
+struct fft_table {
+    size_t n;
+    double *cos_t;                  /* cos(2*pi*k/n), k < n/2 */
+    double *sin_t;                  /* sin(2*pi*k/n), k < n/2 */
+    unsigned int *rev;              /* n/2 point bit reversal */
+    double *re;                     /* n/2 point scratch */
+    double *im;
+    double *window[FFT_NUM_WINDOW]; /* built on first use */
+    double window_sum[FFT_NUM_WINDOW];
+    double *xre;                    /* n/2 point fft_xcorr() product, */
+    double *xim;                    /* built on first use */
+};
+
+struct fft {
+    struct fft_table *table[FFT_MAX_LOG2+1];
+};
+
+/* Cosine sum coefficients: w[j] = a0 - a1*cos(x) + a2*cos(2x) - ... */
+#define FFT_WINDOW_TERMS 5
+static const double fft_window_coef[FFT_NUM_WINDOW][FFT_WINDOW_TERMS] = {
+    /* Hann */
+    { 0.5, 0.5, 0.0, 0.0, 0.0 },
+    /* Flat top */
+    { 0.21557895, 0.41663158, 0.277263158, 0.083578947, 0.006947368 },
+    /* Blackman-Harris */
+    { 0.35875, 0.48829, 0.14128, 0.01168, 0.0 },
+};
+
+static int fft_log2(size_t n)
+{
+    int log2n = 0;
+
+    while (((size_t)1 << log2n) < n) {
+        log2n++;
+    }
+
+    return ((size_t)1 << log2n) == n ? log2n : -1;
+}
+
+static void fft_table_free(struct fft_table *t)
+{
+    int w;
+
+    if (t) {
+        for (w=0; w<FFT_NUM_WINDOW; w++) {
+            free(t->window[w]);
+        }
+        free(t->cos_t);
+        free(t->sin_t);
+        free(t->rev);
+        free(t->re);
+        free(t->im);
+        free(t->xre);
+        free(t->xim);
+        free(t);
+    }
+}
+
+static struct fft_table *fft_table_new(size_t n, int log2n)
+{
+    struct fft_table *t;
+    size_t m = n/2;
+    size_t k;
+    unsigned int j;
+    int b;
+
+    t = calloc(1, sizeof(*t));
+    if (!t) {
+        return NULL;
+    }
+    t->n = n;
+    t->cos_t = calloc(m, sizeof(*t->cos_t));
+    t->sin_t = calloc(m, sizeof(*t->sin_t));
+    t->rev = calloc(m, sizeof(*t->rev));
+    t->re = calloc(m, sizeof(*t->re));
+    t->im = calloc(m, sizeof(*t->im));
+    if (!t->cos_t || !t->sin_t || !t->rev || !t->re || !t->im) {
+        fft_table_free(t);
+        return NULL;
+    }
+
+    for (k=0; k<m; k++) {
+        double phase = 2.0 * M_PI * (double)k / (double)n;
+        t->cos_t[k] = cos(phase);
+        t->sin_t[k] = sin(phase);
+    }
+
+    for (j=0; j<m; j++) {
+        unsigned int r = 0;
+        for (b=0; b<log2n-1; b++) {
+            r |= ((j >> b) & 1u) << (log2n - 2 - b);
+        }
+        t->rev[j] = r;
+    }
+
+    return t;
+}
+
+static const double *fft_window(struct fft_table *t, enum fft_window window)
+{
+    const double *a = fft_window_coef[window];
+    double *w = t->window[window];
+    double sum = 0.0;
+    size_t j;
+    int k;
+
+    if (w) {
+        return w;
+    }
+
+    w = calloc(t->n, sizeof(*w));
+    if (!w) {
+        return NULL;
+    }
+    /* Periodic (DFT even) form, as is usual for spectral analysis. */
+    for (j=0; j<t->n; j++) {
+        double x = 2.0 * M_PI * (double)j / (double)t->n;
+        double v = 0.0;
+        for (k=0; k<FFT_WINDOW_TERMS; k++) {
+            v += ((k & 1) ? -a[k] : a[k]) * cos(x * k);
+        }
+        w[j] = v;
+        sum += v;
+    }
+    t->window[window] = w;
+    t->window_sum[window] = sum;
+
+    return w;
+}
+
+static struct fft_table *fft_table(struct fft *fft, size_t n)
+{
+    int log2n = fft_log2(n);
+
+    if (log2n < 2 || log2n > FFT_MAX_LOG2) {
+        return NULL;
+    }
+    if (!fft->table[log2n]) {
+        fft->table[log2n] = fft_table_new(n, log2n);
+    }
+
+    return fft->table[log2n];
+}
+
+/* In place radix-2 transform of the n/2 points in t->re, t->im */
+static void fft_complex(struct fft_table *t)
+{
+    size_t m = t->n/2;
+    size_t len;
+    size_t i;
+    size_t k;
+    double *re = t->re;
+    double *im = t->im;
+
+    for (len=2; len<=m; len<<=1) {
+        size_t half = len/2;
+        size_t stride = t->n/len;
+        for (i=0; i<m; i+=len) {
+            for (k=0; k<half; k++) {
+                double wr = t->cos_t[k*stride];
+                double wi = -t->sin_t[k*stride];
+                size_t a = i + k;
+                size_t b = a + half;
+                double tr = re[b]*wr - im[b]*wi;
+                double ti = re[b]*wi + im[b]*wr;
+                re[b] = re[a] - tr;
+                im[b] = im[a] - ti;
+                re[a] += tr;
+                im[a] += ti;
+            }
+        }
+    }
+}
+
+struct fft *fft_init(void)
+{
+    return calloc(1, sizeof(struct fft));
+}
+
+void fft_done(struct fft *fft)
+{
+    int i;
+
+    if (fft) {
+        for (i=0; i<=FFT_MAX_LOG2; i++) {
+            fft_table_free(fft->table[i]);
+        }
+        free(fft);
+    }
+}
+
+/* Number of spectrum bins, DC through Nyquist, for an n point record */
+size_t fft_bins(size_t n)
+{
+    return n/2 + 1;
+}
+
+/*
+ * Spectrum of the n point record x, n a power of two, as RMS
+ * magnitude in dBV (0 dBV = 1 Vrms) for each of fft_bins(n) bins.
+ * Bin k is at k/(n*dt) Hz for sample interval dt. The window's
+ * coherent gain is removed so a sinusoid centered on a bin reads its
+ * RMS value; the flat top window keeps that true between bins too.
+ */
+int fft_spectrum(struct fft *fft,
+                 const double *x,
+                 size_t n,
+                 enum fft_window window,
+                 double *dbv)
+{
+    struct fft_table *t;
+    const double *w;
+    size_t m = n/2;
+    size_t j;
+    size_t k;
+    double scale;
+    double floor_v = pow(10.0, FFT_FLOOR_DBV/20.0);
+
+    assert(window < FFT_NUM_WINDOW);
+
+    t = fft_table(fft, n);
+    if (!t) {
+        return -1;
+    }
+    w = fft_window(t, window);
+    if (!w) {
+        return -1;
+    }
+
+    /* Windowed even/odd samples as n/2 complex points, bit reversed */
+    for (j=0; j<m; j++) {
+        size_t r = t->rev[j];
+        t->re[j] = x[2*r] * w[2*r];
+        t->im[j] = x[2*r+1] * w[2*r+1];
+    }
+    fft_complex(t);
+
+    scale = 1.0 / t->window_sum[window];
+    for (k=0; k<=m; k++) {
+        /* Split Z into the transforms of the even and odd samples */
+        double zr = t->re[k % m];
+        double zi = t->im[k % m];
+        double cr = t->re[(m - k) % m];
+        double ci = -t->im[(m - k) % m];
+        double er = 0.5 * (zr + cr);
+        double ei = 0.5 * (zi + ci);
+        double or_ = 0.5 * (zi - ci);
+        double oi = -0.5 * (zr - cr);
+        double wr = (k < m) ? t->cos_t[k] : -1.0;
+        double wi = (k < m) ? -t->sin_t[k] : 0.0;
+        double xr = er + wr*or_ - wi*oi;
+        double xi = ei + wr*oi + wi*or_;
+        double v = sqrt(xr*xr + xi*xi) * scale;
+
+        if (k != 0 && k != m) {
+            /* Fold in the negative frequency half; peak to RMS. */
+            v *= M_SQRT2;
+        }
+        dbv[k] = (v > floor_v) ? 20.0 * log10(v) : FFT_FLOOR_DBV;
+    }
+
+    return 0;
+}
+
+/*
+ * Cross correlation of the n point records a and b, n a power of two,
+ * in the layout meas_xcorr() uses:
+ *
+ *   r[n-1+L] = sum over j of a[j] * b[j+L],  -n < L < n
+ *
+ * Both records, zero padded to 2n so no lag wraps around, go through
+ * one 2n point complex transform as its real and imaginary parts and
+ * are separated after. Their cross spectrum is transformed back by
+ * the same forward FFT on its conjugate.
+ */
+int fft_xcorr(struct fft *fft,
+              const double *a,
+              const double *b,
+              size_t n,
+              double *r)
+{
+    struct fft_table *t;
+    size_t m = 2*n;
+    size_t j;
+    size_t k;
+
+    t = fft_table(fft, 2*m);
+    if (!t) {
+        return -1;
+    }
+    if (!t->xre) {
+        t->xre = calloc(m, sizeof(*t->xre));
+        t->xim = calloc(m, sizeof(*t->xim));
+        if (!t->xre || !t->xim) {
+            free(t->xre);
+            free(t->xim);
+            t->xre = NULL;
+            t->xim = NULL;
+            return -1;
+        }
+    }
+
+    for (j=0; j<m; j++) {
+        size_t rj = t->rev[j];
+        t->re[j] = (rj < n) ? a[rj] : 0.0;
+        t->im[j] = (rj < n) ? b[rj] : 0.0;
+    }
+    fft_complex(t);
+
+    /* conj(A[k]) * B[k], where Z = A + iB */
+    for (k=0; k<m; k++) {
+        double zr = t->re[k];
+        double zi = t->im[k];
+        double cr = t->re[(m - k) % m];
+        double ci = -t->im[(m - k) % m];
+        double ar = 0.5 * (zr + cr);
+        double ai = 0.5 * (zi + ci);
+        double br = 0.5 * (zi - ci);
+        double bi = -0.5 * (zr - cr);
+        t->xre[k] = ar*br + ai*bi;
+        t->xim[k] = ar*bi - ai*br;
+    }
+
+    /* Inverse transform: the real part of FFT(conj(X)) / m */
+    for (j=0; j<m; j++) {
+        size_t rj = t->rev[j];
+        t->re[j] = t->xre[rj];
+        t->im[j] = -t->xim[rj];
+    }
+    fft_complex(t);
+
+    for (j=0; j<n; j++) {
+        r[n-1+j] = t->re[j] / (double)m;
+    }
+    for (j=1; j<n; j++) {
+        r[n-1-j] = t->re[m-j] / (double)m;
+    }
+
+    return 0;
+}
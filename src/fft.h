@@ -0,0 +1,42 @@
+/*
+   fft.h
+
+   Copyright (c) 2026 by Daniel Kelley
+
+   Windowed magnitude spectrum of a real sample record, and cross
+   correlation of two.
+
+*/
+
+#ifndef   FFT_H_
+#define   FFT_H_
+
+#include <stddef.h>
+
+#define FFT_MAX_LOG2 16         /* largest record: 65536 samples */
+#define FFT_FLOOR_DBV (-300.0)  /* reported for an all zero bin */
+
+enum fft_window {
+    FFT_WINDOW_HANN,
+    FFT_WINDOW_FLATTOP,
+    FFT_WINDOW_BHARRIS,         /* 4 term Blackman-Harris */
+    FFT_NUM_WINDOW,
+};
+
+struct fft;
+
+extern struct fft *fft_init(void);
+extern void fft_done(struct fft *fft);
+extern size_t fft_bins(size_t n);
+extern int fft_spectrum(struct fft *fft,
+                        const double *x,
+                        size_t n,
+                        enum fft_window window,
+                        double *dbv);
+extern int fft_xcorr(struct fft *fft,
+                     const double *a,
+                     const double *b,
+                     size_t n,
+                     double *r);
+
+#endif /* FFT_H_ */
@@ -0,0 +1,288 @@
+/*
+   filter.c
+
+   Copyright (c) 2026 by Daniel Kelley
+
+*/
+
+#include <assert.h>
+#include <math.h>
+#include "filter.h"
+
+#define FILTER_FC_MIN 1.0e-6    /* cycles/sample */
+#define FILTER_FC_MAX 0.499
+#define FILTER_BLOCK 4          /* FIR outputs computed together */
+
+/* Cutoff in cycles per sample, kept strictly inside (0, Nyquist) */
+static double filter_fc(double f, double dt)
+{
+    double fc = f * dt;
+
+    if (fc < FILTER_FC_MIN) {
+        fc = FILTER_FC_MIN;
+    } else if (fc > FILTER_FC_MAX) {
+        fc = FILTER_FC_MAX;
+    }
+
+    return fc;
+}
+
+/* Hamming windowed sinc low pass, unity gain at DC, added to h */
+static void filter_fir_lpass(double fc, int taps, double scale, double *h)
+{
+    int m = taps/2;
+    double sum = 0.0;
+    double lp[FILTER_MAX_TAPS];
+    int k;
+
+    for (k=0; k<taps; k++) {
+        double x = (double)(k - m);
+        double w = 0.54 - 0.46 * cos(2.0 * M_PI * k / (taps - 1));
+        double s = (k == m) ? 2.0 * fc : sin(2.0 * M_PI * fc * x) / (M_PI * x);
+        lp[k] = s * w;
+        sum += lp[k];
+    }
+    for (k=0; k<taps; k++) {
+        h[k] += scale * lp[k] / sum;
+    }
+}
+
+static void filter_fir_design(const struct filter_spec *spec,
+                              double dt,
+                              struct filter_coef *coef)
+{
+    int taps = spec->taps;
+    int k;
+
+    assert(taps >= 3 && taps <= FILTER_MAX_TAPS && (taps & 1));
+    coef->taps = taps;
+    for (k=0; k<taps; k++) {
+        coef->h[k] = 0.0;
+    }
+
+    switch (spec->type) {
+    case FILTER_LPASS:
+        filter_fir_lpass(filter_fc(spec->f1, dt), taps, 1.0, coef->h);
+        break;
+    case FILTER_HPASS:
+        /* Spectral inversion of the low pass */
+        filter_fir_lpass(filter_fc(spec->f1, dt), taps, -1.0, coef->h);
+        coef->h[taps/2] += 1.0;
+        break;
+    case FILTER_BPASS:
+        filter_fir_lpass(filter_fc(spec->f2, dt), taps, 1.0, coef->h);
+        filter_fir_lpass(filter_fc(spec->f1, dt), taps, -1.0, coef->h);
+        break;
+    default:
+        assert(0);
+        break;
+    }
+}
+
+/* Audio EQ cookbook biquads; Butterworth Q for the low and high pass */
+static void filter_iir_design(const struct filter_spec *spec,
+                              double dt,
+                              struct filter_coef *coef)
+{
+    double f0 = spec->f1;
+    double q = M_SQRT1_2;
+    double w0;
+    double cw;
+    double alpha;
+    double a0;
+    int k;
+
+    if (spec->type == FILTER_BPASS) {
+        /* Geometric center, Q from the bandwidth */
+        f0 = sqrt(spec->f1 * spec->f2);
+        q = f0 / (spec->f2 - spec->f1);
+    }
+    w0 = 2.0 * M_PI * filter_fc(f0, dt);
+    cw = cos(w0);
+    alpha = sin(w0) / (2.0 * q);
+
+    switch (spec->type) {
+    case FILTER_LPASS:
+        coef->b[0] = (1.0 - cw) / 2.0;
+        coef->b[1] = 1.0 - cw;
+        coef->b[2] = (1.0 - cw) / 2.0;
+        break;
+    case FILTER_HPASS:
+        coef->b[0] = (1.0 + cw) / 2.0;
+        coef->b[1] = -(1.0 + cw);
+        coef->b[2] = (1.0 + cw) / 2.0;
+        break;
+    case FILTER_BPASS:
+        /* 0 dB peak gain */
+        coef->b[0] = alpha;
+        coef->b[1] = 0.0;
+        coef->b[2] = -alpha;
+        break;
+    default:
+        assert(0);
+        break;
+    }
+    coef->a[0] = 1.0 + alpha;
+    coef->a[1] = -2.0 * cw;
+    coef->a[2] = 1.0 - alpha;
+
+    a0 = coef->a[0];
+    for (k=0; k<3; k++) {
+        coef->b[k] /= a0;
+        coef->a[k] /= a0;
+    }
+}
+
+/* Coefficients for spec at sample interval dt */
+void filter_design(const struct filter_spec *spec,
+                   double dt,
+                   struct filter_coef *coef)
+{
+    assert(dt > 0.0);
+    assert(spec->type != FILTER_BPASS || spec->f2 > spec->f1);
+
+    coef->form = spec->form;
+    switch (spec->form) {
+    case FILTER_FIR:
+        filter_fir_design(spec, dt, coef);
+        break;
+    case FILTER_IIR:
+        filter_iir_design(spec, dt, coef);
+        break;
+    default:
+        assert(0);
+        break;
+    }
+}
+
+/* One output with the input index clamped to the record (edges). */
+static double filter_fir_edge(const double *h,
+                              int taps,
+                              const double *in,
+                              size_t n,
+                              size_t j)
+{
+    long m = taps/2;
+    double acc = 0.0;
+    long idx;
+    int k;
+
+    for (k=0; k<taps; k++) {
+        idx = (long)j + k - m;
+        if (idx < 0) {
+            idx = 0;
+        } else if (idx >= (long)n) {
+            idx = (long)n - 1;
+        }
+        acc += h[k] * in[idx];
+    }
+
+    return acc;
+}
+
+/*
+ * Centered (zero delay) convolution. Away from the edges the kernel
+ * computes FILTER_BLOCK outputs per pass over the taps, so each
+ * coefficient is loaded once per block and the independent
+ * accumulators leave the compiler free to vectorize.
+ */
+static void filter_fir_apply(const struct filter_coef *coef,
+                             const double *in,
+                             size_t n,
+                             double *out)
+{
+    const double *h = coef->h;
+    size_t m = (size_t)coef->taps/2;
+    size_t taps = (size_t)coef->taps;
+    size_t j;
+    size_t k;
+    size_t end;
+
+    if (n < taps) {
+        for (j=0; j<n; j++) {
+            out[j] = filter_fir_edge(h, coef->taps, in, n, j);
+        }
+        return;
+    }
+
+    end = n - m;
+    for (j=0; j<m; j++) {
+        out[j] = filter_fir_edge(h, coef->taps, in, n, j);
+    }
+    for (; j + FILTER_BLOCK <= end; j += FILTER_BLOCK) {
+        const double *x = in + j - m;
+        double a0 = 0.0;
+        double a1 = 0.0;
+        double a2 = 0.0;
+        double a3 = 0.0;
+        for (k=0; k<taps; k++) {
+            double c = h[k];
+            a0 += c * x[k];
+            a1 += c * x[k+1];
+            a2 += c * x[k+2];
+            a3 += c * x[k+3];
+        }
+        out[j] = a0;
+        out[j+1] = a1;
+        out[j+2] = a2;
+        out[j+3] = a3;
+    }
+    for (; j<end; j++) {
+        const double *x = in + j - m;
+        double acc = 0.0;
+        for (k=0; k<taps; k++) {
+            acc += h[k] * x[k];
+        }
+        out[j] = acc;
+    }
+    for (; j<n; j++) {
+        out[j] = filter_fir_edge(h, coef->taps, in, n, j);
+    }
+}
+
+/*
+ * Transposed direct form II, started in the steady state for the
+ * first sample so a DC level doesn't produce a start up transient.
+ */
+static void filter_iir_apply(const struct filter_coef *coef,
+                             const double *in,
+                             size_t n,
+                             double *out)
+{
+    const double *b = coef->b;
+    const double *a = coef->a;
+    double gain = (b[0] + b[1] + b[2]) / (1.0 + a[1] + a[2]);
+    double y0 = gain * in[0];
+    double z2 = b[2]*in[0] - a[2]*y0;
+    double z1 = b[1]*in[0] - a[1]*y0 + z2;
+    size_t j;
+
+    for (j=0; j<n; j++) {
+        double x = in[j];
+        double y = b[0]*x + z1;
+        z1 = b[1]*x - a[1]*y + z2;
+        z2 = b[2]*x - a[2]*y;
+        out[j] = y;
+    }
+}
+
+void filter_apply(const struct filter_coef *coef,
+                  const double *in,
+                  size_t n,
+                  double *out)
+{
+    assert(n > 0);
+    assert(in != out);
+
+    switch (coef->form) {
+    case FILTER_FIR:
+        filter_fir_apply(coef, in, n, out);
+        break;
+    case FILTER_IIR:
+        filter_iir_apply(coef, in, n, out);
+        break;
+    default:
+        assert(0);
+        break;
+    }
+}
@@ -0,0 +1,52 @@
+/*
+   filter.h
+
+   Copyright (c) 2026 by Daniel Kelley
+
+   Digital filters applied to captured traces.
+
+*/
+
+#ifndef   FILTER_H_
+#define   FILTER_H_
+
+#include <stddef.h>
+
+#define FILTER_MAX_TAPS 255
+
+enum filter_type {
+    FILTER_LPASS,
+    FILTER_HPASS,
+    FILTER_BPASS,
+};
+
+enum filter_form {
+    FILTER_FIR,                 /* windowed sinc, linear phase */
+    FILTER_IIR,                 /* biquad */
+};
+
+struct filter_spec {
+    enum filter_type type;
+    enum filter_form form;
+    int taps;                   /* FIR length, odd */
+    double f1;                  /* cutoff, or lower band edge (Hz) */
+    double f2;                  /* upper band edge (Hz) */
+};
+
+struct filter_coef {
+    enum filter_form form;
+    int taps;
+    double h[FILTER_MAX_TAPS];  /* FIR */
+    double b[3];                /* IIR, normalized so a[0] == 1 */
+    double a[3];
+};
+
+extern void filter_design(const struct filter_spec *spec,
+                          double dt,
+                          struct filter_coef *coef);
+extern void filter_apply(const struct filter_coef *coef,
+                         const double *in,
+                         size_t n,
+                         double *out);
+
+#endif /* FILTER_H_ */
@@ -0,0 +1,213 @@
+/*
+   history.c
+
+   Copyright (c) 2026 by Daniel Kelley
+
+*/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "history.h"
+
+/*
+ * Captures are added in increasing sequence number order, though not
+ * necessarily consecutively (a mask test may keep only the failures),
+ * so lookups binary search the ring from the newest capture back.
+ * Memory is depth * sizeof(struct capture), i.e. the raw sample codes
+ * plus a little metadata per sweep.
+ */
+struct history {
+    size_t depth;
+    size_t count;               /* captures retained */
+    size_t head;                /* next slot to fill */
+    struct capture *ring;
+};
+
+struct history *history_init(size_t depth)
+{
+    struct history *history;
+
+    assert(depth > 0);
+    assert(depth <= HISTORY_MAX_DEPTH);
+
+    history = calloc(1,sizeof(*history));
+    if (history) {
+        history->ring = calloc(depth, sizeof(*history->ring));
+        if (history->ring) {
+            history->depth = depth;
+        } else {
+            free(history);
+            history = NULL;
+        }
+    }
+
+    return history;
+}
+
+void history_done(struct history *history)
+{
+    if (history) {
+        free(history->ring);
+        free(history);
+    }
+}
+
+/* Slot of the n'th newest capture (0: newest). */
+static size_t history_slot(const struct history *history, size_t n)
+{
+    assert(n < history->count);
+
+    return (history->head + history->depth - 1 - n) % history->depth;
+}
+
+/* Change the depth, keeping as many of the newest captures as fit. */
+int history_resize(struct history *history, size_t depth)
+{
+    struct capture *ring;
+    size_t count;
+    size_t n;
+    int err = 1;
+
+    do {
+        if (depth == 0 || depth > HISTORY_MAX_DEPTH) {
+            break;
+        }
+
+        if (depth == history->depth) {
+            err = 0;
+            break;
+        }
+
+        ring = calloc(depth, sizeof(*ring));
+        if (!ring) {
+            break;
+        }
+
+        count = (history->count < depth) ? history->count : depth;
+        for (n=0; n<count; n++) {
+            ring[count - 1 - n] = history->ring[history_slot(history, n)];
+        }
+
+        free(history->ring);
+        history->ring = ring;
+        history->depth = depth;
+        history->count = count;
+        history->head = count % depth;
+        err = 0;
+    } while (0);
+
+    return err;
+}
+
+size_t history_depth(const struct history *history)
+{
+    return history->depth;
+}
+
+void history_add(struct history *history, const struct capture *cap)
+{
+    assert(cap->seq == 0 ||
+           history->count == 0 ||
+           cap->seq > history_last(history));
+
+    history->ring[history->head] = *cap;
+    history->head = (history->head + 1) % history->depth;
+    if (history->count < history->depth) {
+        history->count++;
+    }
+}
+
+/* Oldest retained sequence number; 0 if none. */
+unsigned long history_first(const struct history *history)
+{
+    unsigned long seq = 0;
+
+    if (history->count) {
+        seq = history->ring[history_slot(history, history->count - 1)].seq;
+    }
+
+    return seq;
+}
+
+/* Newest retained sequence number; 0 if none. */
+unsigned long history_last(const struct history *history)
+{
+    unsigned long seq = 0;
+
+    if (history->count) {
+        seq = history->ring[history_slot(history, 0)].seq;
+    }
+
+    return seq;
+}
+
+/* Number of captures retained. */
+size_t history_count(const struct history *history)
+{
+    return history->count;
+}
+
+/* Sequence number of the n'th newest capture (0: newest); 0 if none. */
+unsigned long history_nth(const struct history *history, size_t n)
+{
+    unsigned long seq = 0;
+
+    if (n < history->count) {
+        seq = history->ring[history_slot(history, n)].seq;
+    }
+
+    return seq;
+}
+
+/*
+ * Newest-first index of the oldest capture with a sequence number
+ * greater than seq, or history->count if there is none.
+ */
+static size_t history_search(const struct history *history,
+                             unsigned long seq)
+{
+    size_t lo = 0;
+    size_t hi = history->count;
+    size_t mid;
+
+    /* Sequence numbers decrease with n; find the first n <= seq. */
+    while (lo < hi) {
+        mid = lo + (hi - lo)/2;
+        if (history->ring[history_slot(history, mid)].seq > seq) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+/* Oldest retained sequence number after seq; 0 if none. */
+unsigned long history_next(const struct history *history, unsigned long seq)
+{
+    size_t n = history_search(history, seq);
+
+    return (n > 0) ? history->ring[history_slot(history, n - 1)].seq : 0;
+}
+
+const struct capture *history_find(const struct history *history,
+                                   unsigned long seq)
+{
+    const struct capture *cap = NULL;
+    size_t n;
+
+    if (seq != 0) {
+        n = history_search(history, seq - 1);
+        if (n > 0) {
+            cap = &history->ring[history_slot(history, n - 1)];
+            if (cap->seq != seq) {
+                /* Not retained. */
+                cap = NULL;
+            }
+        }
+    }
+
+    return cap;
+}
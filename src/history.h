@@ -0,0 +1,37 @@
+/*
+   history.h
+
+   Copyright (c) 2026 by Daniel Kelley
+
+   Ring of recently published oscilloscope captures, so clients that
+   fall behind a continuous acquisition can catch up by sequence
+   number. Sequence numbers increase but may have gaps.
+
+*/
+
+#ifndef   HISTORY_H_
+#define   HISTORY_H_
+
+#include <stddef.h>
+#include "capture.h"
+
+#define HISTORY_DEFAULT_DEPTH 32
+#define HISTORY_MAX_DEPTH 4096
+
+struct history;
+
+extern struct history *history_init(size_t depth);
+extern void history_done(struct history *history);
+extern int history_resize(struct history *history, size_t depth);
+extern size_t history_depth(const struct history *history);
+extern void history_add(struct history *history, const struct capture *cap);
+extern unsigned long history_first(const struct history *history);
+extern unsigned long history_last(const struct history *history);
+extern size_t history_count(const struct history *history);
+extern unsigned long history_nth(const struct history *history, size_t n);
+extern unsigned long history_next(const struct history *history,
+                                  unsigned long seq);
+extern const struct capture *history_find(const struct history *history,
+                                          unsigned long seq);
+
+#endif /* HISTORY_H_ */
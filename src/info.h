@@ -49,6 +49,8 @@ struct info {
     size_t cli_line_len;
     struct response rsp;
     const char *conf_rsp;
+    const char *export_name;
+    const char *log_dir;
     void *hdl;
     struct lexer *lexer;
     struct parser *parser;
@@ -61,6 +63,9 @@ struct info {
     int sweep_status;
     int digital_event_status;
     int offset_status;
+    int cal_status;
+    int range_status;
+    int clip_status;
 };
 
 #endif /* INFO_H_ */
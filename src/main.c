@@ -76,10 +76,13 @@ static int done(struct info *info)
 
 static void usage(const char *prog)
 {
-    fprintf(stderr,"%s [-b bus] [-d dev] [-p port] [-vh]\n", prog);
+    fprintf(stderr,"%s [-b bus] [-d dev] [-l dir] [-m name] [-p port] [-vh]\n",
+            prog);
     fprintf(stderr,"  -h        Print this message\n");
     fprintf(stderr,"  -b        USB Bus (default 0)\n");
     fprintf(stderr,"  -d        USB Device (default 0)\n");
+    fprintf(stderr,"  -l        Directory SYST:INT:LOG files are kept in\n");
+    fprintf(stderr,"  -m        Export captures to shared memory name\n");
     fprintf(stderr,"  -p        server port (default %d)\n", SCPI_PORT);
     fprintf(stderr,"  -v        Verbose mode\n");
     fprintf(stderr,"  -W        Enable flash writes\n");
@@ -95,7 +98,7 @@ int main(int argc, char *argv[])
     int rc = 1;
     int c;
 
-    while ((c = getopt(argc, argv, "b:c:d:p:r:D:vxhW")) != EOF) {
+    while ((c = getopt(argc, argv, "b:c:d:l:m:p:r:D:vxhW")) != EOF) {
         switch (c) {
         case 'b':
             info_.bus = (int)strtol(optarg, NULL, 0);
@@ -109,6 +112,12 @@ int main(int argc, char *argv[])
         case 'r':
             info_.conf_rsp = optarg;
             break;
+        case 'l':
+            info_.log_dir = optarg;
+            break;
+        case 'm':
+            info_.export_name = optarg;
+            break;
         case 'W':
             info_.enable_flash_writes = 1;
             break;
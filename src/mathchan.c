@@ -0,0 +1,134 @@
+/*
+   mathchan.c
+
+   Copyright (c) 2026 by Daniel Kelley
+
+*/
+
+#include <assert.h>
+#include <math.h>
+#include "mathchan.h"
+
+/* Keep a quotient finite: a divisor near 0 is held at the minimum. */
+static double mathchan_divisor(double b)
+{
+    if (fabs(b) >= MATHCHAN_DIV_MIN) {
+        return b;
+    }
+
+    return (b < 0.0) ? -MATHCHAN_DIV_MIN : MATHCHAN_DIV_MIN;
+}
+
+/*
+ * Compute n samples of the trace defined by def from source traces a
+ * and b, sampled every dt seconds. The integral is by the trapezoid
+ * rule; the derivative is a central difference, one sided at the
+ * ends.
+ */
+void mathchan_eval(const struct mathchan_def *def,
+                   const double *a,
+                   const double *b,
+                   size_t n,
+                   double dt,
+                   double *out)
+{
+    double sum = 0.0;
+    size_t j;
+
+    assert(n > 1);
+    assert(dt > 0.0);
+
+    switch (def->func) {
+    case MATHCHAN_ADD:
+        for (j=0; j<n; j++) {
+            out[j] = a[j] + b[j];
+        }
+        break;
+    case MATHCHAN_SUB:
+        for (j=0; j<n; j++) {
+            out[j] = a[j] - b[j];
+        }
+        break;
+    case MATHCHAN_MUL:
+        for (j=0; j<n; j++) {
+            out[j] = a[j] * b[j];
+        }
+        break;
+    case MATHCHAN_DIV:
+        for (j=0; j<n; j++) {
+            out[j] = a[j] / mathchan_divisor(b[j]);
+        }
+        break;
+    case MATHCHAN_INT:
+        out[0] = 0.0;
+        for (j=1; j<n; j++) {
+            sum += (a[j-1] + a[j]) * dt / 2.0;
+            out[j] = sum;
+        }
+        break;
+    case MATHCHAN_DER:
+        out[0] = (a[1] - a[0]) / dt;
+        for (j=1; j<n-1; j++) {
+            out[j] = (a[j+1] - a[j-1]) / (2.0 * dt);
+        }
+        out[n-1] = (a[n-1] - a[n-2]) / dt;
+        break;
+    case MATHCHAN_OFF:
+    default:
+        assert(0);
+        break;
+    }
+
+    for (j=0; j<n; j++) {
+        out[j] = out[j] * def->scale + def->offset;
+    }
+}
+
+/*
+ * Codes for v spanning its own range, so code based measurements and
+ * PACKed readout see a math trace at the resolution of a channel's:
+ *
+ *   v[j] ~= (midpoint - code[j]) * step - offset
+ */
+void mathchan_quantize(const double *v,
+                       size_t n,
+                       int midpoint,
+                       uint16_t *code,
+                       struct meas_scale *scale)
+{
+    double lo = v[0];
+    double hi = v[0];
+    double mid;
+    long c;
+    size_t j;
+
+    assert(midpoint > 0);
+
+    for (j=1; j<n; j++) {
+        if (v[j] < lo) {
+            lo = v[j];
+        }
+        if (v[j] > hi) {
+            hi = v[j];
+        }
+    }
+    mid = (lo + hi) / 2.0;
+
+    scale->midpoint = midpoint;
+    scale->offset = -mid;
+    scale->step = (hi - lo) / (2.0 * midpoint);
+    if (scale->step == 0.0) {
+        /* Flat: every code is the midpoint; any step will do. */
+        scale->step = 1.0;
+    }
+
+    for (j=0; j<n; j++) {
+        c = midpoint - lround((v[j] - mid) / scale->step);
+        if (c < 0) {
+            c = 0;
+        } else if (c > 2*midpoint) {
+            c = 2*midpoint;
+        }
+        code[j] = (uint16_t)c;
+    }
+}
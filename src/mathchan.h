@@ -0,0 +1,50 @@
+/*
+   mathchan.h
+
+   Copyright (c) 2026 by Daniel Kelley
+
+   Math channels: traces computed from the two oscilloscope channels.
+
+*/
+
+#ifndef   MATHCHAN_H_
+#define   MATHCHAN_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "meas.h"
+
+#define MATHCHAN_DIV_MIN 1e-3   /* smallest divisor magnitude, volts */
+
+enum mathchan_func {
+    MATHCHAN_OFF,
+    MATHCHAN_ADD,               /* A + B */
+    MATHCHAN_SUB,               /* A - B */
+    MATHCHAN_MUL,               /* A * B */
+    MATHCHAN_DIV,               /* A / B */
+    MATHCHAN_INT,               /* integral of A from the first sample */
+    MATHCHAN_DER,               /* derivative of A */
+};
+
+/* scale * func(A, B) + offset */
+struct mathchan_def {
+    enum mathchan_func func;
+    int a;                      /* source channel index */
+    int b;
+    double scale;
+    double offset;
+};
+
+extern void mathchan_eval(const struct mathchan_def *def,
+                          const double *a,
+                          const double *b,
+                          size_t n,
+                          double dt,
+                          double *out);
+extern void mathchan_quantize(const double *v,
+                              size_t n,
+                              int midpoint,
+                              uint16_t *code,
+                              struct meas_scale *scale);
+
+#endif /* MATHCHAN_H_ */
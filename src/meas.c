@@ -0,0 +1,807 @@
+/*
+   meas.c
+
+   Copyright (c) 2026 by Daniel Kelley
+
+*/
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+#include "meas.h"
+
+#define MEAS_MODE_MIN_PCT 5  /* top/base mode must hold this % of a half */
+#define MEAS_HYST_PCT 5      /* edge hysteresis, % of amplitude */
+#define MEAS_MAX_EDGE 512
+#define MEAS_XCORR_PEAK_FRAC 0.9  /* of the highest, for a nearer peak */
+
+static double meas_volts(const struct meas_scale *scale, double code)
+{
+    return (((double)scale->midpoint - code) * scale->step) - scale->offset;
+}
+
+/*
+ * Most frequent code in [lo,hi], or -1 if no code there is frequent
+ * enough to be a settled level.
+ */
+static int meas_mode(const uint32_t *hist, int lo, int hi)
+{
+    uint32_t total = 0;
+    uint32_t best = 0;
+    int mode = -1;
+    int code;
+
+    for (code=lo; code<=hi; code++) {
+        total += hist[code];
+        if (hist[code] > best) {
+            best = hist[code];
+            mode = code;
+        }
+    }
+
+    if (best * 100 < total * MEAS_MODE_MIN_PCT) {
+        mode = -1;
+    }
+
+    return mode;
+}
+
+/*
+ * All amplitude measurements in one pass over the codes. Everything
+ * is accumulated as integers and only the results are scaled to
+ * volts. A higher code is a lower voltage, so the extremes swap.
+ */
+void meas_amplitude(const uint16_t *code,
+                    size_t n,
+                    const struct meas_scale *scale,
+                    struct meas_amplitude *m)
+{
+    uint32_t hist[MEAS_CODE_SIZE];
+    unsigned int cmin = MEAS_CODE_SIZE - 1;
+    unsigned int cmax = 0;
+    uint64_t sum = 0;
+    uint64_t sumsq = 0;
+    unsigned int c;
+    size_t j;
+    int split;
+    int top;
+    int base;
+    double mean;
+    double var;
+
+    assert(n > 0);
+    memset(hist, 0, sizeof(hist));
+
+    for (j=0; j<n; j++) {
+        c = code[j];
+        assert(c < MEAS_CODE_SIZE);
+        cmin = (c < cmin) ? c : cmin;
+        cmax = (c > cmax) ? c : cmax;
+        sum += c;
+        sumsq += (uint64_t)c * c;
+        hist[c]++;
+    }
+
+    mean = (double)sum / (double)n;
+    /* n^2 * variance, exact in integers */
+    var = (double)((uint64_t)n * sumsq - sum * sum) / ((double)n * (double)n);
+
+    m->max = meas_volts(scale, cmin);
+    m->min = meas_volts(scale, cmax);
+    m->ptp = m->max - m->min;
+    m->aver = meas_volts(scale, mean);
+    m->acrms = fabs(scale->step) * sqrt(var);
+    m->rms = sqrt((m->aver * m->aver) + (m->acrms * m->acrms));
+
+    /* Top is the settled high voltage (low codes), base the low. */
+    split = (int)((cmin + cmax) / 2);
+    top = meas_mode(hist, (int)cmin, split);
+    base = meas_mode(hist, split + 1, (int)cmax);
+    m->top = (top < 0) ? m->max : meas_volts(scale, top);
+    m->base = (base < 0) ? m->min : meas_volts(scale, base);
+    m->ampl = m->top - m->base;
+    if (m->ampl > 0.0) {
+        m->over = 100.0 * (m->max - m->top) / m->ampl;
+    } else {
+        m->over = 0.0;
+    }
+}
+
+/*
+ * Statistics of MEAS_CODE_SIZE bins of sample counts indexed by code,
+ * as accumulated over any number of sweeps.
+ */
+void meas_histogram(const uint64_t *bins,
+                    const struct meas_scale *scale,
+                    struct meas_histogram *m)
+{
+    double n = 0.0;
+    double sum = 0.0;
+    double sumsq = 0.0;
+    double mean;
+    double var;
+    int cmin = -1;
+    int cmax = -1;
+    int c;
+
+    for (c=0; c<MEAS_CODE_SIZE; c++) {
+        if (bins[c]) {
+            if (cmin < 0) {
+                cmin = c;
+            }
+            cmax = c;
+            n += (double)bins[c];
+            sum += (double)bins[c] * c;
+        }
+    }
+
+    m->count = n;
+    if (n == 0.0) {
+        m->mean = MEAS_NAN;
+        m->sdev = MEAS_NAN;
+        m->min = MEAS_NAN;
+        m->max = MEAS_NAN;
+        return;
+    }
+
+    /* Second pass about the mean; the counts can be too large for
+     * the integer form used by meas_amplitude(). */
+    mean = sum / n;
+    for (c=cmin; c<=cmax; c++) {
+        sumsq += (double)bins[c] * (c - mean) * (c - mean);
+    }
+    var = sumsq / n;
+
+    m->mean = meas_volts(scale, mean);
+    m->sdev = fabs(scale->step) * sqrt(var);
+    /* A higher code is a lower voltage. */
+    m->max = meas_volts(scale, cmin);
+    m->min = meas_volts(scale, cmax);
+}
+
+/*
+ * Voltage below which pct percent of the samples lie: the lowest bin
+ * where the running count, lowest voltage first, reaches pct.
+ */
+double meas_histogram_percentile(const uint64_t *bins,
+                                 const struct meas_scale *scale,
+                                 double pct)
+{
+    double n = 0.0;
+    double target;
+    double run = 0.0;
+    int c;
+
+    assert(pct >= 0.0 && pct <= 100.0);
+    for (c=0; c<MEAS_CODE_SIZE; c++) {
+        n += (double)bins[c];
+    }
+    if (n == 0.0) {
+        return MEAS_NAN;
+    }
+
+    target = n * pct / 100.0;
+    for (c=MEAS_CODE_SIZE-1; c>0; c--) {
+        run += (double)bins[c];
+        if (bins[c] && run >= target) {
+            break;
+        }
+    }
+
+    return meas_volts(scale, c);
+}
+
+double meas_amplitude_value(const struct meas_amplitude *m,
+                            enum meas_volt func)
+{
+    double value = 0.0;
+
+    switch (func) {
+    case MEAS_VOLT_MAX:
+        value = m->max;
+        break;
+    case MEAS_VOLT_MIN:
+        value = m->min;
+        break;
+    case MEAS_VOLT_PTP:
+        value = m->ptp;
+        break;
+    case MEAS_VOLT_AVER:
+        value = m->aver;
+        break;
+    case MEAS_VOLT_RMS:
+        value = m->rms;
+        break;
+    case MEAS_VOLT_ACRMS:
+        value = m->acrms;
+        break;
+    case MEAS_VOLT_AMPL:
+        value = m->ampl;
+        break;
+    case MEAS_VOLT_TOP:
+        value = m->top;
+        break;
+    case MEAS_VOLT_BASE:
+        value = m->base;
+        break;
+    case MEAS_VOLT_OVER:
+        value = m->over;
+        break;
+    default:
+        assert(0);
+        break;
+    }
+
+    return value;
+}
+
+/*
+ * Timing
+ *
+ * Edges are found at the 50% level between base and top, with a
+ * hysteresis band so noise near the level does not produce extra
+ * edges. Each edge time is interpolated between the two samples
+ * straddling the level. Rise and fall times run between the 10% and
+ * 90% levels around each edge.
+ */
+
+struct meas_edges {
+    size_t n;
+    double t[MEAS_MAX_EDGE];
+};
+
+struct meas_levels {
+    const uint16_t *code;
+    size_t n;
+    const struct meas_scale *scale;
+    double lo;          /* 10% */
+    double mid;         /* 50% */
+    double hi;          /* 90% */
+    double hyst;
+};
+
+static double meas_sample(const struct meas_levels *l, size_t j)
+{
+    return meas_volts(l->scale, l->code[j]);
+}
+
+/* Fractional sample index where the trace crosses 'level' in (j,j+1]. */
+static double meas_cross(const struct meas_levels *l, size_t j, double level)
+{
+    double y0 = meas_sample(l, j);
+    double y1 = meas_sample(l, j + 1);
+    double t = (double)j;
+
+    if (y1 != y0) {
+        t += (level - y0) / (y1 - y0);
+    }
+
+    return t;
+}
+
+/*
+ * Time of the last crossing of 'level' at or before sample 'j',
+ * searching back no further than 'stop'. 'rising' tells which side of
+ * the level the trace starts on.
+ */
+static double meas_cross_back(const struct meas_levels *l,
+                              size_t j,
+                              size_t stop,
+                              double level,
+                              int rising)
+{
+    while (j > stop) {
+        double y = meas_sample(l, j - 1);
+        if (rising ? (y <= level) : (y >= level)) {
+            return meas_cross(l, j - 1, level);
+        }
+        j--;
+    }
+
+    return -1.0;
+}
+
+/* First crossing of 'level' after sample 'j'. */
+static double meas_cross_fwd(const struct meas_levels *l,
+                             size_t j,
+                             double level,
+                             int rising)
+{
+    for (; j + 1 < l->n; j++) {
+        double y = meas_sample(l, j + 1);
+        if (rising ? (y >= level) : (y <= level)) {
+            return meas_cross(l, j, level);
+        }
+    }
+
+    return -1.0;
+}
+
+static void meas_edge_add(struct meas_edges *e, double t)
+{
+    if (e->n < MEAS_MAX_EDGE) {
+        e->t[e->n++] = t;
+    }
+}
+
+static void meas_find_edges(const struct meas_levels *l,
+                            struct meas_edges *rise,
+                            struct meas_edges *fall,
+                            double *rtim,
+                            double *ftim)
+{
+    double rsum = 0.0;
+    double fsum = 0.0;
+    size_t rn = 0;
+    size_t fn = 0;
+    size_t last = 0;
+    size_t j;
+    int state = 0;      /* 1: high, -1: low, 0: unknown */
+    double y;
+    double t;
+    double t0;
+    double t1;
+
+    for (j=0; j<l->n; j++) {
+        y = meas_sample(l, j);
+        if (y > l->mid + l->hyst && state != 1) {
+            if (state == -1) {
+                t = meas_cross_back(l, j, last, l->mid, 1);
+                meas_edge_add(rise, t);
+                t0 = meas_cross_back(l, j, last, l->lo, 1);
+                t1 = meas_cross_fwd(l, j - 1, l->hi, 1);
+                if (t0 >= 0.0 && t1 >= 0.0) {
+                    rsum += t1 - t0;
+                    rn++;
+                }
+            }
+            state = 1;
+            last = j;
+        } else if (y < l->mid - l->hyst && state != -1) {
+            if (state == 1) {
+                t = meas_cross_back(l, j, last, l->mid, 0);
+                meas_edge_add(fall, t);
+                t0 = meas_cross_back(l, j, last, l->hi, 0);
+                t1 = meas_cross_fwd(l, j - 1, l->lo, 0);
+                if (t0 >= 0.0 && t1 >= 0.0) {
+                    fsum += t1 - t0;
+                    fn++;
+                }
+            }
+            state = -1;
+            last = j;
+        }
+    }
+
+    *rtim = rn ? rsum / (double)rn : -1.0;
+    *ftim = fn ? fsum / (double)fn : -1.0;
+}
+
+/* Mean interval between consecutive edges; negative if fewer than 2. */
+static double meas_period(const struct meas_edges *e)
+{
+    double per = -1.0;
+
+    if (e->n >= 2) {
+        per = (e->t[e->n - 1] - e->t[0]) / (double)(e->n - 1);
+    }
+
+    return per;
+}
+
+/* Mean time from each edge in 'a' to the next edge in 'b'. */
+static double meas_width(const struct meas_edges *a,
+                         const struct meas_edges *b)
+{
+    double sum = 0.0;
+    size_t n = 0;
+    size_t i;
+    size_t k = 0;
+
+    for (i=0; i<a->n; i++) {
+        while (k < b->n && b->t[k] <= a->t[i]) {
+            k++;
+        }
+        if (k == b->n) {
+            break;
+        }
+        sum += b->t[k] - a->t[i];
+        n++;
+    }
+
+    return n ? sum / (double)n : -1.0;
+}
+
+static double meas_scale_time(double samples, double dt)
+{
+    return (samples < 0.0) ? MEAS_NAN : samples * dt;
+}
+
+/* Levels from the trace's own BASE and TOP, then its edges. */
+static void meas_edges(const uint16_t *code,
+                       size_t n,
+                       const struct meas_scale *scale,
+                       struct meas_edges *rise,
+                       struct meas_edges *fall,
+                       double *rtim,
+                       double *ftim)
+{
+    struct meas_amplitude amp;
+    struct meas_levels l;
+
+    meas_amplitude(code, n, scale, &amp);
+
+    l.code = code;
+    l.n = n;
+    l.scale = scale;
+    l.lo = amp.base + 0.1 * amp.ampl;
+    l.mid = amp.base + 0.5 * amp.ampl;
+    l.hi = amp.base + 0.9 * amp.ampl;
+    l.hyst = amp.ampl * MEAS_HYST_PCT / 100.0;
+    if (l.hyst < fabs(scale->step)) {
+        l.hyst = fabs(scale->step);
+    }
+    rise->n = 0;
+    fall->n = 0;
+    *rtim = -1.0;
+    *ftim = -1.0;
+
+    /* Need at least a couple of codes of swing to see edges. */
+    if (amp.ampl > 2.0 * fabs(scale->step)) {
+        meas_find_edges(&l, rise, fall, rtim, ftim);
+    }
+}
+
+void meas_timing(const uint16_t *code,
+                 size_t n,
+                 const struct meas_scale *scale,
+                 double dt,
+                 struct meas_timing *m)
+{
+    struct meas_edges rise;
+    struct meas_edges fall;
+    double per;
+    double pwid;
+    double rtim;
+    double ftim;
+
+    meas_edges(code, n, scale, &rise, &fall, &rtim, &ftim);
+
+    per = meas_period(&rise);
+    if (per < 0.0) {
+        per = meas_period(&fall);
+    }
+    pwid = meas_width(&rise, &fall);
+
+    m->per = meas_scale_time(per, dt);
+    m->freq = (per > 0.0) ? 1.0 / (per * dt) : MEAS_NAN;
+    m->pwid = meas_scale_time(pwid, dt);
+    m->nwid = meas_scale_time(meas_width(&fall, &rise), dt);
+    m->dcyc = (per > 0.0 && pwid >= 0.0) ? 100.0 * pwid / per : MEAS_NAN;
+    m->rtim = meas_scale_time(rtim, dt);
+    m->ftim = meas_scale_time(ftim, dt);
+}
+
+double meas_timing_value(const struct meas_timing *m, enum meas_time func)
+{
+    double value = 0.0;
+
+    switch (func) {
+    case MEAS_TIME_FREQ:
+        value = m->freq;
+        break;
+    case MEAS_TIME_PER:
+        value = m->per;
+        break;
+    case MEAS_TIME_DCYC:
+        value = m->dcyc;
+        break;
+    case MEAS_TIME_RTIM:
+        value = m->rtim;
+        break;
+    case MEAS_TIME_FTIM:
+        value = m->ftim;
+        break;
+    case MEAS_TIME_PWID:
+        value = m->pwid;
+        break;
+    case MEAS_TIME_NWID:
+        value = m->nwid;
+        break;
+    default:
+        assert(0);
+        break;
+    }
+
+    return value;
+}
+
+/*
+ * Pair measurements
+ *
+ * Delay runs from rising edges of trace a to the nearest rising
+ * edges of trace b, so it is positive when b lags a. With two or more
+ * edges in a, the delays are taken as angles of a's period and
+ * averaged as unit vectors: a delay near half a period whose edges
+ * straddle it doesn't average to zero, and an edge of b missing from
+ * the end of the sweep doesn't matter.
+ */
+void meas_skew(const uint16_t *a,
+               const struct meas_scale *sa,
+               const uint16_t *b,
+               const struct meas_scale *sb,
+               size_t n,
+               double dt,
+               struct meas_skew *m)
+{
+    struct meas_edges arise;
+    struct meas_edges afall;
+    struct meas_edges brise;
+    struct meas_edges bfall;
+    double rtim;
+    double ftim;
+    double per;
+    double d;
+    double x = 0.0;
+    double y = 0.0;
+    size_t i;
+    size_t k = 0;
+
+    meas_edges(a, n, sa, &arise, &afall, &rtim, &ftim);
+    meas_edges(b, n, sb, &brise, &bfall, &rtim, &ftim);
+
+    m->delay = MEAS_NAN;
+    m->phase = MEAS_NAN;
+    if (arise.n == 0 || brise.n == 0) {
+        return;
+    }
+
+    per = meas_period(&arise);
+    for (i=0; i<arise.n; i++) {
+        while (k + 1 < brise.n &&
+               fabs(brise.t[k+1] - arise.t[i]) <
+               fabs(brise.t[k] - arise.t[i])) {
+            k++;
+        }
+        d = brise.t[k] - arise.t[i];
+        if (per <= 0.0) {
+            m->delay = d * dt;
+            return;
+        }
+        x += cos(2.0 * M_PI * d / per);
+        y += sin(2.0 * M_PI * d / per);
+    }
+
+    d = atan2(y, x);
+    m->phase = d * 180.0 / M_PI;
+    m->delay = d / (2.0 * M_PI) * per * dt;
+}
+
+/*
+ * Cross correlation of a and b, n samples each, for every lag:
+ *
+ *   r[n-1+L] = sum over j of a[j] * b[j+L],  -n < L < n
+ *
+ * This is the direct O(n^2) sum; fft_xcorr() gets the same result
+ * faster for n a power of two.
+ */
+void meas_xcorr(const double *a, const double *b, size_t n, double *r)
+{
+    double sum;
+    size_t lag;
+    size_t j;
+
+    for (lag=0; lag<n; lag++) {
+        sum = 0.0;
+        for (j=0; j+lag<n; j++) {
+            sum += a[j] * b[j+lag];
+        }
+        r[n-1+lag] = sum;
+        if (lag == 0) {
+            continue;
+        }
+        sum = 0.0;
+        for (j=0; j+lag<n; j++) {
+            sum += a[j+lag] * b[j];
+        }
+        r[n-1-lag] = sum;
+    }
+}
+
+/* Correlation coefficient from sums over m samples; 0 if either is flat. */
+static double meas_ncc(double sab,
+                       double sa,
+                       double saa,
+                       double sb,
+                       double sbb,
+                       double m)
+{
+    double cov = sab/m - (sa/m)*(sb/m);
+    double va = saa/m - (sa/m)*(sa/m);
+    double vb = sbb/m - (sb/m)*(sb/m);
+
+    return (va > 0.0 && vb > 0.0) ? cov / sqrt(va * vb) : 0.0;
+}
+
+/*
+ * Replace r, as meas_xcorr() leaves it, with the correlation
+ * coefficient of a and b over each lag's overlap, for |lag| <= span.
+ * The sums over the overlaps are kept running as the lag grows.
+ */
+static void meas_xcorr_norm(const double *a,
+                            const double *b,
+                            double *r,
+                            size_t n,
+                            size_t span)
+{
+    double ah = 0.0;            /* a[0..n-d) */
+    double aah = 0.0;
+    double at;                  /* a[d..n) */
+    double aat;
+    double bh = 0.0;
+    double bbh = 0.0;
+    double bt;
+    double bbt;
+    size_t mid = n - 1;
+    size_t d;
+    size_t j;
+
+    for (j=0; j<n; j++) {
+        ah += a[j];
+        aah += a[j] * a[j];
+        bh += b[j];
+        bbh += b[j] * b[j];
+    }
+    at = ah;
+    aat = aah;
+    bt = bh;
+    bbt = bbh;
+
+    for (d=0; d<=span; d++) {
+        double m = (double)(n - d);
+
+        if (d > 0) {
+            ah -= a[n-d];
+            aah -= a[n-d] * a[n-d];
+            at -= a[d-1];
+            aat -= a[d-1] * a[d-1];
+            bh -= b[n-d];
+            bbh -= b[n-d] * b[n-d];
+            bt -= b[d-1];
+            bbt -= b[d-1] * b[d-1];
+            /* b lags: a[0..n-d) against b[d..n) */
+            r[mid+d] = meas_ncc(r[mid+d], ah, aah, bt, bbt, m);
+            r[mid-d] = meas_ncc(r[mid-d], at, aat, bh, bbh, m);
+        } else {
+            r[mid] = meas_ncc(r[mid], ah, aah, bh, bbh, m);
+        }
+    }
+}
+
+/* Is k a local maximum of r of at least 'min'? */
+static int meas_xcorr_peak(const double *r, size_t k, double min)
+{
+    return (r[k] >= min && r[k] >= r[k-1] && r[k] >= r[k+1]);
+}
+
+/*
+ * Lag of the cross correlation peak in samples, positive when b lags
+ * a, or MEAS_NAN if a and b don't correlate at all; r is as
+ * meas_xcorr() or fft_xcorr() leave it, and is overwritten. The peak
+ * is looked for in the correlation coefficient over each lag's
+ * overlap, over the lags where at least half the samples overlap, so
+ * neither the shrinking overlap nor a partial period pulls it off. A
+ * periodic signal peaks once a period; of the peaks within
+ * MEAS_XCORR_PEAK_FRAC of the highest the one nearest lag 0 is taken,
+ * as the edge delay takes the nearest edge. It is placed between
+ * samples by a parabola through it and its neighbors.
+ */
+double meas_xcorr_lag(const double *a, const double *b, double *r, size_t n)
+{
+    size_t span = n/2;
+    size_t mid = n - 1;
+    size_t best = mid;
+    size_t k;
+    size_t d;
+    double min;
+    double den;
+    double frac = 0.0;
+    int found = 0;
+
+    assert(n >= 2);
+
+    meas_xcorr_norm(a, b, r, n, span);
+    for (k=mid-(span-1); k<=mid+(span-1); k++) {
+        if (r[k] > r[best]) {
+            best = k;
+        }
+    }
+    if (r[best] <= 0.0) {
+        return MEAS_NAN;
+    }
+
+    min = MEAS_XCORR_PEAK_FRAC * r[best];
+    for (d=0; d<span && !found; d++) {
+        if (meas_xcorr_peak(r, mid - d, min)) {
+            best = mid - d;
+            found = 1;
+        }
+        if (d > 0 && meas_xcorr_peak(r, mid + d, min) &&
+            (!found || r[mid+d] > r[best])) {
+            best = mid + d;
+            found = 1;
+        }
+    }
+
+    den = r[best-1] - 2.0*r[best] + r[best+1];
+    if (den < 0.0) {
+        frac = 0.5 * (r[best-1] - r[best+1]) / den;
+        if (fabs(frac) > 0.5) {
+            frac = 0.0;
+        }
+    }
+
+    return (double)best - (double)mid + frac;
+}
+
+/*
+ * Reduce n codes to points intervals in one pass, writing volts to
+ * out (points values, or 2*points for MINMAX). Interval i covers
+ * codes [i*n/points, (i+1)*n/points), so every code is in exactly
+ * one interval and a single sample glitch survives MINMAX. Codes are
+ * not limited to 10 bits here so sums of averaged sweeps work with a
+ * suitably scaled scale. Returns the number of values written.
+ */
+size_t meas_decimate(const uint16_t *code,
+                     size_t n,
+                     size_t points,
+                     enum meas_decimate mode,
+                     const struct meas_scale *scale,
+                     double *out)
+{
+    double *p = out;
+    size_t i;
+    size_t j;
+    size_t start = 0;
+    size_t end;
+
+    assert(points > 0 && points <= n);
+
+    for (i=0; i<points; i++) {
+        end = ((i + 1) * n) / points;
+        assert(end > start);
+        switch (mode) {
+        case MEAS_DECIMATE_SAMPLE:
+            *p++ = meas_volts(scale, code[start]);
+            break;
+        case MEAS_DECIMATE_MEAN:
+        {
+            uint32_t sum = 0;
+            for (j=start; j<end; j++) {
+                sum += code[j];
+            }
+            *p++ = meas_volts(scale, (double)sum / (double)(end - start));
+        }
+            break;
+        case MEAS_DECIMATE_MINMAX:
+        {
+            unsigned int cmin = code[start];
+            unsigned int cmax = code[start];
+            for (j=start+1; j<end; j++) {
+                cmin = (code[j] < cmin) ? code[j] : cmin;
+                cmax = (code[j] > cmax) ? code[j] : cmax;
+            }
+            /* A higher code is a lower voltage. */
+            *p++ = meas_volts(scale, cmax);
+            *p++ = meas_volts(scale, cmin);
+        }
+            break;
+        default:
+            assert(0);
+            break;
+        }
+        start = end;
+    }
+
+    return (size_t)(p - out);
+}
@@ -0,0 +1,141 @@
+/*
+   meas.h
+
+   Copyright (c) 2026 by Daniel Kelley
+
+   Waveform measurements computed on raw sample codes.
+
+*/
+
+#ifndef   MEAS_H_
+#define   MEAS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MEAS_CODE_SIZE 1024   /* 10 bit codes */
+#define MEAS_NAN 9.91e37      /* SCPI Not a Number */
+
+/* Linear code to volts conversion: volts = (midpoint - code)*step - offset */
+struct meas_scale {
+    int midpoint;
+    double step;
+    double offset;
+};
+
+enum meas_volt {
+    MEAS_VOLT_MAX,
+    MEAS_VOLT_MIN,
+    MEAS_VOLT_PTP,
+    MEAS_VOLT_AVER,
+    MEAS_VOLT_RMS,
+    MEAS_VOLT_ACRMS,
+    MEAS_VOLT_AMPL,
+    MEAS_VOLT_TOP,
+    MEAS_VOLT_BASE,
+    MEAS_VOLT_OVER,
+};
+
+struct meas_amplitude {
+    double max;
+    double min;
+    double ptp;
+    double aver;
+    double rms;
+    double acrms;
+    double ampl;
+    double top;
+    double base;
+    double over;        /* percent of ampl */
+};
+
+enum meas_time {
+    MEAS_TIME_FREQ,
+    MEAS_TIME_PER,
+    MEAS_TIME_DCYC,
+    MEAS_TIME_RTIM,
+    MEAS_TIME_FTIM,
+    MEAS_TIME_PWID,
+    MEAS_TIME_NWID,
+};
+
+/* Times in seconds; MEAS_NAN where the sweep has too few edges. */
+struct meas_timing {
+    double freq;
+    double per;
+    double dcyc;        /* percent */
+    double rtim;        /* 10% to 90% */
+    double ftim;        /* 90% to 10% */
+    double pwid;
+    double nwid;
+};
+
+/* Of the samples in a code histogram; volts, MEAS_NAN when empty. */
+struct meas_histogram {
+    double count;
+    double mean;
+    double sdev;
+    double min;
+    double max;
+};
+
+enum meas_pair {
+    MEAS_PAIR_PHASE,            /* edges: degrees */
+    MEAS_PAIR_DELAY,            /* edges: seconds */
+    MEAS_PAIR_XDELAY,           /* cross correlation: seconds */
+};
+
+/* Of trace b relative to a; MEAS_NAN without the edges needed. */
+struct meas_skew {
+    double delay;       /* seconds, positive when b lags a */
+    double phase;       /* degrees of a's period, (-180,180] */
+};
+
+enum meas_decimate {
+    MEAS_DECIMATE_SAMPLE,       /* first sample of each interval */
+    MEAS_DECIMATE_MEAN,         /* mean of each interval */
+    MEAS_DECIMATE_MINMAX,       /* min,max pair per interval */
+};
+
+extern void meas_amplitude(const uint16_t *code,
+                           size_t n,
+                           const struct meas_scale *scale,
+                           struct meas_amplitude *m);
+extern double meas_amplitude_value(const struct meas_amplitude *m,
+                                   enum meas_volt func);
+extern void meas_timing(const uint16_t *code,
+                        size_t n,
+                        const struct meas_scale *scale,
+                        double dt,
+                        struct meas_timing *m);
+extern double meas_timing_value(const struct meas_timing *m,
+                                enum meas_time func);
+extern void meas_skew(const uint16_t *a,
+                      const struct meas_scale *sa,
+                      const uint16_t *b,
+                      const struct meas_scale *sb,
+                      size_t n,
+                      double dt,
+                      struct meas_skew *m);
+extern void meas_xcorr(const double *a,
+                       const double *b,
+                       size_t n,
+                       double *r);
+extern double meas_xcorr_lag(const double *a,
+                             const double *b,
+                             double *r,
+                             size_t n);
+extern void meas_histogram(const uint64_t *bins,
+                           const struct meas_scale *scale,
+                           struct meas_histogram *m);
+extern double meas_histogram_percentile(const uint64_t *bins,
+                                        const struct meas_scale *scale,
+                                        double pct);
+extern size_t meas_decimate(const uint16_t *code,
+                            size_t n,
+                            size_t points,
+                            enum meas_decimate mode,
+                            const struct meas_scale *scale,
+                            double *out);
+
+#endif /* MEAS_H_ */
@@ -397,9 +397,12 @@ static int parser_cli_line(struct info *info)
     return rc;
 }
 
+/* Also hold off while the client is still taking earlier responses. */
 static int parser_input_blocked(struct info *info)
 {
-    return parser_block_until_active || info->block_input;
+    return (parser_block_until_active ||
+            info->block_input ||
+            scpi_output_pending(info->output));
 }
 
 static void parser_process_line(void *arg)
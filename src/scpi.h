@@ -41,6 +41,7 @@ extern void scpi_status_operation_enableq(struct info *info);
 extern void scpi_status_operation_preset(struct info *info);
 
 extern void scpi_status_questionableq(struct info *info);
+extern void scpi_status_questionable_conditionq(struct info *info);
 extern void scpi_status_questionable_enable(struct info *info,
                                             struct scpi_type *val);
 extern void scpi_status_questionable_enableq(struct info *info);
@@ -50,6 +51,7 @@ extern void scpi_core_top(struct info *info);
 extern void scpi_core_cmd_sep(struct info *info, int value);
 
 extern int scpi_dev_abort(struct info *info);
+extern void scpi_dev_autoscale(struct info *info);
 
 extern struct scpi_type *scpi_dev_channel_num(struct info *info,
                                               struct scpi_type *val);
@@ -85,6 +87,130 @@ extern int scpi_dev_initiate(struct info *info);
 extern void scpi_dev_input_coupling(struct info *info, struct scpi_type *v);
 extern void scpi_dev_read_digital_dataq(struct info *info);
 extern void scpi_dev_sense_dataq(struct info *info, struct scpi_type *v);
+extern void scpi_dev_sense_data_partialq(struct info *info,
+                                         struct scpi_type *v1,
+                                         struct scpi_type *v2,
+                                         struct scpi_type *v3);
+extern void scpi_dev_sense_data_decimateq(struct info *info,
+                                          struct scpi_type *v1,
+                                          struct scpi_type *v2,
+                                          struct scpi_type *v3);
+extern void scpi_dev_fetch_voltageq(struct info *info,
+                                    struct scpi_type *v1,
+                                    struct scpi_type *v2);
+extern void scpi_dev_measure_voltageq(struct info *info,
+                                      struct scpi_type *v1,
+                                      struct scpi_type *v2);
+extern void scpi_dev_fetch_timeq(struct info *info,
+                                 struct scpi_type *v1,
+                                 struct scpi_type *v2);
+extern void scpi_dev_measure_timeq(struct info *info,
+                                   struct scpi_type *v1,
+                                   struct scpi_type *v2);
+extern void scpi_dev_fetch_pairq(struct info *info,
+                                 struct scpi_type *v1,
+                                 struct scpi_type *v2,
+                                 struct scpi_type *v3);
+extern void scpi_dev_measure_pairq(struct info *info,
+                                   struct scpi_type *v1,
+                                   struct scpi_type *v2,
+                                   struct scpi_type *v3);
+extern void scpi_dev_calc_transform_frequency_dataq(struct info *info,
+                                                    struct scpi_type *v);
+extern void scpi_dev_calc_transform_frequency_stepq(struct info *info);
+extern void scpi_dev_calc_transform_frequency_window(struct info *info,
+                                                     struct scpi_type *v);
+extern void scpi_dev_calc_transform_frequency_windowq(struct info *info);
+extern void scpi_dev_calc_filter(struct info *info, struct scpi_type *v);
+extern void scpi_dev_calc_filterq(struct info *info);
+extern void scpi_dev_calc_filter_type(struct info *info, struct scpi_type *v);
+extern void scpi_dev_calc_filter_typeq(struct info *info);
+extern void scpi_dev_calc_filter_form(struct info *info, struct scpi_type *v);
+extern void scpi_dev_calc_filter_formq(struct info *info);
+extern void scpi_dev_calc_filter_frequency(struct info *info,
+                                           struct scpi_type *v1,
+                                           struct scpi_type *v2);
+extern void scpi_dev_calc_filter_frequencyq(struct info *info);
+extern void scpi_dev_calc_filter_taps(struct info *info, struct scpi_type *v);
+extern void scpi_dev_calc_filter_tapsq(struct info *info);
+extern void scpi_dev_calc_math_function(struct info *info,
+                                        struct scpi_type *v1,
+                                        struct scpi_type *v2);
+extern void scpi_dev_calc_math_functionq(struct info *info,
+                                         struct scpi_type *v);
+extern void scpi_dev_calc_math_source(struct info *info,
+                                      struct scpi_type *v1,
+                                      struct scpi_type *v2,
+                                      struct scpi_type *v3);
+extern void scpi_dev_calc_math_sourceq(struct info *info,
+                                       struct scpi_type *v);
+extern void scpi_dev_calc_math_scale(struct info *info,
+                                     struct scpi_type *v1,
+                                     struct scpi_type *v2);
+extern void scpi_dev_calc_math_scaleq(struct info *info,
+                                      struct scpi_type *v);
+extern void scpi_dev_calc_math_offset(struct info *info,
+                                      struct scpi_type *v1,
+                                      struct scpi_type *v2);
+extern void scpi_dev_calc_math_offsetq(struct info *info,
+                                       struct scpi_type *v);
+extern void scpi_dev_calc_limit(struct info *info, struct scpi_type *v);
+extern void scpi_dev_calc_limitq(struct info *info);
+extern void scpi_dev_calc_limit_data(struct info *info,
+                                     int upper,
+                                     struct scpi_type *v1,
+                                     struct scpi_type *v2);
+extern void scpi_dev_calc_limit_dataq(struct info *info,
+                                      int upper,
+                                      struct scpi_type *v);
+extern void scpi_dev_calc_limit_failq(struct info *info);
+extern void scpi_dev_calc_limit_countq(struct info *info);
+extern void scpi_dev_calc_limit_clear(struct info *info);
+extern void scpi_dev_calc_limit_stop(struct info *info, struct scpi_type *v);
+extern void scpi_dev_calc_limit_stopq(struct info *info);
+extern void scpi_dev_calc_limit_keep(struct info *info, struct scpi_type *v);
+extern void scpi_dev_calc_limit_keepq(struct info *info);
+extern void scpi_dev_calc_histogram(struct info *info, struct scpi_type *v);
+extern void scpi_dev_calc_histogramq(struct info *info);
+extern void scpi_dev_calc_histogram_dataq(struct info *info,
+                                          struct scpi_type *v);
+extern void scpi_dev_calc_histogram_countq(struct info *info);
+extern void scpi_dev_calc_histogram_clear(struct info *info);
+extern void scpi_dev_calc_histogram_statq(struct info *info,
+                                          int sdev,
+                                          struct scpi_type *v);
+extern void scpi_dev_calc_histogram_percentq(struct info *info,
+                                             struct scpi_type *v1,
+                                             struct scpi_type *v2);
+extern void scpi_dev_cal_zero(struct info *info, int store);
+extern void scpi_dev_cal_zero_count(struct info *info, struct scpi_type *v);
+extern void scpi_dev_cal_zero_countq(struct info *info);
+extern void scpi_dev_sense_ets(struct info *info, struct scpi_type *v);
+extern void scpi_dev_sense_etsq(struct info *info);
+extern void scpi_dev_sense_ets_factor(struct info *info, struct scpi_type *v);
+extern void scpi_dev_sense_ets_factorq(struct info *info);
+extern void scpi_dev_sense_ets_reset(struct info *info);
+extern void scpi_dev_sense_ets_countq(struct info *info);
+extern void scpi_dev_sense_ets_fillq(struct info *info);
+extern void scpi_dev_sense_ets_dataq(struct info *info, struct scpi_type *v);
+extern void scpi_dev_sense_average(struct info *info, struct scpi_type *v);
+extern void scpi_dev_sense_averageq(struct info *info);
+extern void scpi_dev_sense_average_count(struct info *info,
+                                         struct scpi_type *v);
+extern void scpi_dev_sense_average_countq(struct info *info);
+extern void scpi_dev_sense_history_depth(struct info *info,
+                                         struct scpi_type *v);
+extern void scpi_dev_sense_history_depthq(struct info *info);
+extern void scpi_dev_sense_history_sequenceq(struct info *info);
+extern void scpi_dev_sense_history_dataq(struct info *info,
+                                         struct scpi_type *v1,
+                                         struct scpi_type *v2);
+extern void scpi_dev_sense_history_latestq(struct info *info,
+                                           struct scpi_type *v1,
+                                           struct scpi_type *v2);
+extern void scpi_dev_sense_history_sinceq(struct info *info,
+                                          struct scpi_type *v1,
+                                          struct scpi_type *v2);
 extern void scpi_dev_sense_function_concurrent(struct info *info,
                                                struct scpi_type *v);
 extern void scpi_dev_sense_function_off(struct info *info,
@@ -123,6 +249,14 @@ extern void scpi_dev_sense_voltage_ptp(struct info *info,
 extern void scpi_dev_sense_voltage_up(struct info *info,
                                       struct scpi_type *v1,
                                       struct scpi_type *v2);
+extern void scpi_dev_sense_voltage_range_auto(struct info *info,
+                                              struct scpi_type *v,
+                                              struct scpi_type *chan);
+extern void scpi_dev_sense_voltage_range_autoq(struct info *info,
+                                               struct scpi_type *chan);
+extern void scpi_dev_sense_voltage_range_auto_fraction(struct info *info,
+                                                       struct scpi_type *v);
+extern void scpi_dev_sense_voltage_range_auto_fractionq(struct info *info);
 extern void scpi_dev_sense_voltage_lowq(struct info *info,
                                        struct scpi_type *v);
 extern void scpi_dev_sense_voltage_offsetq(struct info *info,
@@ -153,6 +287,9 @@ extern void scpi_dev_source_pwm_frequency(struct info *info,
                                           struct scpi_type *v);
 extern void scpi_dev_source_pwm_frequencyq(struct info *info);
 extern void scpi_dev_initiate_immediate(struct info *info);
+extern void scpi_dev_initiate_continuous(struct info *info,
+                                         struct scpi_type *v);
+extern void scpi_dev_initiate_continuousq(struct info *info);
 extern void scpi_dev_sense_statq(struct info *info);
 extern void scpi_dev_sense_reset(struct info *info);
 extern void scpi_dev_sense_immediate(struct info *info);
@@ -167,6 +304,8 @@ extern void scpi_dev_trigger_slopeq(struct info *info);
 extern void scpi_dev_trigger_source(struct info *info,
                                     struct scpi_type *v);
 extern void scpi_dev_trigger_sourceq(struct info *info);
+extern void scpi_dev_waveform_preambleq(struct info *info,
+                                       struct scpi_type *v);
 extern void scpi_dev_identify(struct info *info);
 extern void scpi_dev_rst(struct info *info);
 extern void scpi_system_communicate_tcp_controlq(struct info *info);
@@ -197,5 +336,11 @@ extern void scpi_system_internal_offset(struct info *info,
 
 extern void scpi_system_internal_offset_store(struct info *info);
 extern void scpi_system_internal_offsetq(struct info *info);
+extern void scpi_system_internal_log(struct info *info, struct scpi_type *v);
+extern void scpi_system_internal_log_stop(struct info *info);
+extern void scpi_system_internal_logq(struct info *info);
+extern void scpi_system_internal_log_compress(struct info *info,
+                                             struct scpi_type *v);
+extern void scpi_system_internal_log_compressq(struct info *info);
 
 #endif /* SCPI_H_ */
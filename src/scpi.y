@@ -22,18 +22,36 @@
 %token OTHER
 
 %token ABOR
+%token ACRMQ
+%token ADD
 %token ALL
+%token AMPLQ
 %token ASC
+%token AUT
+%token AUTO
+%token AUTOQ
+%token AVER
+%token AVERQ
+%token BASEQ
+%token BHAR
 %token BIN
+%token BPAS
 %token CAL
+%token CALC
 %token CAPQ
+%token CLE
 %token CLS
 %token COMM
+%token COMP
+%token COMPQ
 %token CONC
 %token CONDQ
 %token CONF
 %token CONFQ
+%token CONT
 %token CONTQ
+%token CORRQ
+%token COUN
 %token COUNQ
 %token COUP
 %token CW
@@ -43,7 +61,13 @@
 %token DCYC
 %token DCYCQ
 %token DEF
+%token DEL
+%token DELQ
+%token DEPT
+%token DEPTQ
+%token DER
 %token DIG
+%token DIV
 %token ECHO_
 %token ENAB
 %token ENABQ
@@ -52,39 +76,75 @@
 %token ESE
 %token ESEQ
 %token ESRQ
+%token ETS
+%token ETSQ
 %token EVEN
 %token EVENQ
 %token EXT
+%token FACT
+%token FACTQ
+%token FAIL
+%token FAILQ
 %token FETC
+%token FILLQ
+%token FILT
+%token FILTQ
+%token FIR
 %token FIX
+%token FLAT
 %token FLOAT
 %token FORM
 %token FORMQ
+%token FRAC
+%token FRACQ
 %token FREQ
 %token FREQQ
+%token FTIMQ
 %token FUNC
 %token FUNCQ
+%token HANN
 %token HEX
+%token HIST
+%token HISTQ
+%token HPAS
 %token IDNQ
+%token IIR
 %token IMM
 %token INIT
 %token INP
 %token INCL
 %token INT
 %token INTEGER
+%token INTEGRATE
 %token INTERNAL
+%token KEEP
+%token KEEPQ
+%token LATQ
 %token LEV
 %token LEVQ
+%token LIM
+%token LIMQ
 %token LOC
 %token LOCQ
+%token LOG
+%token LOGQ
 %token LOW
 %token LOWQ
+%token LPAS
+%token MATH
 %token MAX
+%token MAXQ
+%token MEAN
+%token MEANQ
 %token MEAS
 %token MIN
+%token MINQ
+%token MINM
+%token MULT
 %token NEG
 %token NEXTQ
 %token NONE
+%token NWIDQ
 %token OCT
 %token OFF
 %token OFFS
@@ -95,13 +155,20 @@
 %token OPER
 %token OPERQ
 %token OREF
+%token OVERQ
 %token PACK
+%token PARTQ
 %token POIN
 %token POINQ
 %token POS
+%token PREQ
 %token PRES
 %token PTP
+%token PERQ
+%token PERCQ
+%token PHASQ
 %token PTPQ
+%token PWIDQ
 %token PULS
 %token QUES
 %token QUESQ
@@ -112,12 +179,20 @@
 %token READ
 %token REAL
 %token RES
+%token RMSQ
+%token RTIMQ
 %token RST
+%token SAMP
+%token SCAL
+%token SCALQ
+%token SDEVQ
 %token SENS
+%token SEQQ
 %token SETUQ
 %token SHAP
 %token SHOWQ
 %token SIN
+%token SINCQ
 %token SLE
 %token SLOP
 %token SLOPQ
@@ -130,20 +205,30 @@
 %token STATE
 %token STATEQ
 %token STATUS
+%token STEPQ
 %token STOR
+%token STOP
+%token STOPQ
 %token STBQ
+%token SUBT
 %token STRING
 %token SQU
 %token SWE
 %token SYST
+%token TAPS
+%token TAPSQ
 %token TCP
 %token TIME
 %token TIMEQ
 %token TINT
 %token TINTQ
+%token TOPQ
+%token TRAN
 %token TRI
 %token TRIG
 %token TSTQ
+%token TYPE
+%token TYPEQ
 %token UINT
 %token UPP
 %token UPPQ
@@ -152,6 +237,10 @@
 %token VERSQ
 %token VOLT
 %token WAI
+%token WAV
+%token WIND
+%token WINDQ
+%token ZERO
 %token EOF_
 
 %start top
@@ -280,6 +369,7 @@ integer
 boolean
     : ON
     | OFF
+    | nr1
     ;
 
 
@@ -315,13 +405,65 @@ conf: CONF
     { scpi_core_add_prefix(info, $1.token); }
     ;
 
+calc: CALC
+    { scpi_core_add_prefix(info, $1.token); }
+    ;
+
+calc_tran
+    : calc COLON TRAN
+    { scpi_core_add_prefix(info, $3.token); }
+    ;
+
+calc_tran_freq
+    : calc_tran COLON FREQ
+    { scpi_core_add_prefix(info, $3.token); }
+    ;
+
+calc_filt
+    : calc COLON FILT
+    { scpi_core_add_prefix(info, $3.token); }
+    ;
+
+calc_lim
+    : calc COLON LIM
+    { scpi_core_add_prefix(info, $3.token); }
+    ;
+
+calc_hist
+    : calc COLON HIST
+    { scpi_core_add_prefix(info, $3.token); }
+    ;
+
+calc_math
+    : calc COLON MATH
+    { scpi_core_add_prefix(info, $3.token); }
+    ;
+
+cal: CAL
+    { scpi_core_add_prefix(info, $1.token); }
+    ;
+
+cal_zero
+    : cal COLON ZERO
+    { scpi_core_add_prefix(info, $3.token); }
+    ;
+
 conf_dig
     : conf COLON DIG
     { scpi_core_add_prefix(info, $3.token); }
     ;
 
+fetc: FETC
+    { scpi_core_add_prefix(info, $1.token); }
+    ;
+
 fetc_dig
-    : FETC COLON DIG
+    : fetc COLON DIG
+    { scpi_core_add_prefix(info, $3.token); }
+    ;
+
+fetc_volt
+    : fetc COLON VOLT
     { scpi_core_add_prefix(info, $3.token); }
     ;
 
@@ -346,6 +488,11 @@ meas_dig
     { scpi_core_add_prefix(info, $3.token); }
     ;
 
+meas_volt
+    : meas COLON VOLT
+    { scpi_core_add_prefix(info, $3.token); }
+    ;
+
 read: READ
     { scpi_core_add_prefix(info, $1.token); }
     ;
@@ -359,11 +506,26 @@ sens: SENS
     { scpi_core_add_prefix(info, $1.token); }
     ;
 
+sens_hist
+    : sens COLON HIST
+    { scpi_core_add_prefix(info, $3.token); }
+    ;
+
 sens_func
     : sens COLON FUNC
     { scpi_core_add_prefix(info, $3.token); }
     ;
 
+sens_aver
+    : sens COLON AVER
+    { scpi_core_add_prefix(info, $3.token); }
+    ;
+
+sens_ets
+    : sens COLON ETS
+    { scpi_core_add_prefix(info, $3.token); }
+    ;
+
 sens_swe
     : sens COLON SWE
     { scpi_core_add_prefix(info, $3.token); }
@@ -389,6 +551,18 @@ sens_volt_dc
     { scpi_core_add_prefix(info, $3.token); }
     ;
 
+sens_volt_rang
+    : sens_volt COLON RANG
+    { scpi_core_add_prefix(info, $3.token); }
+    | sens_volt_dc COLON RANG
+    { scpi_core_add_prefix(info, $3.token); }
+    ;
+
+sens_volt_rang_auto
+    : sens_volt_rang COLON AUTO
+    { scpi_core_add_prefix(info, $3.token); }
+    ;
+
 sour: SOUR
     { scpi_core_add_prefix(info, $1.token); }
     ;
@@ -412,6 +586,10 @@ trig: TRIG
     { scpi_core_add_prefix(info, $1.token); }
     ;
 
+wav: WAV
+    { scpi_core_add_prefix(info, $1.token); }
+    ;
+
 
 sys-cmd
     /* 488.2 10.3 */
@@ -504,6 +682,9 @@ sys-cmd
     | status COLON QUESQ
     { scpi_status_questionableq(info); }
 
+    | stat_ques COLON CONDQ
+    { scpi_status_questionable_conditionq(info); }
+
     | stat_ques COLON ENAB nr1
     { scpi_status_questionable_enable(info, &$4); }
 
@@ -553,6 +734,84 @@ format_arg
     { $$ = *scpi_core_format_type(info, &$1, &$3); }
     ;
 
+volt_func
+    : ACRMQ
+    | AMPLQ
+    | AVERQ
+    | BASEQ
+    | MAXQ
+    | MINQ
+    | OVERQ
+    | PTPQ
+    | RMSQ
+    | TOPQ
+    { $$ = $1; }
+    ;
+
+time_func
+    : DCYCQ
+    | FREQQ
+    | FTIMQ
+    | NWIDQ
+    | PERQ
+    | PWIDQ
+    | RTIMQ
+    { $$ = $1; }
+    ;
+
+pair_func
+    : DELQ
+    | PHASQ
+    { $$ = $1; }
+    | DEL COLON CORRQ
+    { $$ = $3; }
+    ;
+
+fft_window
+    : BHAR
+    | FLAT
+    | HANN
+    { $$ = $1; }
+    ;
+
+decimate_mode
+    : MEAN
+    | MINM
+    | SAMP
+    { $$ = $1; }
+    ;
+
+filter_type
+    : BPAS
+    | HPAS
+    | LPAS
+    { $$ = $1; }
+    ;
+
+filter_form
+    : FIR
+    | IIR
+    { $$ = $1; }
+    ;
+
+math_function
+    : ADD
+    | SUBT
+    | MULT
+    | DIV
+    | INTEGRATE
+    | INT
+    | DER
+    | OFF
+    { $$ = $1; }
+    ;
+
+mask_keep
+    : ALL
+    | FAIL
+    { $$ = $1; }
+    ;
+
 coupling_arg
     : DC
     { $$ = $1; }
@@ -591,6 +850,174 @@ dev-cmd
     : ABOR
     { scpi_dev_abort(info); }
 
+    | AUT
+    { scpi_dev_autoscale(info); }
+
+    | sens COLON AUTO
+    { scpi_dev_autoscale(info); }
+
+    | calc_tran_freq COLON DATQ channel
+    { scpi_dev_calc_transform_frequency_dataq(info, &$4); }
+
+    | calc_tran_freq COLON STEPQ
+    { scpi_dev_calc_transform_frequency_stepq(info); }
+
+    | calc_tran_freq COLON WIND fft_window
+    { scpi_dev_calc_transform_frequency_window(info, &$4); }
+
+    | calc_tran_freq COLON WINDQ
+    { scpi_dev_calc_transform_frequency_windowq(info); }
+
+    | calc_filt boolean
+    { scpi_dev_calc_filter(info, &$2); }
+
+    | calc_filt COLON STATE boolean
+    { scpi_dev_calc_filter(info, &$4); }
+
+    | calc COLON FILTQ
+    { scpi_dev_calc_filterq(info); }
+
+    | calc_filt COLON STATEQ
+    { scpi_dev_calc_filterq(info); }
+
+    | calc_filt COLON TYPE filter_type
+    { scpi_dev_calc_filter_type(info, &$4); }
+
+    | calc_filt COLON TYPEQ
+    { scpi_dev_calc_filter_typeq(info); }
+
+    | calc_filt COLON FORM filter_form
+    { scpi_dev_calc_filter_form(info, &$4); }
+
+    | calc_filt COLON FORMQ
+    { scpi_dev_calc_filter_formq(info); }
+
+    | calc_filt COLON FREQ numeric_value
+    { scpi_dev_calc_filter_frequency(info, &$4, NULL); }
+
+    | calc_filt COLON FREQ numeric_value COMMA numeric_value
+    { scpi_dev_calc_filter_frequency(info, &$4, &$6); }
+
+    | calc_filt COLON FREQQ
+    { scpi_dev_calc_filter_frequencyq(info); }
+
+    | calc_filt COLON TAPS nr1
+    { scpi_dev_calc_filter_taps(info, &$4); }
+
+    | calc_filt COLON TAPSQ
+    { scpi_dev_calc_filter_tapsq(info); }
+
+    | calc_math COLON FUNC math_function channel
+    { scpi_dev_calc_math_function(info, &$4, &$5); }
+
+    | calc_math COLON FUNCQ channel
+    { scpi_dev_calc_math_functionq(info, &$4); }
+
+    | calc_math COLON SOUR nr1 COMMA nr1 channel
+    { scpi_dev_calc_math_source(info, &$4, &$6, &$7); }
+
+    | calc_math COLON SOURQ channel
+    { scpi_dev_calc_math_sourceq(info, &$4); }
+
+    | calc_math COLON SCAL nrf channel
+    { scpi_dev_calc_math_scale(info, &$4, &$5); }
+
+    | calc_math COLON SCALQ channel
+    { scpi_dev_calc_math_scaleq(info, &$4); }
+
+    | calc_math COLON OFFS nrf channel
+    { scpi_dev_calc_math_offset(info, &$4, &$5); }
+
+    | calc_math COLON OFFSQ channel
+    { scpi_dev_calc_math_offsetq(info, &$4); }
+
+    | calc_lim boolean
+    { scpi_dev_calc_limit(info, &$2); }
+
+    | calc_lim COLON STATE boolean
+    { scpi_dev_calc_limit(info, &$4); }
+
+    | calc COLON LIMQ
+    { scpi_dev_calc_limitq(info); }
+
+    | calc_lim COLON STATEQ
+    { scpi_dev_calc_limitq(info); }
+
+    | calc_lim COLON UPP channel COMMA block
+    { scpi_dev_calc_limit_data(info, 1, &$4, &$6); }
+
+    | calc_lim COLON UPPQ channel
+    { scpi_dev_calc_limit_dataq(info, 1, &$4); }
+
+    | calc_lim COLON LOW channel COMMA block
+    { scpi_dev_calc_limit_data(info, 0, &$4, &$6); }
+
+    | calc_lim COLON LOWQ channel
+    { scpi_dev_calc_limit_dataq(info, 0, &$4); }
+
+    | calc_lim COLON FAILQ
+    { scpi_dev_calc_limit_failq(info); }
+
+    | calc_lim COLON COUNQ
+    { scpi_dev_calc_limit_countq(info); }
+
+    | calc_lim COLON CLE
+    { scpi_dev_calc_limit_clear(info); }
+
+    | calc_lim COLON STOP boolean
+    { scpi_dev_calc_limit_stop(info, &$4); }
+
+    | calc_lim COLON STOPQ
+    { scpi_dev_calc_limit_stopq(info); }
+
+    | calc_lim COLON KEEP mask_keep
+    { scpi_dev_calc_limit_keep(info, &$4); }
+
+    | calc_lim COLON KEEPQ
+    { scpi_dev_calc_limit_keepq(info); }
+
+    | calc_hist boolean
+    { scpi_dev_calc_histogram(info, &$2); }
+
+    | calc_hist COLON STATE boolean
+    { scpi_dev_calc_histogram(info, &$4); }
+
+    | calc COLON HISTQ
+    { scpi_dev_calc_histogramq(info); }
+
+    | calc_hist COLON STATEQ
+    { scpi_dev_calc_histogramq(info); }
+
+    | calc_hist COLON DATQ channel
+    { scpi_dev_calc_histogram_dataq(info, &$4); }
+
+    | calc_hist COLON COUNQ
+    { scpi_dev_calc_histogram_countq(info); }
+
+    | calc_hist COLON CLE
+    { scpi_dev_calc_histogram_clear(info); }
+
+    | calc_hist COLON MEANQ channel
+    { scpi_dev_calc_histogram_statq(info, 0, &$4); }
+
+    | calc_hist COLON SDEVQ channel
+    { scpi_dev_calc_histogram_statq(info, 1, &$4); }
+
+    | calc_hist COLON PERCQ channel COMMA numeric_value
+    { scpi_dev_calc_histogram_percentq(info, &$4, &$6); }
+
+    | cal_zero
+    { scpi_dev_cal_zero(info, 0); }
+
+    | cal_zero STOR
+    { scpi_dev_cal_zero(info, 1); }
+
+    | cal_zero COLON COUN nr1
+    { scpi_dev_cal_zero_count(info, &$4); }
+
+    | cal_zero COLON COUNQ
+    { scpi_dev_cal_zero_countq(info); }
+
     | conf_dig COLON DAT
     { scpi_dev_conf_digital_data(info); }
 
@@ -609,6 +1036,15 @@ dev-cmd
     | fetc_dig COLON EVENQ
     { scpi_dev_fetch_digital_eventq(info); }
 
+    | fetc_volt COLON volt_func channel
+    { scpi_dev_fetch_voltageq(info, &$3, &$4); }
+
+    | fetc COLON time_func channel
+    { scpi_dev_fetch_timeq(info, &$3, &$4); }
+
+    | fetc COLON pair_func channel COMMA channel
+    { scpi_dev_fetch_pairq(info, &$3, &$4, &$6); }
+
     | form format_arg
     { scpi_core_format(info, &$2); }
 
@@ -631,6 +1067,12 @@ dev-cmd
     | init_imm COLON ALL
     { scpi_dev_initiate_immediate(info); }
 
+    | init COLON CONT boolean
+    { scpi_dev_initiate_continuous(info, &$4); }
+
+    | init COLON CONTQ
+    { scpi_dev_initiate_continuousq(info); }
+
 
     | INP COLON COUP coupling_arg
     { scpi_dev_input_coupling(info, &$4); }
@@ -644,6 +1086,15 @@ dev-cmd
     | meas_dig COLON EVENQ NUM channel
     { scpi_dev_measure_digital_eventq(info, NULL, &$4, &$5); }
 
+    | meas_volt COLON volt_func channel
+    { scpi_dev_measure_voltageq(info, &$3, &$4); }
+
+    | meas COLON time_func channel
+    { scpi_dev_measure_timeq(info, &$3, &$4); }
+
+    | meas COLON pair_func channel COMMA channel
+    { scpi_dev_measure_pairq(info, &$3, &$4, &$6); }
+
     | read_dig COLON DATQ
     { scpi_dev_read_digital_dataq(info); }
 
@@ -653,6 +1104,81 @@ dev-cmd
     | sens COLON DATQ channel
     { scpi_dev_sense_dataq(info, &$4); }
 
+    | sens COLON DATQ channel COMMA nr1
+    { scpi_dev_sense_data_decimateq(info, &$4, &$6, NULL); }
+
+    | sens COLON DATQ channel COMMA nr1 COMMA decimate_mode
+    { scpi_dev_sense_data_decimateq(info, &$4, &$6, &$8); }
+
+    | sens COLON DAT COLON PARTQ channel COMMA nr1 COMMA nr1
+    { scpi_dev_sense_data_partialq(info, &$6, &$8, &$10); }
+
+    | sens_aver boolean
+    { scpi_dev_sense_average(info, &$2); }
+
+    | sens_aver COLON STATE boolean
+    { scpi_dev_sense_average(info, &$4); }
+
+    | sens COLON AVERQ
+    { scpi_dev_sense_averageq(info); }
+
+    | sens_aver COLON STATEQ
+    { scpi_dev_sense_averageq(info); }
+
+    | sens_aver COLON COUN nr1
+    { scpi_dev_sense_average_count(info, &$4); }
+
+    | sens_aver COLON COUNQ
+    { scpi_dev_sense_average_countq(info); }
+
+    | sens_ets boolean
+    { scpi_dev_sense_ets(info, &$2); }
+
+    | sens_ets COLON STATE boolean
+    { scpi_dev_sense_ets(info, &$4); }
+
+    | sens COLON ETSQ
+    { scpi_dev_sense_etsq(info); }
+
+    | sens_ets COLON STATEQ
+    { scpi_dev_sense_etsq(info); }
+
+    | sens_ets COLON FACT nr1
+    { scpi_dev_sense_ets_factor(info, &$4); }
+
+    | sens_ets COLON FACTQ
+    { scpi_dev_sense_ets_factorq(info); }
+
+    | sens_ets COLON RES
+    { scpi_dev_sense_ets_reset(info); }
+
+    | sens_ets COLON COUNQ
+    { scpi_dev_sense_ets_countq(info); }
+
+    | sens_ets COLON FILLQ
+    { scpi_dev_sense_ets_fillq(info); }
+
+    | sens_ets COLON DATQ channel
+    { scpi_dev_sense_ets_dataq(info, &$4); }
+
+    | sens_hist COLON DEPT nr1
+    { scpi_dev_sense_history_depth(info, &$4); }
+
+    | sens_hist COLON DEPTQ
+    { scpi_dev_sense_history_depthq(info); }
+
+    | sens_hist COLON SEQQ
+    { scpi_dev_sense_history_sequenceq(info); }
+
+    | sens_hist COLON DATQ nr1 channel
+    { scpi_dev_sense_history_dataq(info, &$4, &$5); }
+
+    | sens_hist COLON LATQ nr1 channel
+    { scpi_dev_sense_history_latestq(info, &$4, &$5); }
+
+    | sens_hist COLON SINCQ nr1 channel
+    { scpi_dev_sense_history_sinceq(info, &$4, &$5); }
+
     | sens_func COLON CONC boolean
     { scpi_dev_sense_function_concurrent(info, &$4); }
 
@@ -764,6 +1290,18 @@ dev-cmd
     | sens_volt_dc COLON RANGQ channel
     { scpi_dev_sense_voltage_upq(info, &$4); }
 
+    | sens_volt_rang_auto boolean channel
+    { scpi_dev_sense_voltage_range_auto(info, &$2, &$3); }
+
+    | sens_volt_rang COLON AUTOQ channel
+    { scpi_dev_sense_voltage_range_autoq(info, &$4); }
+
+    | sens_volt_rang_auto COLON FRAC nrf
+    { scpi_dev_sense_voltage_range_auto_fraction(info, &$4); }
+
+    | sens_volt_rang_auto COLON FRACQ
+    { scpi_dev_sense_voltage_range_auto_fractionq(info); }
+
     | sens_volt COLON UPPQ channel
     { scpi_dev_sense_voltage_upq(info, &$4); }
 
@@ -833,6 +1371,9 @@ dev-cmd
     | trig COLON SOURQ
     { scpi_dev_trigger_sourceq(info); }
 
+    | wav COLON PREQ channel
+    { scpi_dev_waveform_preambleq(info, &$4); }
+
     | syst COLON COMM COLON TCP COLON CONTQ
     { scpi_system_communicate_tcp_controlq(info); }
 
@@ -860,6 +1401,21 @@ dev-cmd
     | syst_int COLON OFFSQ
     { scpi_system_internal_offsetq(info); }
 
+    | syst_int COLON LOG STRING
+    { scpi_system_internal_log(info, &$4); }
+
+    | syst_int COLON LOG COLON STOP
+    { scpi_system_internal_log_stop(info); }
+
+    | syst_int COLON LOGQ
+    { scpi_system_internal_logq(info); }
+
+    | syst_int COLON LOG COLON COMP boolean
+    { scpi_system_internal_log_compress(info, &$6); }
+
+    | syst_int COLON LOG COLON COMPQ
+    { scpi_system_internal_log_compressq(info); }
+
     | SLE numeric_value
     { scpi_system_internal_sleep(info, &$2); }
 
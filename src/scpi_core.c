@@ -21,6 +21,7 @@
 #include "scpi_input.h"
 #include "parser.h"
 #include "event.h"
+#include "worker.h"
 
 static uint8_t scpi_core_status_update(struct info *info)
 {
@@ -123,6 +124,7 @@ void scpi_common_opcq(struct info *info)
 
 void scpi_common_rst(struct info *info)
 {
+    info->scpi->format = SCPI_FORMAT_ASCII;
     scpi_dev_rst(info);
     scpi_common_opc(info);
 }
@@ -199,6 +201,14 @@ void scpi_status_operation_conditionq(struct info *info)
 {
     uint16_t cond = 0;
 
+    if (info->cal_status) {
+        cond |= SCPI_OPER_CAL;
+    }
+
+    if (info->range_status) {
+        cond |= SCPI_OPER_RANG;
+    }
+
     if (info->sweep_status) {
         cond |= SCPI_OPER_SWE;
     }
@@ -231,8 +241,29 @@ void scpi_status_operation_preset(struct info *info)
     (void)info;
 }
 
+/* Latch QUEStionable conditions newly set into the event register. */
+void scpi_status_questionable_update(struct info *info)
+{
+    uint16_t cond = 0;
+
+    if (info->clip_status) {
+        cond |= SCPI_QUES_VOLT;
+    }
+
+    info->scpi->ques.event |= (uint16_t)(cond & ~info->scpi->ques.cond);
+    info->scpi->ques.cond = cond;
+}
+
+/* Reading the event register clears it. */
 void scpi_status_questionableq(struct info *info)
 {
+    scpi_output_int(info->output, info->scpi->ques.event);
+    info->scpi->ques.event = 0;
+}
+
+void scpi_status_questionable_conditionq(struct info *info)
+{
+    scpi_status_questionable_update(info);
     scpi_output_int(info->output, info->scpi->ques.cond);
 }
 
@@ -403,13 +434,42 @@ struct scpi_type *scpi_core_symbolic_value(struct info *info,
 
 void scpi_core_format(struct info *info, struct scpi_type *v)
 {
-    (void)info;
-    (void)v;
+    const char *value = NULL;
+
+    if (v->type == SCPI_TYPE_STR) {
+        scpi_input_str(info, v, &value);
+    }
+
+    if (value && scpi_input_keyword(value, "ASCii")) {
+        info->scpi->format = SCPI_FORMAT_ASCII;
+    } else if (value && scpi_input_keyword(value, "PACK")) {
+        info->scpi->format = SCPI_FORMAT_PACKED;
+    } else if (value && scpi_input_keyword(value, "REAL")) {
+        info->scpi->format = SCPI_FORMAT_REAL;
+    } else {
+        /* Recognized by the grammar, but not supported. */
+        scpi_error(info->error, SCPI_ERR_ILLEGAL_PARAMETER_VALUE, v->src);
+    }
 }
 
 void scpi_core_formatq(struct info *info)
 {
-    (void)info;
+    const char *str = NULL;
+
+    switch (info->scpi->format) {
+    case SCPI_FORMAT_ASCII:
+        str = "ASC";
+        break;
+    case SCPI_FORMAT_PACKED:
+        str = "PACK";
+        break;
+    case SCPI_FORMAT_REAL:
+        str = "REAL";
+        break;
+    default:
+        assert(0);
+    }
+    scpi_output_str(info->output, str);
 }
 
 void scpi_system_communicate_tcp_controlq(struct info *info)
@@ -479,7 +539,27 @@ static void scpi_core_output_flush(void *arg)
 {
     struct info *info = arg;
 
-    scpi_output_flush(info->output, info->cli_out_fd);
+    if (scpi_output_flush(info->output, info->cli_out_fd)) {
+        /* Some or all of the response never reached the client. */
+        scpi_error(info->error, SCPI_ERR_QUERY_INTERRUPTED, NULL);
+    }
+}
+
+static int scpi_core_output_drain(void *arg)
+{
+    struct info *info = arg;
+
+    /* A client that has gone away is noticed on the input side. */
+    (void)scpi_output_drain(info->output);
+
+    return 0;
+}
+
+static int scpi_core_output_busy(void *arg)
+{
+    struct info *info = arg;
+
+    return scpi_output_pending(info->output);
 }
 
 static void scpi_core_sigalrm(int sig)
@@ -531,6 +611,18 @@ int scpi_core_init(struct info *info)
             break;
         }
 
+        /* Large responses are spilled to the client as they are built. */
+        scpi_output_fd(info->output, info->cli_out_fd);
+
+        err = worker_add_output(info->worker,
+                                info->cli_out_fd,
+                                scpi_core_output_drain,
+                                scpi_core_output_busy,
+                                info);
+        if (err) {
+            break;
+        }
+
         err = event_add(info->event,
                         EVENT_UNBLOCK,
                         scpi_core_unblock,
@@ -20,11 +20,22 @@
 #define SCPI_SBR_MSS  (1u<<6) /* SBR  bit 6 Master Summary Status */
 #define SCPI_SBR_OPER (1u<<7) /* SBR  bit 7 SCPI OPERation status */
 
+#define SCPI_OPER_CAL (1u<<0) /* OPER bit 0 SCPI OPERation CALibrating */
+#define SCPI_OPER_RANG (1u<<2) /* OPER bit 2 SCPI OPERation RANGing */
 #define SCPI_OPER_SWE (1u<<3) /* OPER bit 3 SCPI OPERation SWEEP */
 /* Bits 8-12 "available to designer" */
 #define SCPI_OPER_DE  (1u<<8) /* OPER bit 8 SCPI OPERation Digital Event */
 #define SCPI_OPER_OF  (1u<<9) /* OPER bit 9 SCPI OPERation Obtaining Offsets */
 
+#define SCPI_QUES_VOLT (1u<<0) /* QUES bit 0 SCPI QUEStionable VOLTage */
+
+/* FORMat[:DATA] response data types */
+enum scpi_format {
+    SCPI_FORMAT_ASCII,          /* ASCii: comma separated NR3 values */
+    SCPI_FORMAT_PACKED,         /* PACKed: raw device codes in a block */
+    SCPI_FORMAT_REAL,           /* REAL: IEEE 754 doubles in a block */
+};
+
 struct scpi_reg {
     uint16_t            cond;   /* Condition Register */
     uint16_t            pos;    /* Positive Transition Filter Register */
@@ -42,6 +53,8 @@ struct scpi_core {
     uint8_t             sesr;   /* Standard Event Status Register */
     uint8_t             sbr;    /* Status Byte Register */
     uint8_t             srer;   /* Service Request Enable Register */
+    /* FORMat[:DATA] */
+    enum scpi_format    format;
     /* Internal memory pool(s) */
     void *pool;
     /* Internal flags */
@@ -50,5 +63,6 @@ struct scpi_core {
 
 extern int scpi_core_init(struct info *info);
 extern int scpi_core_done(struct info *info);
+extern void scpi_status_questionable_update(struct info *info);
 
 #endif /* SCPI_CORE_H_ */
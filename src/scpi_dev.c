@@ -8,11 +8,18 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 #include "scpi.h"
 #include "scpi_core.h"
 #include "scpi_input.h"
+#include "history.h"
+#include "meas.h"
+#include "fft.h"
+#include "ets.h"
+#include "filter.h"
+#include "mathchan.h"
 #include "cgr101.h"
 
 int scpi_dev_abort(struct info *info)
@@ -22,6 +29,11 @@ int scpi_dev_abort(struct info *info)
     return 0;
 }
 
+void scpi_dev_autoscale(struct info *info)
+{
+    cgr101_autoscale(info);
+}
+
 int scpi_dev_initiate(struct info *info)
 {
     return cgr101_initiate(info);
@@ -32,6 +44,20 @@ void scpi_dev_initiate_immediate(struct info *info)
     cgr101_initiate_immediate(info);
 }
 
+void scpi_dev_initiate_continuous(struct info *info, struct scpi_type *v)
+{
+    int value;
+
+    if (!scpi_input_boolean(info, v, &value)) {
+        cgr101_initiate_continuous(info, value);
+    }
+}
+
+void scpi_dev_initiate_continuousq(struct info *info)
+{
+    cgr101_initiate_continuousq(info);
+}
+
 struct scpi_type *scpi_dev_channel_num(struct info *info,
                                        struct scpi_type *val)
 {
@@ -161,6 +187,650 @@ void scpi_dev_sense_dataq(struct info *info, struct scpi_type *v)
     }
 }
 
+void scpi_dev_sense_data_partialq(struct info *info,
+                                  struct scpi_type *v1,
+                                  struct scpi_type *v2,
+                                  struct scpi_type *v3)
+{
+    long chan_mask;
+    long start;
+    long count;
+
+    if (!scpi_dev_chan(v1, &chan_mask) &&
+        !scpi_input_int(info, v2, 0, CAPTURE_NUM_SAMPLE - 1, &start) &&
+        !scpi_input_int(info, v3, 1, CAPTURE_NUM_SAMPLE - start, &count)) {
+        cgr101_digitizer_partialq(info, start, count, chan_mask);
+    }
+}
+
+void scpi_dev_sense_data_decimateq(struct info *info,
+                                   struct scpi_type *v1,
+                                   struct scpi_type *v2,
+                                   struct scpi_type *v3)
+{
+    const char *mode = NULL;
+    long chan_mask;
+    long points;
+
+    if (!scpi_dev_chan(v1, &chan_mask) &&
+        !scpi_input_int(info, v2, 1, CAPTURE_NUM_SAMPLE, &points) &&
+        (!v3 || !scpi_input_str(info, v3, &mode))) {
+        cgr101_digitizer_decimateq(info, points, mode, chan_mask);
+    }
+}
+
+void scpi_dev_fetch_voltageq(struct info *info,
+                             struct scpi_type *v1,
+                             struct scpi_type *v2)
+{
+    const char *func;
+    long chan_mask;
+
+    if (!scpi_input_str(info, v1, &func) &&
+        !scpi_dev_chan(v2, &chan_mask)) {
+        cgr101_fetch_voltage(info, func, chan_mask);
+    }
+}
+
+void scpi_dev_measure_voltageq(struct info *info,
+                               struct scpi_type *v1,
+                               struct scpi_type *v2)
+{
+    const char *func;
+    long chan_mask;
+
+    if (!scpi_input_str(info, v1, &func) &&
+        !scpi_dev_chan(v2, &chan_mask)) {
+        cgr101_measure_voltage(info, func, chan_mask);
+    }
+}
+
+void scpi_dev_fetch_timeq(struct info *info,
+                          struct scpi_type *v1,
+                          struct scpi_type *v2)
+{
+    const char *func;
+    long chan_mask;
+
+    if (!scpi_input_str(info, v1, &func) &&
+        !scpi_dev_chan(v2, &chan_mask)) {
+        cgr101_fetch_time(info, func, chan_mask);
+    }
+}
+
+void scpi_dev_measure_timeq(struct info *info,
+                            struct scpi_type *v1,
+                            struct scpi_type *v2)
+{
+    const char *func;
+    long chan_mask;
+
+    if (!scpi_input_str(info, v1, &func) &&
+        !scpi_dev_chan(v2, &chan_mask)) {
+        cgr101_measure_time(info, func, chan_mask);
+    }
+}
+
+/* A channel list naming exactly one oscilloscope or math channel. */
+static int scpi_dev_one_chan(struct info *info,
+                             struct scpi_type *v,
+                             long *chan_mask)
+{
+    long trace = ((1L << CGR101_NUM_SCOPE) - 1) |
+        (((1L << CGR101_NUM_MATH) - 1) << (CGR101_MATH_CHAN - 1));
+    int err = scpi_dev_chan(v, chan_mask);
+
+    if (!err &&
+        (*chan_mask == 0 ||
+         (*chan_mask & (*chan_mask - 1)) ||
+         (*chan_mask & ~trace))) {
+        scpi_error(info->error, SCPI_ERR_ILLEGAL_PARAMETER_VALUE, v->src);
+        err = 1;
+    }
+
+    return err;
+}
+
+void scpi_dev_fetch_pairq(struct info *info,
+                          struct scpi_type *v1,
+                          struct scpi_type *v2,
+                          struct scpi_type *v3)
+{
+    const char *func;
+    long a_mask;
+    long b_mask;
+
+    if (!scpi_input_str(info, v1, &func) &&
+        !scpi_dev_one_chan(info, v2, &a_mask) &&
+        !scpi_dev_one_chan(info, v3, &b_mask)) {
+        cgr101_fetch_pair(info, func, a_mask, b_mask);
+    }
+}
+
+void scpi_dev_measure_pairq(struct info *info,
+                            struct scpi_type *v1,
+                            struct scpi_type *v2,
+                            struct scpi_type *v3)
+{
+    const char *func;
+    long a_mask;
+    long b_mask;
+
+    if (!scpi_input_str(info, v1, &func) &&
+        !scpi_dev_one_chan(info, v2, &a_mask) &&
+        !scpi_dev_one_chan(info, v3, &b_mask)) {
+        cgr101_measure_pair(info, func, a_mask, b_mask);
+    }
+}
+
+void scpi_dev_calc_transform_frequency_dataq(struct info *info,
+                                             struct scpi_type *v)
+{
+    long chan_mask;
+
+    if (!scpi_dev_chan(v, &chan_mask)) {
+        cgr101_spectrum_dataq(info, chan_mask);
+    }
+}
+
+void scpi_dev_calc_transform_frequency_stepq(struct info *info)
+{
+    cgr101_spectrum_stepq(info);
+}
+
+void scpi_dev_calc_transform_frequency_window(struct info *info,
+                                              struct scpi_type *v)
+{
+    const char *value;
+
+    if (!scpi_input_str(info, v, &value)) {
+        cgr101_spectrum_window(info, value);
+    }
+}
+
+void scpi_dev_calc_transform_frequency_windowq(struct info *info)
+{
+    cgr101_spectrum_windowq(info);
+}
+
+void scpi_dev_calc_filter(struct info *info, struct scpi_type *v)
+{
+    int value;
+
+    if (!scpi_input_boolean(info, v, &value)) {
+        cgr101_filter(info, value);
+    }
+}
+
+void scpi_dev_calc_filterq(struct info *info)
+{
+    cgr101_filterq(info);
+}
+
+void scpi_dev_calc_filter_type(struct info *info, struct scpi_type *v)
+{
+    const char *value;
+
+    if (!scpi_input_str(info, v, &value)) {
+        cgr101_filter_type(info, value);
+    }
+}
+
+void scpi_dev_calc_filter_typeq(struct info *info)
+{
+    cgr101_filter_typeq(info);
+}
+
+void scpi_dev_calc_filter_form(struct info *info, struct scpi_type *v)
+{
+    const char *value;
+
+    if (!scpi_input_str(info, v, &value)) {
+        cgr101_filter_form(info, value);
+    }
+}
+
+void scpi_dev_calc_filter_formq(struct info *info)
+{
+    cgr101_filter_formq(info);
+}
+
+void scpi_dev_calc_filter_frequency(struct info *info,
+                                    struct scpi_type *v1,
+                                    struct scpi_type *v2)
+{
+    double f1;
+    double f2 = 0.0;
+
+    if (!scpi_input_fp(info, v1, &f1) &&
+        (!v2 || !scpi_input_fp(info, v2, &f2))) {
+        cgr101_filter_frequency(info, f1, f2);
+    }
+}
+
+void scpi_dev_calc_filter_frequencyq(struct info *info)
+{
+    cgr101_filter_frequencyq(info);
+}
+
+void scpi_dev_calc_filter_taps(struct info *info, struct scpi_type *v)
+{
+    long taps;
+
+    if (!scpi_input_int(info, v, 3, FILTER_MAX_TAPS, &taps)) {
+        cgr101_filter_taps(info, taps);
+    }
+}
+
+void scpi_dev_calc_filter_tapsq(struct info *info)
+{
+    cgr101_filter_tapsq(info);
+}
+
+/* A channel list of math channels only. */
+static int scpi_dev_math_chan(struct info *info,
+                              struct scpi_type *v,
+                              long *chan_mask)
+{
+    long math = ((1L << CGR101_NUM_MATH) - 1) << (CGR101_MATH_CHAN - 1);
+    int err = scpi_dev_chan(v, chan_mask);
+
+    if (!err && (*chan_mask & ~math)) {
+        scpi_error(info->error, SCPI_ERR_ILLEGAL_PARAMETER_VALUE, v->src);
+        err = 1;
+    }
+
+    return err;
+}
+
+void scpi_dev_calc_math_function(struct info *info,
+                                 struct scpi_type *v1,
+                                 struct scpi_type *v2)
+{
+    const char *value;
+    long chan_mask;
+
+    if (!scpi_input_str(info, v1, &value) &&
+        !scpi_dev_math_chan(info, v2, &chan_mask)) {
+        cgr101_math_function(info, chan_mask, value);
+    }
+}
+
+void scpi_dev_calc_math_functionq(struct info *info, struct scpi_type *v)
+{
+    long chan_mask;
+
+    if (!scpi_dev_math_chan(info, v, &chan_mask)) {
+        cgr101_math_functionq(info, chan_mask);
+    }
+}
+
+void scpi_dev_calc_math_source(struct info *info,
+                               struct scpi_type *v1,
+                               struct scpi_type *v2,
+                               struct scpi_type *v3)
+{
+    long a;
+    long b;
+    long chan_mask;
+
+    if (!scpi_input_int(info, v1, 1, CAPTURE_NUM_CHAN, &a) &&
+        !scpi_input_int(info, v2, 1, CAPTURE_NUM_CHAN, &b) &&
+        !scpi_dev_math_chan(info, v3, &chan_mask)) {
+        cgr101_math_source(info, chan_mask, a, b);
+    }
+}
+
+void scpi_dev_calc_math_sourceq(struct info *info, struct scpi_type *v)
+{
+    long chan_mask;
+
+    if (!scpi_dev_math_chan(info, v, &chan_mask)) {
+        cgr101_math_sourceq(info, chan_mask);
+    }
+}
+
+void scpi_dev_calc_math_scale(struct info *info,
+                              struct scpi_type *v1,
+                              struct scpi_type *v2)
+{
+    double value;
+    long chan_mask;
+
+    if (!scpi_input_fp(info, v1, &value) &&
+        !scpi_dev_math_chan(info, v2, &chan_mask)) {
+        cgr101_math_scale(info, chan_mask, value);
+    }
+}
+
+void scpi_dev_calc_math_scaleq(struct info *info, struct scpi_type *v)
+{
+    long chan_mask;
+
+    if (!scpi_dev_math_chan(info, v, &chan_mask)) {
+        cgr101_math_scaleq(info, chan_mask);
+    }
+}
+
+void scpi_dev_calc_math_offset(struct info *info,
+                               struct scpi_type *v1,
+                               struct scpi_type *v2)
+{
+    double value;
+    long chan_mask;
+
+    if (!scpi_input_fp(info, v1, &value) &&
+        !scpi_dev_math_chan(info, v2, &chan_mask)) {
+        cgr101_math_offset(info, chan_mask, value);
+    }
+}
+
+void scpi_dev_calc_math_offsetq(struct info *info, struct scpi_type *v)
+{
+    long chan_mask;
+
+    if (!scpi_dev_math_chan(info, v, &chan_mask)) {
+        cgr101_math_offsetq(info, chan_mask);
+    }
+}
+
+void scpi_dev_calc_limit(struct info *info, struct scpi_type *v)
+{
+    int value;
+
+    if (!scpi_input_boolean(info, v, &value)) {
+        cgr101_mask(info, value);
+    }
+}
+
+void scpi_dev_calc_limitq(struct info *info)
+{
+    cgr101_maskq(info);
+}
+
+void scpi_dev_calc_limit_data(struct info *info,
+                              int upper,
+                              struct scpi_type *v1,
+                              struct scpi_type *v2)
+{
+    long chan_mask;
+    size_t len;
+    double *value;
+
+    if (!scpi_dev_chan(v1, &chan_mask) &&
+        !scpi_input_fp_block(info, v2, &len, &value)) {
+        cgr101_mask_limit(info, upper, chan_mask, len, value);
+    }
+}
+
+void scpi_dev_calc_limit_dataq(struct info *info,
+                               int upper,
+                               struct scpi_type *v)
+{
+    long chan_mask;
+
+    if (!scpi_dev_chan(v, &chan_mask)) {
+        cgr101_mask_limitq(info, upper, chan_mask);
+    }
+}
+
+void scpi_dev_calc_limit_failq(struct info *info)
+{
+    cgr101_mask_failq(info);
+}
+
+void scpi_dev_calc_limit_countq(struct info *info)
+{
+    cgr101_mask_countq(info);
+}
+
+void scpi_dev_calc_limit_clear(struct info *info)
+{
+    cgr101_mask_clear(info);
+}
+
+void scpi_dev_calc_limit_stop(struct info *info, struct scpi_type *v)
+{
+    int value;
+
+    if (!scpi_input_boolean(info, v, &value)) {
+        cgr101_mask_stop(info, value);
+    }
+}
+
+void scpi_dev_calc_limit_stopq(struct info *info)
+{
+    cgr101_mask_stopq(info);
+}
+
+void scpi_dev_calc_limit_keep(struct info *info, struct scpi_type *v)
+{
+    const char *value;
+
+    if (!scpi_input_str(info, v, &value)) {
+        cgr101_mask_keep(info, value);
+    }
+}
+
+void scpi_dev_calc_limit_keepq(struct info *info)
+{
+    cgr101_mask_keepq(info);
+}
+
+void scpi_dev_calc_histogram(struct info *info, struct scpi_type *v)
+{
+    int value;
+
+    if (!scpi_input_boolean(info, v, &value)) {
+        cgr101_hist(info, value);
+    }
+}
+
+void scpi_dev_calc_histogramq(struct info *info)
+{
+    cgr101_histq(info);
+}
+
+void scpi_dev_calc_histogram_dataq(struct info *info, struct scpi_type *v)
+{
+    long chan_mask;
+
+    if (!scpi_dev_chan(v, &chan_mask)) {
+        cgr101_hist_dataq(info, chan_mask);
+    }
+}
+
+void scpi_dev_calc_histogram_countq(struct info *info)
+{
+    cgr101_hist_countq(info);
+}
+
+void scpi_dev_calc_histogram_clear(struct info *info)
+{
+    cgr101_hist_clear(info);
+}
+
+void scpi_dev_calc_histogram_statq(struct info *info,
+                                   int sdev,
+                                   struct scpi_type *v)
+{
+    long chan_mask;
+
+    if (!scpi_dev_chan(v, &chan_mask)) {
+        cgr101_hist_statq(info, sdev, chan_mask);
+    }
+}
+
+void scpi_dev_calc_histogram_percentq(struct info *info,
+                                      struct scpi_type *v1,
+                                      struct scpi_type *v2)
+{
+    long chan_mask;
+    double pct;
+
+    if (!scpi_dev_chan(v1, &chan_mask) &&
+        !scpi_input_fp_range(info, v2, 0.0, 100.0, &pct)) {
+        cgr101_hist_percentq(info, pct, chan_mask);
+    }
+}
+
+void scpi_dev_cal_zero(struct info *info, int store)
+{
+    cgr101_cal_zero(info, store);
+}
+
+void scpi_dev_cal_zero_count(struct info *info, struct scpi_type *v)
+{
+    long count;
+
+    if (!scpi_input_int(info, v, 1, CGR101_CAL_MAX_COUNT, &count)) {
+        cgr101_cal_zero_count(info, count);
+    }
+}
+
+void scpi_dev_cal_zero_countq(struct info *info)
+{
+    cgr101_cal_zero_countq(info);
+}
+
+void scpi_dev_sense_ets(struct info *info, struct scpi_type *v)
+{
+    int value;
+
+    if (!scpi_input_boolean(info, v, &value)) {
+        cgr101_ets(info, value);
+    }
+}
+
+void scpi_dev_sense_etsq(struct info *info)
+{
+    cgr101_etsq(info);
+}
+
+void scpi_dev_sense_ets_factor(struct info *info, struct scpi_type *v)
+{
+    long factor;
+
+    if (!scpi_input_int(info, v, 1, ETS_MAX_FACTOR, &factor)) {
+        cgr101_ets_factor(info, factor);
+    }
+}
+
+void scpi_dev_sense_ets_factorq(struct info *info)
+{
+    cgr101_ets_factorq(info);
+}
+
+void scpi_dev_sense_ets_reset(struct info *info)
+{
+    cgr101_ets_reset(info);
+}
+
+void scpi_dev_sense_ets_countq(struct info *info)
+{
+    cgr101_ets_countq(info);
+}
+
+void scpi_dev_sense_ets_fillq(struct info *info)
+{
+    cgr101_ets_fillq(info);
+}
+
+void scpi_dev_sense_ets_dataq(struct info *info, struct scpi_type *v)
+{
+    long chan_mask;
+
+    if (!scpi_dev_chan(v, &chan_mask)) {
+        cgr101_ets_dataq(info, chan_mask);
+    }
+}
+
+void scpi_dev_sense_average(struct info *info, struct scpi_type *v)
+{
+    int value;
+
+    if (!scpi_input_boolean(info, v, &value)) {
+        cgr101_average(info, value);
+    }
+}
+
+void scpi_dev_sense_averageq(struct info *info)
+{
+    cgr101_averageq(info);
+}
+
+void scpi_dev_sense_average_count(struct info *info, struct scpi_type *v)
+{
+    long count;
+
+    if (!scpi_input_int(info, v, 1, CAPTURE_MAX_COUNT, &count)) {
+        cgr101_average_count(info, count);
+    }
+}
+
+void scpi_dev_sense_average_countq(struct info *info)
+{
+    cgr101_average_countq(info);
+}
+
+void scpi_dev_sense_history_depth(struct info *info, struct scpi_type *v)
+{
+    long depth;
+
+    if (!scpi_input_int(info, v, 1, HISTORY_MAX_DEPTH, &depth)) {
+        cgr101_history_depth(info, depth);
+    }
+}
+
+void scpi_dev_sense_history_depthq(struct info *info)
+{
+    cgr101_history_depthq(info);
+}
+
+void scpi_dev_sense_history_sequenceq(struct info *info)
+{
+    cgr101_history_sequenceq(info);
+}
+
+void scpi_dev_sense_history_dataq(struct info *info,
+                                  struct scpi_type *v1,
+                                  struct scpi_type *v2)
+{
+    long seq;
+    long chan_mask;
+
+    if (!scpi_input_int(info, v1, 1, LONG_MAX, &seq) &&
+        !scpi_dev_chan(v2, &chan_mask)) {
+        cgr101_history_dataq(info, seq, chan_mask);
+    }
+}
+
+void scpi_dev_sense_history_latestq(struct info *info,
+                                    struct scpi_type *v1,
+                                    struct scpi_type *v2)
+{
+    long count;
+    long chan_mask;
+
+    if (!scpi_input_int(info, v1, 1, HISTORY_MAX_DEPTH, &count) &&
+        !scpi_dev_chan(v2, &chan_mask)) {
+        cgr101_history_latestq(info, count, chan_mask);
+    }
+}
+
+void scpi_dev_sense_history_sinceq(struct info *info,
+                                   struct scpi_type *v1,
+                                   struct scpi_type *v2)
+{
+    long seq;
+    long chan_mask;
+
+    if (!scpi_input_int(info, v1, 0, LONG_MAX, &seq) &&
+        !scpi_dev_chan(v2, &chan_mask)) {
+        cgr101_history_sinceq(info, seq, chan_mask);
+    }
+}
+
 void scpi_dev_sense_function_concurrent(struct info *info,
                                         struct scpi_type *v)
 {
@@ -359,6 +1029,48 @@ void scpi_dev_sense_voltage_up(struct info *info,
     }
 }
 
+void scpi_dev_sense_voltage_range_auto(struct info *info,
+                                       struct scpi_type *v,
+                                       struct scpi_type *chan)
+{
+    int value;
+    long chan_mask;
+    int err_v;
+    int err_c;
+
+    err_v = scpi_input_boolean(info, v, &value);
+    err_c = scpi_dev_chan(chan, &chan_mask);
+    if (!err_v && !err_c) {
+        cgr101_digitizer_range_auto(info, chan_mask, value);
+    }
+}
+
+void scpi_dev_sense_voltage_range_autoq(struct info *info,
+                                        struct scpi_type *chan)
+{
+    long chan_mask;
+
+    if (!scpi_dev_chan(chan, &chan_mask)) {
+        cgr101_digitizer_range_autoq(info, chan_mask);
+    }
+}
+
+void scpi_dev_sense_voltage_range_auto_fraction(struct info *info,
+                                                struct scpi_type *v)
+{
+    double value;
+
+    if (!scpi_input_fp_range(info, v, 0.0, CGR101_RANGE_AUTO_MAX_FRAC,
+                             &value)) {
+        cgr101_digitizer_range_auto_fraction(info, value);
+    }
+}
+
+void scpi_dev_sense_voltage_range_auto_fractionq(struct info *info)
+{
+    cgr101_digitizer_range_auto_fractionq(info);
+}
+
 void scpi_dev_sense_voltage_lowq(struct info *info,
                                  struct scpi_type *chan)
 {
@@ -570,6 +1282,15 @@ void scpi_dev_trigger_sourceq(struct info *info)
     cgr101_trigger_sourceq(info);
 }
 
+void scpi_dev_waveform_preambleq(struct info *info, struct scpi_type *v)
+{
+    long chan_mask;
+
+    if (!scpi_dev_chan(v, &chan_mask)) {
+        cgr101_waveform_preambleq(info, chan_mask);
+    }
+}
+
 void scpi_dev_identify(struct info *info)
 {
     cgr101_identify(info);
@@ -709,3 +1430,37 @@ void scpi_system_internal_offsetq(struct info *info)
 {
     cgr101_digitizer_input_offsetq(info);
 }
+
+void scpi_system_internal_log(struct info *info, struct scpi_type *v)
+{
+    const char *path;
+
+    if (!scpi_input_str(info, v, &path)) {
+        cgr101_log(info, path);
+    }
+}
+
+void scpi_system_internal_log_stop(struct info *info)
+{
+    cgr101_log_stop(info);
+}
+
+void scpi_system_internal_logq(struct info *info)
+{
+    cgr101_logq(info);
+}
+
+void scpi_system_internal_log_compress(struct info *info,
+                                      struct scpi_type *v)
+{
+    int value;
+
+    if (!scpi_input_boolean(info, v, &value)) {
+        cgr101_log_compress(info, value);
+    }
+}
+
+void scpi_system_internal_log_compressq(struct info *info)
+{
+    cgr101_log_compressq(info);
+}
@@ -36,18 +36,36 @@ static struct {
     { SCPI_ERR_UNDEFINED_HEADER,
       "Undefined header"
     },
+    { SCPI_ERR_SETTINGS_CONFLICT,
+      "Settings conflict"
+    },
     { SCPI_ERR_DATA_OUT_OF_RANGE,
       "Data out of range"
     },
+    { SCPI_ERR_ILLEGAL_PARAMETER_VALUE,
+      "Illegal parameter value"
+    },
+    { SCPI_ERR_OUT_OF_MEMORY,
+      "Out of memory"
+    },
+    { SCPI_ERR_DATA_STALE,
+      "Data corrupt or stale"
+    },
     { SCPI_ERR_QUEUE_OVERFLOW,
       "Queue Overflow"
     },
+    { SCPI_ERR_QUERY_INTERRUPTED,
+      "Query INTERRUPTED"
+    },
     { SCPI_ERR_INTERNAL_PARSER_ERROR,
       "Parser Error"
     },
     { SCPI_ERR_HARDWARE_ERROR,
       "Hardware error"
     },
+    { SCPI_ERR_MASS_STORAGE_ERROR,
+      "Mass storage error"
+    },
     { SCPI_ERR_NONE,
       NULL,
     }
@@ -17,9 +17,15 @@ enum scpi_err_num {
     SCPI_ERR_NONE = 0,
     SCPI_ERR_INTERNAL_PARSER_ERROR = 100,
     SCPI_ERR_UNDEFINED_HEADER = -113,
+    SCPI_ERR_SETTINGS_CONFLICT = -221,
     SCPI_ERR_DATA_OUT_OF_RANGE = -222,
+    SCPI_ERR_ILLEGAL_PARAMETER_VALUE = -224,
+    SCPI_ERR_OUT_OF_MEMORY = -225,
+    SCPI_ERR_DATA_STALE = -230,
     SCPI_ERR_HARDWARE_ERROR = -240,
+    SCPI_ERR_MASS_STORAGE_ERROR = -250,
     SCPI_ERR_QUEUE_OVERFLOW = -350,
+    SCPI_ERR_QUERY_INTERRUPTED = -410,
 };
 
 struct scpi_errq;
@@ -6,10 +6,12 @@
 */
 
 #include <assert.h>
+#include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include "info.h"
+#include "scpi.h"
+#include "scpi.tab.h"
 #include "scpi_error.h"
 #include "scpi_input.h"
 
@@ -38,7 +40,18 @@ int scpi_input_boolean(struct info *info,
                        int *out)
 {
     long ival;
-    int err = scpi_input_int(info, in, 0, 1, &ival);
+    int err = 0;
+
+    if (in->type == SCPI_TYPE_INT) {
+        err = scpi_input_int(info, in, 0, 1, &ival);
+    } else if (in->token == ON) {
+        ival = 1;
+    } else if (in->token == OFF) {
+        ival = 0;
+    } else {
+        err = 1;
+        scpi_error(info->error, SCPI_ERR_ILLEGAL_PARAMETER_VALUE, in->src);
+    }
 
     if (!err) {
         *out = (int)ival;
@@ -170,3 +183,32 @@ int scpi_input_str(struct info *info, struct scpi_type *in, const char **out)
 
     return 0;
 }
+
+/*
+ * Match a keyword as typed against its mixed case SCPI spelling, so
+ * "AMPLitude?" accepts both AMPL? and AMPLITUDE? in any case.
+ */
+int scpi_input_keyword(const char *value, const char *word)
+{
+    size_t len = strlen(word);
+    size_t n = 0;
+    int query = (len > 0 && word[len - 1] == '?');
+    int match;
+
+    assert(value);
+    while (n < len && !islower((unsigned char)word[n])) {
+        n++;
+    }
+
+    if (!strcasecmp(value, word)) {
+        match = 1;
+    } else if (query && n < len) {
+        match = (strlen(value) == n + 1 &&
+                 !strncasecmp(value, word, n) &&
+                 value[n] == '?');
+    } else {
+        match = (strlen(value) == n && !strncasecmp(value, word, n));
+    }
+
+    return match;
+}
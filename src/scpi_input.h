@@ -40,5 +40,6 @@ extern int scpi_input_fp_range(struct info *info,
 extern int scpi_input_str(struct info *info,
                           struct scpi_type *in,
                           const char **out);
+extern int scpi_input_keyword(const char *value, const char *word);
 
 #endif /* SCPI_INPUT_H_ */
@@ -11,16 +11,41 @@
 #include <string.h>
 #include <stdarg.h>
 #include <unistd.h>
+#include <errno.h>
+#include <math.h>
 #include "scpi_output.h"
 
+/*
+ * Responses are assembled in a chunk of OUTPUT_SIZE bytes. When the
+ * chunk fills, it is spilled to the client, so the response length is
+ * not bounded by the chunk size. Whatever the client won't take right
+ * away is queued and drained as the descriptor becomes writable; a
+ * client that falls more than OUTPUT_QUEUE_MAX chunks behind loses
+ * the rest of the response.
+ */
 #define OUTPUT_SIZE (1024*32)
+#define OUTPUT_QUEUE_MAX 16
+#define OUTPUT_QUEUE_SIZE (OUTPUT_QUEUE_MAX + 1) /* room for a terminator */
+#define FP_DIGITS 14    /* %.14g */
+#define FP_MAX 32       /* longest %+.14g conversion plus slop */
+
+struct scpi_output_chunk {
+    uint8_t             *data;
+    size_t              len;
+    size_t              off;        /* bytes already written */
+};
 
 struct scpi_output {
     int                 need_sep;
     int                 num_elem;
     int                 overflow;
+    int                 fd;         /* spill destination, -1 if none */
+    int                 spilled;    /* part of the response already sent */
     size_t              len;
-    uint8_t             buf[OUTPUT_SIZE];
+    uint8_t             *buf;       /* OUTPUT_SIZE bytes */
+    int                 q_head;
+    int                 q_count;
+    struct scpi_output_chunk queue[OUTPUT_QUEUE_SIZE];
 };
 
 struct scpi_output *scpi_output_init(void)
@@ -28,6 +53,14 @@ struct scpi_output *scpi_output_init(void)
     struct scpi_output *output;
 
     output = calloc(1,sizeof(*output));
+    if (output) {
+        output->fd = -1;
+        output->buf = malloc(OUTPUT_SIZE);
+        if (!output->buf) {
+            free(output);
+            output = NULL;
+        }
+    }
 
     return output;
 }
@@ -36,15 +69,151 @@ int scpi_output_done(struct scpi_output *output)
 {
 
     assert(output);
+    while (output->q_count > 0) {
+        free(output->queue[output->q_head].data);
+        output->q_head = (output->q_head + 1) % OUTPUT_QUEUE_SIZE;
+        output->q_count--;
+    }
+    free(output->buf);
     free(output);
     return 0;
 }
 
-static size_t scpi_output_append_char(struct scpi_output *output, char c)
+void scpi_output_fd(struct scpi_output *output, int fd)
+{
+    output->fd = fd;
+}
+
+/*
+ * Write as much of 'data' to a non-blocking 'fd' as it will take
+ * without waiting. Returns nonzero if the client has gone away.
+ */
+static int scpi_output_write(int fd,
+                             const uint8_t *data,
+                             size_t len,
+                             size_t *done)
+{
+    ssize_t actual;
+    int err = 0;
+
+    *done = 0;
+    while (*done < len) {
+        actual = write(fd, data + *done, len - *done);
+        if (actual >= 0) {
+            *done += (size_t)actual;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        } else if (errno != EINTR) {
+            err = -1;
+            break;
+        }
+    }
+
+    return err;
+}
+
+/* Write out queued chunks until the client stops taking them. */
+static int scpi_output_drain_queue(struct scpi_output *output, int fd)
+{
+    struct scpi_output_chunk *chunk;
+    size_t done;
+    int err = 0;
+
+    while (output->q_count > 0) {
+        chunk = &output->queue[output->q_head];
+        err = scpi_output_write(fd,
+                                chunk->data + chunk->off,
+                                chunk->len - chunk->off,
+                                &done);
+        chunk->off += done;
+        if (!err && chunk->off < chunk->len) {
+            break;
+        }
+        /* Sent, or undeliverable. */
+        free(chunk->data);
+        output->q_head = (output->q_head + 1) % OUTPUT_QUEUE_SIZE;
+        output->q_count--;
+    }
+
+    return err;
+}
+
+/*
+ * Send what the client will take now and queue the rest behind
+ * anything already waiting. 'reserve' allows the slot kept back for
+ * a terminator. Returns nonzero if any of 'data' was lost.
+ */
+static int scpi_output_send(struct scpi_output *output,
+                            int fd,
+                            const uint8_t *data,
+                            size_t len,
+                            int reserve)
+{
+    struct scpi_output_chunk *chunk;
+    int limit = reserve ? OUTPUT_QUEUE_SIZE : OUTPUT_QUEUE_MAX;
+    size_t done = 0;
+    int err;
+
+    err = scpi_output_drain_queue(output, fd);
+    if (!err && output->q_count == 0) {
+        err = scpi_output_write(fd, data, len, &done);
+    }
+    if (!err && done < len) {
+        chunk = &output->queue[(output->q_head + output->q_count) %
+                               OUTPUT_QUEUE_SIZE];
+        if (output->q_count >= limit ||
+            (chunk->data = malloc(len - done)) == NULL) {
+            err = 1;
+        } else {
+            memcpy(chunk->data, data + done, len - done);
+            chunk->len = len - done;
+            chunk->off = 0;
+            output->q_count++;
+        }
+    }
+
+    return err;
+}
+
+/* Send the current chunk to the client to make room for more. */
+static int scpi_output_spill(struct scpi_output *output)
+{
+    int err = 1;
+
+    if (output->fd >= 0 && !output->overflow) {
+        err = scpi_output_send(output,
+                               output->fd,
+                               output->buf,
+                               output->len,
+                               0);
+        output->len = 0;
+        output->spilled = 1;
+    }
+    if (err) {
+        output->overflow = 1;
+    }
+
+    return err;
+}
+
+/* Room left in the current chunk, spilling it if full. */
+static size_t scpi_output_room(struct scpi_output *output, size_t need)
 {
     size_t current = OUTPUT_SIZE - output->len - 1;
 
-    if (current > 1) {
+    if (current < need && output->len > 0) {
+        scpi_output_spill(output);
+        current = OUTPUT_SIZE - output->len - 1;
+    }
+
+    return current;
+}
+
+static size_t scpi_output_append_char(struct scpi_output *output, char c)
+{
+    size_t current = scpi_output_room(output, 2);
+
+    if (current > 1 && !output->overflow) {
         *((char *)output->buf + output->len) = c;
         current -= 1;
         output->len += 1;
@@ -55,16 +224,34 @@ static size_t scpi_output_append_char(struct scpi_output *output, char c)
     return current;
 }
 
-int scpi_output_printf(struct scpi_output *output,
-                       const char *format,
-                       ...)
+static int scpi_output_append(struct scpi_output *output,
+                              const void *data,
+                              size_t len)
 {
-    int err = 1;
-    size_t current = OUTPUT_SIZE - output->len - 1;
-    size_t actual;
-    va_list ap;
+    const uint8_t *src = data;
+    size_t current;
+    size_t n;
+
+    while (len > 0 && !output->overflow) {
+        current = scpi_output_room(output, len);
+        if (current == 0) {
+            output->overflow = 1;
+            break;
+        }
+        n = (len < current) ? len : current;
+        memcpy(output->buf + output->len, src, n);
+        output->len += n;
+        src += n;
+        len -= n;
+    }
 
-    assert(format != NULL);
+    return output->overflow;
+}
+
+/* Emit any separator needed ahead of the next element. */
+static size_t scpi_output_sep(struct scpi_output *output, int newline)
+{
+    size_t current = OUTPUT_SIZE - output->len - 1;
 
     /* Handle output separator. */
     if (output->need_sep) {
@@ -74,11 +261,31 @@ int scpi_output_printf(struct scpi_output *output,
     }
 
     /* Append ',' after the first element if any except if newline. */
-    if (output->num_elem > 0 && *format != '\n') {
+    if (output->num_elem > 0 && !newline) {
         current = scpi_output_append_char(output, ',');
     }
 
+    return current;
+}
+
+int scpi_output_printf(struct scpi_output *output,
+                       const char *format,
+                       ...)
+{
+    int err = 1;
+    size_t current;
+    size_t actual;
+    char *tmp;
+    va_list ap;
+    va_list aq;
+
+    assert(format != NULL);
+
+    scpi_output_sep(output, *format == '\n');
+    current = scpi_output_room(output, FP_MAX);
+
     va_start(ap, format);
+    va_copy(aq, ap);
     actual = (size_t)vsnprintf((char *)output->buf + output->len,
                                current,
                                format,
@@ -87,15 +294,23 @@ int scpi_output_printf(struct scpi_output *output,
      * needed, but the cast should result in a very large number
      * anyway.
      */
-    if (actual > current) {
-        output->overflow = 1;
-    } else {
+    if (output->overflow) {
+        /* Nothing more can be delivered. */
+    } else if (actual < current) {
         output->len += actual;
         err = 0;
+    } else if (actual < INT32_MAX && (tmp = malloc(actual + 1)) != NULL) {
+        /* Doesn't fit in this chunk; format aside and append in pieces. */
+        vsnprintf(tmp, actual + 1, format, aq);
+        err = scpi_output_append(output, tmp, actual);
+        free(tmp);
+    } else {
+        output->overflow = 1;
     }
 
     output->num_elem += 1;
 
+    va_end(aq);
     va_end(ap);
 
     return err;
@@ -106,9 +321,185 @@ int scpi_output_int(struct scpi_output *output, int value)
     return scpi_output_printf(output, "%d", value);
 }
 
+/* Exactly representable powers of ten. */
+static const double fp_pow10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+    1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+    1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+#define FP_POW10_MAX ((int)(sizeof(fp_pow10)/sizeof(fp_pow10[0])) - 1)
+
+/*
+ * Scale 'a' by 10^(FP_DIGITS-1-exp10) to an integer of FP_DIGITS
+ * digits. The scale factor is exact and the multiply or divide rounds
+ * once, so the result is within 1/128 of the exact product and is
+ * rounded correctly unless the fraction is close to one half. Return
+ * non-zero if that can't be guaranteed.
+ */
+static int scpi_output_fp_scale(double a, int exp10, uint64_t *digits)
+{
+    int k = FP_DIGITS - 1 - exp10;
+    double scaled;
+    double whole;
+    double frac;
+
+    if (k >= 0 && k <= FP_POW10_MAX) {
+        scaled = a * fp_pow10[k];
+    } else if (k < 0 && -k <= FP_POW10_MAX) {
+        scaled = a / fp_pow10[-k];
+    } else {
+        return 1;
+    }
+
+    whole = floor(scaled);
+    frac = scaled - whole;
+    if (fabs(frac - 0.5) < 0.02) {
+        return 1;
+    }
+    if (frac > 0.5) {
+        whole += 1.0;
+    }
+    *digits = (uint64_t)whole;
+
+    return 0;
+}
+
+/*
+ * Format 'value' exactly as printf("%+.14g") would, without the cost
+ * of vsnprintf. Values that can't be converted exactly with a single
+ * scaling step return 0 and are left to the caller.
+ */
+static size_t scpi_output_fp_fmt(char *buf, double value)
+{
+    char d[FP_DIGITS];
+    char *p = buf;
+    uint64_t digits;
+    uint64_t lo = (uint64_t)fp_pow10[FP_DIGITS-1];
+    uint64_t hi = (uint64_t)fp_pow10[FP_DIGITS];
+    double a = fabs(value);
+    int exp2;
+    int exp10;
+    int ndig;
+    int tries;
+    int i;
+
+    if (!isfinite(value)) {
+        return 0;
+    }
+
+    *p++ = signbit(value) ? '-' : '+';
+
+    if (a == 0.0) {
+        *p++ = '0';
+        return (size_t)(p - buf);
+    }
+
+    /* Estimate the decimal exponent; it is at most one too small. */
+    frexp(a, &exp2);
+    exp10 = (int)floor((double)(exp2 - 1) * 0.30102999566398120);
+    for (tries=0; ; tries++) {
+        if (tries > 2 || scpi_output_fp_scale(a, exp10, &digits)) {
+            return 0;
+        }
+        if (digits < lo) {
+            exp10 -= 1;
+        } else if (digits >= hi) {
+            if (digits == hi) {
+                /* Rounded up to the next decade. */
+                digits = lo;
+                exp10 += 1;
+                break;
+            }
+            exp10 += 1;
+        } else {
+            break;
+        }
+    }
+
+    /* Significant digits, trailing zeros removed. */
+    for (i=FP_DIGITS-1; i>=0; i--) {
+        d[i] = (char)('0' + (digits % 10));
+        digits /= 10;
+    }
+    for (ndig=FP_DIGITS; ndig>1 && d[ndig-1] == '0'; ndig--) {
+        continue;
+    }
+
+    if (exp10 >= -4 && exp10 < FP_DIGITS) {
+        /* %f style */
+        if (exp10 >= 0) {
+            for (i=0; i<=exp10; i++) {
+                *p++ = d[i];
+            }
+            if (ndig > exp10 + 1) {
+                *p++ = '.';
+                for (; i<ndig; i++) {
+                    *p++ = d[i];
+                }
+            }
+        } else {
+            *p++ = '0';
+            *p++ = '.';
+            for (i=exp10+1; i<0; i++) {
+                *p++ = '0';
+            }
+            for (i=0; i<ndig; i++) {
+                *p++ = d[i];
+            }
+        }
+    } else {
+        /* %e style */
+        *p++ = d[0];
+        if (ndig > 1) {
+            *p++ = '.';
+            for (i=1; i<ndig; i++) {
+                *p++ = d[i];
+            }
+        }
+        *p++ = 'e';
+        if (exp10 < 0) {
+            *p++ = '-';
+            exp10 = -exp10;
+        } else {
+            *p++ = '+';
+        }
+        if (exp10 >= 100) {
+            *p++ = (char)('0' + exp10 / 100);
+        }
+        *p++ = (char)('0' + (exp10 / 10) % 10);
+        *p++ = (char)('0' + exp10 % 10);
+    }
+
+    return (size_t)(p - buf);
+}
+
 int scpi_output_fp(struct scpi_output *output, double value)
 {
-    return scpi_output_printf(output, "%+.14g", value);
+    int err = 1;
+    size_t current;
+    size_t actual;
+    char *dst;
+
+    scpi_output_sep(output, 0);
+    current = scpi_output_room(output, FP_MAX);
+
+    if (current >= FP_MAX && !output->overflow) {
+        dst = (char *)output->buf + output->len;
+        actual = scpi_output_fp_fmt(dst, value);
+        if (actual == 0) {
+            actual = (size_t)snprintf(dst, current, "%+.14g", value);
+        }
+        assert(actual < FP_MAX);
+        output->len += actual;
+        err = 0;
+    } else {
+        output->overflow = 1;
+    }
+
+    output->num_elem += 1;
+
+    return err;
 }
 
 int scpi_output_str(struct scpi_output *output, const char *value)
@@ -116,6 +507,28 @@ int scpi_output_str(struct scpi_output *output, const char *value)
     return scpi_output_printf(output, "%s", value);
 }
 
+/*
+ * IEEE 488.2 7.7.6 definite length arbitrary block:
+ *   #<n><len><data>
+ * where <n> is the number of digits in <len>.
+ */
+int scpi_output_block(struct scpi_output *output,
+                      const uint8_t *data,
+                      size_t len)
+{
+    char num[24];
+    int err;
+
+    snprintf(num, sizeof(num), "%zu", len);
+    assert(strlen(num) <= 9);
+    err = scpi_output_printf(output, "#%zu%s", strlen(num), num);
+    if (!err) {
+        err = scpi_output_append(output, data, len);
+    }
+
+    return err;
+}
+
 int scpi_output_cmd_sep(struct scpi_output *output)
 {
     output->need_sep = 1;
@@ -125,29 +538,64 @@ int scpi_output_cmd_sep(struct scpi_output *output)
 
 void scpi_output_clear(struct scpi_output *output)
 {
-    memset(output, 0, sizeof(*output));
+    output->need_sep = 0;
+    output->num_elem = 0;
+    output->overflow = 0;
+    output->spilled = 0;
+    output->len = 0;
 }
 
 void scpi_output_reset(struct scpi_output *output)
 {
+    output->overflow = 0;
+    output->spilled = 0;
     output->len = 0;
 }
 
-void scpi_output_flush(struct scpi_output *output, int fd)
+/*
+ * Send the rest of the response and its terminator. Returns nonzero
+ * if any of the response was lost; if some of it had already gone
+ * out, it is still terminated so the client isn't left waiting.
+ */
+int scpi_output_flush(struct scpi_output *output, int fd)
 {
-    ssize_t outlen;
-    int err;
-
-    if (output->len > 0) {
-        err = scpi_output_printf(output, "\n");
-        assert(!err);
-
-        outlen = write(fd, output->buf, output->len);
+    int err = 0;
+
+    if (output->len > 0 || output->spilled) {
+        assert(output->fd < 0 || output->fd == fd);
+        output->fd = fd;
+        scpi_output_printf(output, "\n");
+        err = output->overflow;
+        if (!err) {
+            err = scpi_output_send(output, fd, output->buf, output->len, 0);
+        }
+        if (err && output->spilled) {
+            scpi_output_send(output, fd, (const uint8_t *)"\n", 1, 1);
+        }
 
         /* Mark as copied out. */
         output->len = 0;
+        output->overflow = 0;
+        output->spilled = 0;
+    }
+
+    return err;
+}
+
+/* Nonzero while the client has yet to take all of its responses. */
+int scpi_output_pending(struct scpi_output *output)
+{
+    return output->q_count > 0;
+}
 
-        /* Handle truncated writes. */
-        assert(outlen >= 0);
+/* Called when the client can take more of the queued output. */
+int scpi_output_drain(struct scpi_output *output)
+{
+    int err = 0;
+
+    if (output->fd >= 0) {
+        err = scpi_output_drain_queue(output, output->fd);
     }
+
+    return err;
 }
@@ -8,10 +8,12 @@
 #ifndef   SCPI_OUTPUT_H_
 #define   SCPI_OUTPUT_H_
 
+#include <stddef.h>
 #include <stdint.h>
 
 extern struct scpi_output *scpi_output_init(void);
 extern int scpi_output_done(struct scpi_output *output);
+extern void scpi_output_fd(struct scpi_output *output, int fd);
 extern void scpi_output_reset(struct scpi_output *output);
 extern int scpi_output_printf(struct scpi_output *output,
                               const char *format,
@@ -19,8 +21,13 @@ extern int scpi_output_printf(struct scpi_output *output,
 extern int scpi_output_int(struct scpi_output *output, int value);
 extern int scpi_output_fp(struct scpi_output *output, double value);
 extern int scpi_output_str(struct scpi_output *output, const char *value);
+extern int scpi_output_block(struct scpi_output *output,
+                             const uint8_t *data,
+                             size_t len);
 extern int scpi_output_cmd_sep(struct scpi_output *output);
 extern void scpi_output_clear(struct scpi_output *output);
-extern void scpi_output_flush(struct scpi_output *output, int fd);
+extern int scpi_output_flush(struct scpi_output *output, int fd);
+extern int scpi_output_pending(struct scpi_output *output);
+extern int scpi_output_drain(struct scpi_output *output);
 
 #endif /* SCPI_OUTPUT_H_ */
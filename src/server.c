@@ -129,6 +129,7 @@ int server_listen(struct info *info)
 static int server_select(struct info *info)
 {
     fd_set fds;
+    fd_set wfds;
     struct timeval timeout;
     int rc;
     int max_fd = -1;
@@ -136,8 +137,10 @@ static int server_select(struct info *info)
     int idx;
     int workers;
     int wfd;
+    int events;
 
     FD_ZERO(&fds);
+    FD_ZERO(&wfds);
 
     /* Listen fd */
     if (info->listen_fd) {
@@ -150,10 +153,19 @@ static int server_select(struct info *info)
     workers = worker_count(info->worker);
     for (idx = 0; idx < workers; idx++) {
         wfd = worker_getfd(info->worker, idx);
+        events = worker_events(info->worker, idx);
+        if (!events) {
+            continue;
+        }
         if (max_fd < wfd) {
             max_fd = wfd;
         }
-        FD_SET(wfd, &fds);
+        if (events & WORKER_READ) {
+            FD_SET(wfd, &fds);
+        }
+        if (events & WORKER_WRITE) {
+            FD_SET(wfd, &wfds);
+        }
     }
 
     memset(&timeout, 0, sizeof(timeout));
@@ -163,7 +175,7 @@ static int server_select(struct info *info)
         timeout.tv_usec = 10000;
     }
 
-    rc = select(max_fd + 1, &fds, NULL, NULL, &timeout);
+    rc = select(max_fd + 1, &fds, &wfds, NULL, &timeout);
     if (rc < 0 && errno != EINTR) {
         return rc;
     }
@@ -174,7 +186,7 @@ static int server_select(struct info *info)
 
     for (idx = 0; idx < workers; idx++) {
         wfd = worker_getfd(info->worker, idx);
-        if (FD_ISSET(wfd, &fds)) {
+        if (FD_ISSET(wfd, &fds) || FD_ISSET(wfd, &wfds)) {
             worker_ready(info->worker, idx);
             srv_event |= SERVER_WORKER;
         }
@@ -16,6 +16,7 @@ struct worker {
     struct {
         int fd;
         wfunc func;
+        wfunc busy;     /* output worker: nonzero while it has data */
         void *arg;
         int ready;
     } w[MAXW];
@@ -45,6 +46,7 @@ int worker_add(struct worker *worker, int fd, wfunc func, void *arg)
     if (worker->count < MAXW) {
         worker->w[worker->count].fd = fd;
         worker->w[worker->count].func = func;
+        worker->w[worker->count].busy = NULL;
         worker->w[worker->count].arg = arg;
         worker->count++;
         err = 0;
@@ -53,6 +55,27 @@ int worker_add(struct worker *worker, int fd, wfunc func, void *arg)
     return err;
 }
 
+/*
+ * Add a worker that is run when 'fd' becomes writable, and is only
+ * waited on while busy(arg) says it has something to write.
+ */
+int worker_add_output(struct worker *worker,
+                      int fd,
+                      wfunc func,
+                      wfunc busy,
+                      void *arg)
+{
+    int err;
+
+    assert(busy);
+    err = worker_add(worker, fd, func, arg);
+    if (!err) {
+        worker->w[worker->count - 1].busy = busy;
+    }
+
+    return err;
+}
+
 int worker_count(struct worker *worker)
 {
     assert(worker);
@@ -71,6 +94,20 @@ int worker_getfd(struct worker *worker, int idx)
     return fd;
 }
 
+/* What to wait for on the worker's fd: WORKER_READ, WORKER_WRITE or 0 */
+int worker_events(struct worker *worker, int idx)
+{
+    int events = WORKER_READ;
+
+    assert(worker);
+    assert(idx >= 0 && idx < worker->count);
+    if (worker->w[idx].busy) {
+        events = worker->w[idx].busy(worker->w[idx].arg) ? WORKER_WRITE : 0;
+    }
+
+    return events;
+}
+
 static int worker_call(struct worker *worker, int idx)
 {
     assert(worker);
@@ -15,11 +15,21 @@ struct worker;
 
 typedef int (*wfunc)(void *arg);
 
+/* worker_events() flags */
+#define WORKER_READ (1<<0)
+#define WORKER_WRITE (1<<1)
+
 extern struct worker *worker_init(void);
 extern void worker_done(struct worker *worker);
 extern int worker_add(struct worker *worker, int fd, wfunc func, void *arg);
+extern int worker_add_output(struct worker *worker,
+                             int fd,
+                             wfunc func,
+                             wfunc busy,
+                             void *arg);
 extern int worker_count(struct worker *worker);
 extern int worker_getfd(struct worker *worker, int idx);
+extern int worker_events(struct worker *worker, int idx);
 extern int worker_ready(struct worker *worker, int idx);
 extern int worker_remove(struct worker *worker, int idx);
 extern int worker_run_ready(struct worker *worker);
@@ -23,7 +23,7 @@ class CGR101
   def initialize(arg=nil)
     cmd = "#{PROG} #{SWITCHES}"
     if !arg.nil?
-      cmd += " $arg"
+      cmd += " #{arg}"
     end
     #puts cmd
     @stdin, @stdout, @stderr, @wthr = Open3.popen3(cmd)
@@ -67,6 +67,19 @@ class CGR101
     nil
   end
 
+  # IEEE 488.2 definite length block; its bytes may span lines.
+  def recv_block
+    line = recv.b
+    m = /\A#([1-9])/.match(line)
+    return nil if m.nil?
+    n = Integer(m[1])
+    len = Integer(line[2,n])
+    while line.length < 2 + n + len do
+      line << "\n" << recv.b
+    end
+    line[2 + n, len]
+  end
+
   def recv_err
     Timeout::timeout(RECV_TIMEOUT) do
       return @errq.pop
@@ -94,7 +107,7 @@ class CGR101
 
   def out_reader
     while @outr do
-      @outq << @stdout.gets.chomp
+      @outq << @stdout.gets.chomp("\n")
     end
   end
 
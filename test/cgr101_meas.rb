@@ -80,4 +80,152 @@ module CGR101Meas
     assert_equal(0, self.class.hdl.err_length)
   end
 
+  #
+  # MEASure:VOLTage and FETCh:VOLTage
+  #
+  def test_meas_volt
+    self.class.hdl.send("MEAS:VOLT:MAX? (@1)")
+    out = self.class.hdl.recv
+    max = Float(out)
+    self.class.hdl.send("FETC:VOLT:MIN? (@1)")
+    out = self.class.hdl.recv
+    min = Float(out)
+    self.class.hdl.send("FETC:VOLT:PTP? (@1)")
+    out = self.class.hdl.recv
+    ptp = Float(out)
+    assert_in_delta(max - min, ptp, 1e-9)
+    assert(max >= min)
+
+    self.class.hdl.send("FETC:VOLT:AVER? (@1)")
+    aver = Float(self.class.hdl.recv)
+    assert(aver <= max && aver >= min)
+    self.class.hdl.send("FETC:VOLT:RMS? (@1)")
+    rms = Float(self.class.hdl.recv)
+    self.class.hdl.send("FETC:VOLT:ACRM? (@1)")
+    acrms = Float(self.class.hdl.recv)
+    assert_in_delta(rms*rms, aver*aver + acrms*acrms, 1e-6)
+
+    %w[TOP BASE AMPL OVER].each do |f|
+      self.class.hdl.send("FETC:VOLT:#{f}? (@1,2)")
+      out = self.class.hdl.recv
+      v = out.split(',').map { |s| Float(s) }
+      assert_equal(2, v.length)
+    end
+    assert_equal(0, self.class.hdl.out_length)
+    assert_equal(0, self.class.hdl.err_length)
+  end
+
+  #
+  # MEASure/FETCh timing
+  #
+  def test_meas_time
+    # Signal generator output is looped back to input A.
+    self.class.hdl.send("SOUR:FREQ 2000.0")
+    self.class.hdl.send("SOUR:FUNC SIN")
+    self.class.hdl.send("SENS:SWE:TIME 0.005")
+    self.class.hdl.send("MEAS:FREQ? (@1)")
+    freq = Float(self.class.hdl.recv)
+    self.class.hdl.send("FETC:PER? (@1)")
+    per = Float(self.class.hdl.recv)
+    if freq < 9.9e37
+      assert_in_delta(1.0, freq * per, 1e-9)
+    end
+    %w[DCYC RTIM FTIM PWID NWID].each do |f|
+      self.class.hdl.send("FETC:#{f}? (@1)")
+      out = self.class.hdl.recv
+      v = out.split(',').map { |s| Float(s) }
+      assert_equal(1, v.length)
+    end
+    assert_equal(0, self.class.hdl.out_length)
+    assert_equal(0, self.class.hdl.err_length)
+  end
+
+  #
+  # MEASure under INIT:CONT sees settings changed mid-sweep
+  #
+  def test_meas_continuous
+    # Signal generator output is looped back to input A.
+    self.class.hdl.send("SOUR:FREQ 2000.0")
+    self.class.hdl.send("SOUR:FUNC SIN")
+    self.class.hdl.send("SENS:SWE:TIME 0.005")
+    self.class.hdl.send("SENS:FUNC:ON (@1)")
+    self.class.hdl.send("INIT:CONT ON")
+    [1000.0, 4000.0].each do |f|
+      self.class.hdl.send("SOUR:FREQ #{f}")
+      self.class.hdl.send("MEAS:FREQ? (@1)")
+      freq = Float(self.class.hdl.recv)
+      if freq < 9.9e37
+        assert_in_delta(f, freq, f * 0.05)
+      end
+    end
+    self.class.hdl.send("INIT:CONT OFF")
+    self.class.hdl.send("*WAI")
+    assert_equal(0, self.class.hdl.out_length)
+    assert_equal(0, self.class.hdl.err_length)
+  end
+
+  #
+  # MEASure/FETCh phase and delay between channels
+  #
+  def test_meas_pair
+    # Signal generator output is looped back to input A: ten periods
+    # of a sine per sweep, so there are edges to measure.
+    self.class.hdl.send("SOUR:FREQ 2000.0")
+    self.class.hdl.send("SOUR:FUNC SIN")
+    self.class.hdl.send("SENS:SWE:TIME 0.005")
+    self.class.hdl.send("MEAS:FREQ? (@1)")
+    freq = Float(self.class.hdl.recv)
+    assert_in_delta(2000.0, freq, 100.0)
+
+    # A channel against itself
+    self.class.hdl.send("FETC:PHAS? (@1),(@1)")
+    assert_in_delta(0.0, Float(self.class.hdl.recv), 1e-9)
+    self.class.hdl.send("FETC:DEL? (@1),(@1)")
+    assert_in_delta(0.0, Float(self.class.hdl.recv), 1e-12)
+    self.class.hdl.send("FETC:DEL:CORR? (@1),(@1)")
+    assert_in_delta(0.0, Float(self.class.hdl.recv), 1e-12)
+
+    # Math channel 9, the derivative, leads by a quarter period
+    self.class.hdl.send("CALC:MATH:FUNC DER (@9)")
+    self.class.hdl.send("CALC:MATH:SOUR 1,1 (@9)")
+    self.class.hdl.send("MEAS:PHAS? (@1),(@9)")
+    phase = Float(self.class.hdl.recv)
+    self.class.hdl.send("FETC:FREQ? (@1)")
+    freq = Float(self.class.hdl.recv)
+    self.class.hdl.send("FETC:DEL? (@1),(@9)")
+    delay = Float(self.class.hdl.recv)
+    self.class.hdl.send("FETC:DEL:CORR? (@1),(@9)")
+    corr = Float(self.class.hdl.recv)
+    assert(phase > -180.0 && phase <= 180.0)
+    assert_in_delta(-90.0, phase, 10.0)
+    assert_in_delta(phase / 360.0 / freq, delay, 1e-9)
+    assert_in_delta(delay, corr, 0.05 / freq)
+
+    # Math channel 8 is channel 1 inverted: half a period out
+    self.class.hdl.send("CALC:MATH:FUNC ADD (@8)")
+    self.class.hdl.send("CALC:MATH:SOUR 1,1 (@8)")
+    self.class.hdl.send("CALC:MATH:SCAL -0.5 (@8)")
+    self.class.hdl.send("MEAS:PHAS? (@1),(@8)")
+    phase = Float(self.class.hdl.recv)
+    assert_in_delta(180.0, phase.abs, 10.0)
+    self.class.hdl.send("FETC:DEL? (@1),(@8)")
+    delay = Float(self.class.hdl.recv)
+    self.class.hdl.send("FETC:DEL:CORR? (@1),(@8)")
+    corr = Float(self.class.hdl.recv)
+    assert_in_delta(0.5 / freq, delay.abs, 0.05 / freq)
+    assert_in_delta(0.5 / freq, corr.abs, 0.05 / freq)
+    self.class.hdl.send("*RST")
+
+    # Only one oscilloscope or math channel per list
+    ["(@1,2),(@1)", "(@1),(@1:2)", "(@3),(@1)", "(@1),(@4)",
+     "(@5),(@2)", "(@2),(@6)", "(@7),(@1)"].each do |lists|
+      self.class.hdl.send("FETC:PHAS? #{lists}")
+      self.class.hdl.send("SYST:ERR?")
+      out = self.class.hdl.recv
+      assert_match(/^-224/, out)
+    end
+    assert_equal(0, self.class.hdl.out_length)
+    assert_equal(0, self.class.hdl.err_length)
+  end
+
 end
@@ -563,4 +563,869 @@ module CGR101Scope
     # May or may not have data so don't count on it.
   end
 
+  #
+  # Two channel ASCII data is larger than one output chunk
+  #
+  def test_scope_data_two_chan
+    self.class.hdl.send("SENS:SWE:POIN?")
+    out = self.class.hdl.recv
+    points = Integer(out)
+    self.class.hdl.send("SENS:FUNC:ON (@1,2)")
+    self.class.hdl.send("INIT:IMM")
+    self.class.hdl.send("*OPC?")
+    out = self.class.hdl.recv
+    assert_equal("1", out)
+
+    self.class.hdl.send("SENS:DATA? (@1,2)")
+    out = self.class.hdl.recv
+    v = out.split(',').map { |s| Float(s) }
+    assert_equal(2*points, v.length)
+    assert_equal(0, self.class.hdl.out_length)
+    assert_equal(0, self.class.hdl.err_length)
+  end
+
+  #
+  # INIT:CONT
+  #
+  def test_scope_continuous
+    self.class.hdl.send("INIT:CONT?")
+    out = self.class.hdl.recv
+    assert_equal("0", out)
+    self.class.hdl.send("SENS:SWE:POIN?")
+    out = self.class.hdl.recv
+    points = Integer(out)
+    self.class.hdl.send("SENS:FUNC:ON (@1)")
+    self.class.hdl.send("INIT:CONT ON")
+    self.class.hdl.send("INIT:CONT?")
+    out = self.class.hdl.recv
+    assert_equal("1", out)
+
+    # Several fetches while sweeping
+    3.times do
+      self.class.hdl.send("SENS:DATA? (@1)")
+      out = self.class.hdl.recv
+      v = out.split(',').map { |s| Float(s) }
+      assert_equal(points, v.length)
+    end
+
+    self.class.hdl.send("INIT:CONT OFF")
+    self.class.hdl.send("*WAI")
+    self.class.hdl.send("INIT:CONT?")
+    out = self.class.hdl.recv
+    assert_equal("0", out)
+    assert_equal(0, self.class.hdl.out_length)
+    assert_equal(0, self.class.hdl.err_length)
+  end
+
+  #
+  # INIT:CONT OFF straight after ON must not leave the sweep running
+  #
+  def test_scope_continuous_off
+    self.class.hdl.send("SENS:SWE:POIN?")
+    out = self.class.hdl.recv
+    points = Integer(out)
+    self.class.hdl.send("SENS:FUNC:ON (@1)")
+    3.times do
+      self.class.hdl.send("INIT:CONT ON")
+      self.class.hdl.send("INIT:CONT OFF")
+      self.class.hdl.send("*OPC?")
+      out = self.class.hdl.recv
+      assert_equal("1", out)
+      self.class.hdl.send("SENS:DATA? (@1)")
+      out = self.class.hdl.recv
+      v = out.split(',').map { |s| Float(s) }
+      assert_equal(points, v.length)
+    end
+    assert_equal(0, self.class.hdl.out_length)
+    assert_equal(0, self.class.hdl.err_length)
+  end
+
+  #
+  # SENS:HIST
+  #
+  def test_scope_history
+    self.class.hdl.send("SENS:HIST:DEPT?")
+    out = self.class.hdl.recv
+    assert_equal("32", out)
+    self.class.hdl.send("SENS:HIST:DEPT 4")
+    self.class.hdl.send("SENS:HIST:DEPT?")
+    out = self.class.hdl.recv
+    assert_equal("4", out)
+
+    self.class.hdl.send("SENS:SWE:POIN?")
+    out = self.class.hdl.recv
+    points = Integer(out)
+    self.class.hdl.send("SENS:FUNC:ON (@1)")
+    6.times do
+      self.class.hdl.send("INIT:IMM")
+      self.class.hdl.send("*WAI")
+    end
+    self.class.hdl.send("SENS:HIST:SEQ?")
+    out = self.class.hdl.recv
+    first, last = out.split(',').map { |s| Integer(s) }
+    assert_equal(3, last - first)
+
+    self.class.hdl.send("SENS:HIST:DATA? #{last} (@1)")
+    out = self.class.hdl.recv
+    assert_equal(points, out.split(',').length)
+
+    self.class.hdl.send("SENS:HIST:LAT? 2 (@1)")
+    out = self.class.hdl.recv
+    v = out.split(',')
+    assert_equal(2*(points+1), v.length)
+    assert_equal(last-1, Integer(v[0]))
+    assert_equal(last, Integer(v[points+1]))
+
+    self.class.hdl.send("SENS:HIST:SINC? #{last-1} (@1)")
+    out = self.class.hdl.recv
+    v = out.split(',')
+    assert_equal(points+1, v.length)
+    assert_equal(last, Integer(v[0]))
+
+    self.class.hdl.send("SENS:HIST:DEPT 32")
+    assert_equal(0, self.class.hdl.out_length)
+    assert_equal(0, self.class.hdl.err_length)
+  end
+
+  #
+  # FORM/FORM?
+  #
+  def test_scope_format
+    self.class.hdl.send("FORM?")
+    out = self.class.hdl.recv
+    assert_equal("ASC", out)
+    self.class.hdl.send("FORM PACK")
+    self.class.hdl.send("FORM?")
+    out = self.class.hdl.recv
+    assert_equal("PACK", out)
+    self.class.hdl.send("FORM REAL")
+    self.class.hdl.send("FORM?")
+    out = self.class.hdl.recv
+    assert_equal("REAL", out)
+    self.class.hdl.send("FORM ASC")
+    self.class.hdl.send("FORM?")
+    out = self.class.hdl.recv
+    assert_equal("ASC", out)
+    assert_equal(0, self.class.hdl.out_length)
+    assert_equal(0, self.class.hdl.err_length)
+
+    # no error reports
+    self.class.hdl.send("SYSTem:ERRor:COUNt?")
+    out = self.class.hdl.recv
+    assert_equal("0", out)
+  end
+
+  #
+  # CALC:TRAN:FREQ
+  #
+  def test_scope_spectrum
+    self.class.hdl.send("CALC:TRAN:FREQ:WIND?")
+    out = self.class.hdl.recv
+    assert_equal("HANN", out)
+    self.class.hdl.send("CALC:TRAN:FREQ:WIND FLAT")
+    self.class.hdl.send("CALC:TRAN:FREQ:WIND?")
+    out = self.class.hdl.recv
+    assert_equal("FLAT", out)
+
+    self.class.hdl.send("SENS:SWE:POIN?")
+    out = self.class.hdl.recv
+    points = Integer(out)
+    self.class.hdl.send("SENS:FUNC:ON (@1,2)")
+    self.class.hdl.send("INIT:IMM")
+    self.class.hdl.send("*OPC?")
+    out = self.class.hdl.recv
+    assert_equal("1", out)
+
+    self.class.hdl.send("SENS:SWE:TIME?")
+    out = self.class.hdl.recv
+    sweep_time = Float(out)
+    self.class.hdl.send("CALC:TRAN:FREQ:STEP?")
+    out = self.class.hdl.recv
+    assert_in_delta(1.0/sweep_time, Float(out), 1e-6/sweep_time)
+
+    self.class.hdl.send("CALC:TRAN:FREQ:DATA? (@1,2)")
+    out = self.class.hdl.recv
+    v = out.split(',').map { |s| Float(s) }
+    assert_equal(2*(points/2+1), v.length)
+    self.class.hdl.send("CALC:TRAN:FREQ:WIND HANN")
+    assert_equal(0, self.class.hdl.out_length)
+    assert_equal(0, self.class.hdl.err_length)
+  end
+
+  #
+  # SENS:AVER
+  #
+  def test_scope_average
+    self.class.hdl.send("SENS:AVER?")
+    out = self.class.hdl.recv
+    assert_equal("0", out)
+    self.class.hdl.send("SENS:AVER:COUN?")
+    out = self.class.hdl.recv
+    assert_equal("16", out)
+    self.class.hdl.send("SENS:AVER:COUN 4")
+    self.class.hdl.send("SENS:AVER ON")
+    self.class.hdl.send("SENS:AVER:STAT?")
+    out = self.class.hdl.recv
+    assert_equal("1", out)
+
+    self.class.hdl.send("SENS:SWE:POIN?")
+    out = self.class.hdl.recv
+    points = Integer(out)
+    self.class.hdl.send("SENS:HIST:SEQ?")
+    out = self.class.hdl.recv
+    seq0 = out.split(',').map { |s| Integer(s) }[1]
+    self.class.hdl.send("SENS:FUNC:ON (@1)")
+    self.class.hdl.send("INIT:IMM")
+    self.class.hdl.send("*OPC?")
+    out = self.class.hdl.recv
+    assert_equal("1", out)
+
+    # Four device sweeps make one published sweep.
+    self.class.hdl.send("SENS:HIST:SEQ?")
+    out = self.class.hdl.recv
+    assert_equal(seq0 + 1, out.split(',').map { |s| Integer(s) }[1])
+    self.class.hdl.send("SENS:DATA? (@1)")
+    out = self.class.hdl.recv
+    v = out.split(',').map { |s| Float(s) }
+    assert_equal(points, v.length)
+
+    self.class.hdl.send("SENS:AVER:COUN 65")
+    self.class.hdl.send("SYST:ERR?")
+    out = self.class.hdl.recv
+    assert_match(/^-222/, out)
+    self.class.hdl.send("SENS:AVER OFF")
+    self.class.hdl.send("SENS:AVER:COUN 16")
+    assert_equal(0, self.class.hdl.out_length)
+    assert_equal(0, self.class.hdl.err_length)
+  end
+
+  #
+  # Changing SENS:AVER part way through an average ends the sweep
+  #
+  def test_scope_average_change
+    self.class.hdl.send("SENS:SWE:POIN?")
+    out = self.class.hdl.recv
+    points = Integer(out)
+    self.class.hdl.send("SENS:FUNC:ON (@1)")
+    ["SENS:AVER OFF", "SENS:AVER:COUN 8"].each do |cmd|
+      self.class.hdl.send("SENS:AVER:COUN 4")
+      self.class.hdl.send("SENS:AVER ON")
+      self.class.hdl.send("INIT:IMM")
+      self.class.hdl.send(cmd)
+      self.class.hdl.send("SENS:AVER OFF")
+      self.class.hdl.send("*OPC?")
+      out = self.class.hdl.recv
+      assert_equal("1", out)
+      self.class.hdl.send("SENS:DATA? (@1)")
+      out = self.class.hdl.recv
+      v = out.split(',').map { |s| Float(s) }
+      assert_equal(points, v.length)
+    end
+    self.class.hdl.send("SENS:AVER:COUN 16")
+    assert_equal(0, self.class.hdl.out_length)
+    assert_equal(0, self.class.hdl.err_length)
+  end
+
+  #
+  # SENS:DATA? decimated
+  #
+  def test_scope_data_decimate
+    self.class.hdl.send("SENS:FUNC:ON (@1,2)")
+    self.class.hdl.send("INIT:IMM")
+    self.class.hdl.send("*OPC?")
+    out = self.class.hdl.recv
+    assert_equal("1", out)
+
+    self.class.hdl.send("SENS:DATA? (@1,2),100")
+    out = self.class.hdl.recv
+    v = out.split(',').map { |s| Float(s) }
+    assert_equal(200, v.length)
+
+    self.class.hdl.send("SENS:DATA? (@1),150,MEAN")
+    out = self.class.hdl.recv
+    mean = out.split(',').map { |s| Float(s) }
+    assert_equal(150, mean.length)
+
+    self.class.hdl.send("SENS:DATA? (@1),150,MINM")
+    out = self.class.hdl.recv
+    env = out.split(',').map { |s| Float(s) }
+    assert_equal(300, env.length)
+    env.each_slice(2).each_with_index do |(lo, hi), i|
+      assert_operator(lo, :<=, mean[i] + 1e-9)
+      assert_operator(hi, :>=, mean[i] - 1e-9)
+    end
+
+    # Envelope of the whole sweep is its extremes.
+    self.class.hdl.send("SENS:DATA? (@1)")
+    out = self.class.hdl.recv
+    full = out.split(',').map { |s| Float(s) }
+    self.class.hdl.send("SENS:DATA? (@1),1,MINM")
+    out = self.class.hdl.recv
+    v = out.split(',').map { |s| Float(s) }
+    assert_in_delta(full.min, v[0], 1e-9)
+    assert_in_delta(full.max, v[1], 1e-9)
+
+    self.class.hdl.send("SENS:DATA? (@1),0")
+    self.class.hdl.send("SYST:ERR?")
+    out = self.class.hdl.recv
+    assert_match(/^-222/, out)
+    assert_equal(0, self.class.hdl.out_length)
+    assert_equal(0, self.class.hdl.err_length)
+  end
+
+  #
+  # SENS:ETS
+  #
+  def test_scope_ets
+    self.class.hdl.send("SENS:ETS?")
+    out = self.class.hdl.recv
+    assert_equal("0", out)
+    self.class.hdl.send("SENS:ETS:FACT?")
+    out = self.class.hdl.recv
+    assert_equal("8", out)
+    self.class.hdl.send("SENS:ETS:FACT 4")
+    self.class.hdl.send("SENS:SWE:POIN?")
+    out = self.class.hdl.recv
+    points = Integer(out)
+
+    # Signal generator output is looped back to input A.
+    self.class.hdl.send("SOUR:FREQ 1000.0")
+    self.class.hdl.send("SOUR:FUNC SIN")
+    self.class.hdl.send("SENS:FUNC:ON (@1)")
+
+    # The trigger phase needs the internal trigger.
+    self.class.hdl.send("TRIG:SOUR IMM")
+    self.class.hdl.send("SENS:ETS ON")
+    self.class.hdl.send("SYST:ERR?")
+    out = self.class.hdl.recv
+    assert_match(/^-221/, out)
+    self.class.hdl.send("SENS:ETS?")
+    out = self.class.hdl.recv
+    assert_equal("0", out)
+    self.class.hdl.send("TRIG:SOUR INT")
+
+    self.class.hdl.send("SENS:ETS ON")
+    4.times do
+      self.class.hdl.send("INIT:IMM")
+      self.class.hdl.send("*OPC?")
+      out = self.class.hdl.recv
+      assert_equal("1", out)
+    end
+    self.class.hdl.send("SENS:ETS:COUN?")
+    out = self.class.hdl.recv
+    v = out.split(',').map { |s| Integer(s) }
+    assert_equal(3, v.length)
+    assert_equal(4, v.sum)
+    self.class.hdl.send("SENS:ETS:FILL?")
+    out = self.class.hdl.recv
+    fill = Float(out)
+    assert_operator(fill, :>=, 0.0)
+    assert_operator(fill, :<=, 100.0)
+
+    self.class.hdl.send("SENS:ETS:DATA? (@1)")
+    out = self.class.hdl.recv
+    v = out.split(',').map { |s| Float(s) }
+    assert_equal(4*points, v.length)
+
+    self.class.hdl.send("SENS:ETS:RES")
+    self.class.hdl.send("SENS:ETS:COUN?")
+    out = self.class.hdl.recv
+    assert_equal("0,0,0", out)
+    self.class.hdl.send("SENS:ETS OFF")
+    self.class.hdl.send("SENS:ETS:FACT 8")
+    assert_equal(0, self.class.hdl.out_length)
+    assert_equal(0, self.class.hdl.err_length)
+  end
+
+  #
+  # CALC:FILT
+  #
+  def test_scope_filter
+    self.class.hdl.send("CALC:FILT?")
+    out = self.class.hdl.recv
+    assert_equal("0", out)
+    self.class.hdl.send("CALC:FILT:TYPE?")
+    out = self.class.hdl.recv
+    assert_equal("LPAS", out)
+    self.class.hdl.send("CALC:FILT:FORM?")
+    out = self.class.hdl.recv
+    assert_equal("FIR", out)
+    self.class.hdl.send("CALC:FILT:TAPS?")
+    out = self.class.hdl.recv
+    assert_equal("31", out)
+
+    self.class.hdl.send("CALC:FILT:FREQ 2000.0,20000.0")
+    self.class.hdl.send("CALC:FILT:FREQ?")
+    out = self.class.hdl.recv
+    v = out.split(',').map { |s| Float(s) }
+    assert_equal([2e3, 20e3], v)
+    self.class.hdl.send("CALC:FILT:TAPS 32")
+    self.class.hdl.send("SYST:ERR?")
+    out = self.class.hdl.recv
+    assert_match(/^-222/, out)
+    self.class.hdl.send("CALC:FILT:TYPE BPAS")
+    self.class.hdl.send("CALC:FILT:FORM IIR")
+    self.class.hdl.send("CALC:FILT ON")
+
+    self.class.hdl.send("SENS:SWE:POIN?")
+    out = self.class.hdl.recv
+    points = Integer(out)
+    self.class.hdl.send("SENS:FUNC:ON (@1,2)")
+    self.class.hdl.send("INIT:IMM")
+    self.class.hdl.send("*OPC?")
+    out = self.class.hdl.recv
+    assert_equal("1", out)
+    self.class.hdl.send("SENS:DATA? (@1)")
+    out = self.class.hdl.recv
+    v = out.split(',').map { |s| Float(s) }
+    assert_equal(points, v.length)
+    self.class.hdl.send("FETC:VOLT:PTP? (@1)")
+    out = self.class.hdl.recv
+    assert_operator(Float(out), :>=, 0.0)
+
+    self.class.hdl.send("CALC:FILT OFF")
+    self.class.hdl.send("CALC:FILT:FORM FIR")
+    self.class.hdl.send("CALC:FILT:TYPE LPAS")
+    self.class.hdl.send("CALC:FILT:FREQ 1000.0,10000.0")
+    self.class.hdl.send("CALC:FILT:TAPS 31")
+    assert_equal(0, self.class.hdl.out_length)
+    assert_equal(0, self.class.hdl.err_length)
+  end
+
+  #
+  # CALC:LIM
+  #
+  def test_scope_limit
+    self.class.hdl.send("CALC:LIM?")
+    out = self.class.hdl.recv
+    assert_equal("0", out)
+    self.class.hdl.send("CALC:LIM:KEEP?")
+    out = self.class.hdl.recv
+    assert_equal("ALL", out)
+    self.class.hdl.send("CALC:LIM:COUN?")
+    out = self.class.hdl.recv
+    assert_equal("0,0,0", out)
+
+    self.class.hdl.send("SENS:SWE:POIN?")
+    out = self.class.hdl.recv
+    points = Integer(out)
+    self.class.hdl.send("CALC:LIM:UPP (@1),2.5")
+    self.class.hdl.send("CALC:LIM:UPP? (@1)")
+    out = self.class.hdl.recv
+    v = out.split(',').map { |s| Float(s) }
+    assert_equal(points, v.length)
+    assert_equal(2.5, v[points-1])
+    self.class.hdl.send("CALC:LIM:LOW (@1),1.0,2.0")
+    self.class.hdl.send("SYST:ERR?")
+    out = self.class.hdl.recv
+    assert_match(/^-222/, out)
+
+    # A mask no sweep can pass
+    self.class.hdl.send("CALC:LIM:LOW (@1,2),30.0")
+    self.class.hdl.send("CALC:LIM:UPP (@1,2),30.0")
+    self.class.hdl.send("CALC:LIM ON")
+    self.class.hdl.send("SENS:FUNC:ON (@1,2)")
+    self.class.hdl.send("INIT:IMM")
+    self.class.hdl.send("*OPC?")
+    out = self.class.hdl.recv
+    assert_equal("1", out)
+    self.class.hdl.send("CALC:LIM:FAIL?")
+    out = self.class.hdl.recv
+    assert_equal("1", out)
+    self.class.hdl.send("CALC:LIM:COUN?")
+    out = self.class.hdl.recv
+    v = out.split(',').map { |s| Integer(s) }
+    assert_equal([1, 1], v[0..1])
+    assert_operator(v[2], :>, 0)
+
+    # Stop a continuous acquisition on the first failure
+    self.class.hdl.send("CALC:LIM:STOP ON")
+    self.class.hdl.send("CALC:LIM:KEEP FAIL")
+    self.class.hdl.send("INIT:CONT ON")
+    self.class.hdl.send("*WAI")
+    self.class.hdl.send("INIT:CONT?")
+    out = self.class.hdl.recv
+    assert_equal("0", out)
+
+    self.class.hdl.send("CALC:LIM:CLE")
+    self.class.hdl.send("CALC:LIM:COUN?")
+    out = self.class.hdl.recv
+    assert_equal("0,0,0", out)
+    self.class.hdl.send("CALC:LIM OFF")
+    self.class.hdl.send("CALC:LIM:STOP OFF")
+    self.class.hdl.send("CALC:LIM:KEEP ALL")
+    self.class.hdl.send("CALC:LIM:UPP (@1,2),25.0")
+    self.class.hdl.send("CALC:LIM:LOW (@1,2),-25.0")
+    assert_equal(0, self.class.hdl.out_length)
+    assert_equal(0, self.class.hdl.err_length)
+  end
+
+  #
+  # CALC:HIST
+  #
+  def test_scope_histogram
+    self.class.hdl.send("CALC:HIST?")
+    out = self.class.hdl.recv
+    assert_equal("0", out)
+    self.class.hdl.send("CALC:HIST:MEAN? (@1)")
+    out = self.class.hdl.recv
+    assert_equal(9.91e37, Float(out))
+
+    self.class.hdl.send("SENS:SWE:POIN?")
+    out = self.class.hdl.recv
+    points = Integer(out)
+    self.class.hdl.send("CALC:HIST ON")
+    self.class.hdl.send("SENS:FUNC:ON (@1,2)")
+    3.times do
+      self.class.hdl.send("INIT:IMM")
+      self.class.hdl.send("*WAI")
+    end
+    self.class.hdl.send("CALC:HIST:COUN?")
+    out = self.class.hdl.recv
+    assert_equal("3", out)
+    self.class.hdl.send("CALC:HIST:DATA? (@1,2)")
+    out = self.class.hdl.recv
+    v = out.split(',').map { |s| Integer(s) }
+    assert_equal(2*1024, v.length)
+    assert_equal(3*points, v[0,1024].sum)
+
+    self.class.hdl.send("CALC:HIST:PERC? (@1),0.0")
+    out = self.class.hdl.recv
+    pmin = Float(out)
+    self.class.hdl.send("CALC:HIST:PERC? (@1),100.0")
+    out = self.class.hdl.recv
+    pmax = Float(out)
+    self.class.hdl.send("CALC:HIST:MEAN? (@1)")
+    out = self.class.hdl.recv
+    mean = Float(out)
+    assert_operator(mean, :>=, pmin)
+    assert_operator(mean, :<=, pmax)
+    self.class.hdl.send("CALC:HIST:SDEV? (@1,2)")
+    out = self.class.hdl.recv
+    v = out.split(',').map { |s| Float(s) }
+    assert_equal(2, v.length)
+    assert_operator(v[0], :>=, 0.0)
+
+    self.class.hdl.send("CALC:HIST:CLE")
+    self.class.hdl.send("CALC:HIST:COUN?")
+    out = self.class.hdl.recv
+    assert_equal("0", out)
+    self.class.hdl.send("CALC:HIST OFF")
+    assert_equal(0, self.class.hdl.out_length)
+    assert_equal(0, self.class.hdl.err_length)
+  end
+
+  def test_scope_cal_zero
+    self.class.hdl.send("SYST:INT:OFFS?")
+    out = self.class.hdl.recv
+    saved = out.split(',').map { |s| Float(s) }
+    self.class.hdl.send("CAL:ZERO:COUN?")
+    out = self.class.hdl.recv
+    assert_equal("16", out)
+    self.class.hdl.send("CAL:ZERO:COUN 2")
+    self.class.hdl.send("CAL:ZERO")
+    self.class.hdl.send("*OPC?")
+    out = self.class.hdl.recv
+    assert_equal("1", out)
+    self.class.hdl.send("STAT:OPER:COND?")
+    out = self.class.hdl.recv
+    assert_equal(0, Integer(out) & 1)
+    self.class.hdl.send("SYST:INT:OFFS?")
+    out = self.class.hdl.recv
+    v = out.split(',').map { |s| Float(s) }
+    assert_equal(4, v.length)
+    v.each { |x| assert_operator(x.abs, :<, 2.5) }
+    self.class.hdl.send("SYST:INT:OFFS #{saved.join(',')}")
+    self.class.hdl.send("CAL:ZERO:COUN 16")
+    assert_equal(0, self.class.hdl.out_length)
+    assert_equal(0, self.class.hdl.err_length)
+  end
+
+  def test_scope_autoscale
+    self.class.hdl.send("AUT")
+    self.class.hdl.send("*OPC?")
+    out = self.class.hdl.recv
+    assert_equal("1", out)
+    self.class.hdl.send("STAT:OPER:COND?")
+    out = self.class.hdl.recv
+    assert_equal(0, Integer(out) & 4)
+    self.class.hdl.send("SENS:VOLT:DC:UPP? (@1,2)")
+    out = self.class.hdl.recv
+    v = out.split(',').map { |s| Float(s) }
+    assert_equal(2, v.length)
+    v.each { |x| assert_includes([2.5, 25.0], x) }
+    self.class.hdl.send("SENS:SWE:TIME?")
+    out = self.class.hdl.recv
+    assert_operator(Float(out), :>, 0.0)
+    self.class.hdl.send("SENS:AUTO")
+    self.class.hdl.send("*WAI")
+    self.class.hdl.send("*RST")
+    assert_equal(0, self.class.hdl.out_length)
+    assert_equal(0, self.class.hdl.err_length)
+  end
+
+  def test_scope_range_auto
+    self.class.hdl.send("SENS:VOLT:RANG:AUTO? (@1,2)")
+    out = self.class.hdl.recv
+    assert_equal("0,0", out)
+    self.class.hdl.send("SENS:VOLT:RANG:AUTO:FRAC?")
+    out = self.class.hdl.recv
+    assert_equal(0.08, Float(out))
+    self.class.hdl.send("SENS:VOLT:RANG:AUTO:FRAC 0.5")
+    self.class.hdl.send("SYST:ERR:COUN?")
+    out = self.class.hdl.recv
+    assert_equal("1", out)
+    self.class.hdl.send("*CLS")
+
+    self.class.hdl.send("SENS:VOLT:DC:RANG:AUTO ON (@1)")
+    self.class.hdl.send("SENS:VOLT:RANG:AUTO? (@1,2)")
+    out = self.class.hdl.recv
+    assert_equal("1,0", out)
+    self.class.hdl.send("SENS:FUNC:ON (@1,2)")
+    3.times do
+      self.class.hdl.send("INIT:IMM")
+      self.class.hdl.send("*WAI")
+    end
+    self.class.hdl.send("SENS:VOLT:UPP? (@1)")
+    out = self.class.hdl.recv
+    assert_equal(25.0, Float(out))
+    self.class.hdl.send("STAT:QUES:COND?")
+    out = self.class.hdl.recv
+    assert_equal(0, Integer(out) & ~1)
+    self.class.hdl.send("STAT:QUES?")
+    out = self.class.hdl.recv
+    assert_equal(0, Integer(out) & ~1)
+    self.class.hdl.send("*RST")
+    assert_equal(0, self.class.hdl.out_length)
+    assert_equal(0, self.class.hdl.err_length)
+  end
+
+  def test_scope_range_auto_keep_limits
+    self.class.hdl.send("SOUR:FUNC NONE")
+    self.class.hdl.send("SENS:VOLT:LOW -20.0 (@1)")
+    self.class.hdl.send("SENS:VOLT:UPP 20.0 (@1)")
+    self.class.hdl.send("SENS:VOLT:RANG:AUTO ON (@1)")
+    self.class.hdl.send("SENS:FUNC:ON (@1)")
+    3.times do
+      self.class.hdl.send("INIT:IMM")
+      self.class.hdl.send("*WAI")
+    end
+    # No signal: the last sweep was taken on the low range...
+    self.class.hdl.send("WAV:PRE? (@1)")
+    out = self.class.hdl.recv
+    v = out.split(',').map { |s| Float(s) }
+    assert_operator(v[3], :<, 0.01)
+    # ...without touching the limits the client set.
+    self.class.hdl.send("SENS:VOLT:UPP? (@1)")
+    out = self.class.hdl.recv
+    assert_equal(20.0, Float(out))
+    self.class.hdl.send("SENS:VOLT:LOW? (@1)")
+    out = self.class.hdl.recv
+    assert_equal(-20.0, Float(out))
+    self.class.hdl.send("*RST")
+    assert_equal(0, self.class.hdl.out_length)
+    assert_equal(0, self.class.hdl.err_length)
+  end
+
+  def test_scope_log
+    path = "/tmp/cgr101-scpi-test-#{Process.pid}.log"
+    self.class.hdl.send("SYST:INT:LOG?")
+    out = self.class.hdl.recv
+    assert_equal("0,0", out)
+    self.class.hdl.send("SYST:INT:LOG \"#{path}\"")
+    2.times do
+      self.class.hdl.send("INIT:IMM")
+      self.class.hdl.send("*WAI")
+    end
+    self.class.hdl.send("SYST:INT:LOG:STOP")
+    self.class.hdl.send("SYST:INT:LOG?")
+    out = self.class.hdl.recv
+    assert_equal("0,0", out)
+    data = File.binread(path)
+    assert_equal("CGR1LOG\0", data[0,8])
+    magic, count, offset = data[-24,24].unpack("a8QQ")
+    assert_equal("CGR1IDX\0", magic)
+    assert_equal(2, count)
+    assert_equal(data.length - 24 - count*32, offset)
+
+    # An existing file is left alone.
+    self.class.hdl.send("SYST:INT:LOG \"#{path}\"")
+    self.class.hdl.send("SYST:ERR?")
+    out = self.class.hdl.recv
+    assert_match(/^-250/, out)
+    assert_equal(data, File.binread(path))
+    File.delete(path)
+    assert_equal(0, self.class.hdl.out_length)
+    assert_equal(0, self.class.hdl.err_length)
+  end
+
+  #
+  # -m shared memory export matches the published capture
+  #
+  def test_scope_export
+    path = "/dev/shm#{self.class.export_name}"
+    self.class.hdl.send("SENS:FUNC:ON (@1,2)")
+    2.times do
+      self.class.hdl.send("INIT:IMM")
+      self.class.hdl.send("*WAI")
+    end
+    self.class.hdl.send("FORM PACK")
+    self.class.hdl.send("SENS:DATA? (@1,2)")
+    block = self.class.hdl.recv_block
+    self.class.hdl.send("FORM ASC")
+    assert_equal(2*(24 + 1280), block.length)
+
+    # struct export_header, then slots of struct export_slot (x86-64)
+    data = File.binread(path)
+    magic, version, depth, slot_size, futex, _, seq =
+      data[0,32].unpack("LLLLLLQ")
+    assert_equal(0x31524743, magic)
+    assert_equal(1, version)
+    assert_equal(64, depth)
+    assert_equal(4232, slot_size)
+    assert_operator(seq, :>=, 2)
+    assert_equal(seq & 0xffffffff, futex)
+    slot = data[32 + (seq % depth)*slot_size, slot_size]
+    lock = slot[0,8].unpack1("Q")
+    assert_equal(0, lock % 2)
+    assert_operator(lock, :>=, 2)
+    cap = slot[8..]
+    assert_equal(seq, cap[0,8].unpack1("Q"))
+    assert_equal(1, cap[8,4].unpack1("L"))
+
+    2.times do |chan|
+      base = 80 + chan*2072
+      low_range = cap[base,4].unpack1("l")
+      step, offset = cap[base + 8,16].unpack("dd")
+      codes = cap[base + 24,2048].unpack("S*")
+      off = chan*(24 + 1280)
+      ch, lr, mid, points, pstep, poffset = block[off,24].unpack("CCnNGG")
+      pcodes = block[off + 24,1280].unpack1("B*").scan(/.{10}/)
+                 .map { |b| b.to_i(2) }
+      assert_equal(chan + 1, ch)
+      assert_equal(low_range, lr)
+      assert_equal(511, mid)
+      assert_equal(1024, points)
+      assert_equal(step, pstep)
+      assert_equal(offset, poffset)
+      assert_equal(codes, pcodes)
+    end
+    assert_equal(0, self.class.hdl.out_length)
+    assert_equal(0, self.class.hdl.err_length)
+  end
+
+  def test_scope_log_compress
+    path = "/tmp/cgr101-scpi-test-#{Process.pid}.plog"
+    self.class.hdl.send("SYST:INT:LOG:COMP?")
+    out = self.class.hdl.recv
+    assert_equal("0", out)
+    self.class.hdl.send("SYST:INT:LOG:COMP ON")
+    self.class.hdl.send("SYST:INT:LOG \"#{path}\"")
+    2.times do
+      self.class.hdl.send("INIT:IMM")
+      self.class.hdl.send("*WAI")
+    end
+    self.class.hdl.send("SYST:INT:LOG:STOP")
+    self.class.hdl.send("SYST:INT:LOG:COMP OFF")
+    data = File.binread(path)
+    magic, version, record_size = data[0,16].unpack("a8LL")
+    assert_equal("CGR1LOG\0", magic)
+    assert_equal(0, record_size)
+    magic, count, offset = data[-24,24].unpack("a8QQ")
+    assert_equal("CGR1IDX\0", magic)
+    assert_equal(2, count)
+    _, _, _, first = data[offset,32].unpack("QqqQ")
+    assert_equal(16, first)
+    len = data[first,4].unpack1("L")
+    assert_operator(len, :<, 2*1024*2 + 200)
+    File.delete(path)
+    assert_equal(0, self.class.hdl.out_length)
+    assert_equal(0, self.class.hdl.err_length)
+  end
+
+  def test_scope_waveform_preamble
+    self.class.hdl.send("SENS:SWE:TIME?")
+    sweep_time = Float(self.class.hdl.recv)
+    self.class.hdl.send("SENS:SWE:OREF:POIN?")
+    oref = Float(self.class.hdl.recv)
+    self.class.hdl.send("SENS:SWE:OFFS:POIN?")
+    offs = Float(self.class.hdl.recv)
+    self.class.hdl.send("SENS:FUNC:ON (@1,2)")
+    self.class.hdl.send("INIT:IMM")
+    self.class.hdl.send("WAV:PRE? (@1,2)")
+    out = self.class.hdl.recv
+    v = out.split(',').map { |s| Float(s) }
+    assert_equal(9, v.length)
+    assert_equal(1024, v[0])
+    assert_in_delta(sweep_time/1024, v[1], 1e-12)
+    assert_in_delta(-(oref + offs)*v[1], v[2], 1e-12)
+    assert_operator(v[3], :>, 0)
+    assert_equal(511, v[5])
+    assert_equal(511, v[8])
+    assert_equal(0, self.class.hdl.out_length)
+    assert_equal(0, self.class.hdl.err_length)
+  end
+
+  def test_scope_data_partial
+    self.class.hdl.send("SENS:FUNC:ON (@1)")
+    self.class.hdl.send("INIT:IMM")
+    self.class.hdl.send("SENS:DATA? (@1)")
+    all = self.class.hdl.recv.split(',')
+    self.class.hdl.send("SENS:DATA:PART? (@1),500,24")
+    part = self.class.hdl.recv.split(',')
+    assert_equal(all[500,24], part)
+    self.class.hdl.send("SENS:DATA:PART? (@1),1000,25")
+    self.class.hdl.send("SYST:ERR?")
+    out = self.class.hdl.recv
+    assert_match(/^-222/, out)
+    assert_equal(0, self.class.hdl.out_length)
+    assert_equal(0, self.class.hdl.err_length)
+  end
+
+  def test_scope_math
+    self.class.hdl.send("CALC:MATH:FUNC? (@8)")
+    out = self.class.hdl.recv
+    assert_equal("OFF", out)
+    self.class.hdl.send("CALC:MATH:FUNC SUBT (@8)")
+    self.class.hdl.send("CALC:MATH:SOUR 2,1 (@8)")
+    self.class.hdl.send("CALC:MATH:SCAL 2.0 (@8)")
+    self.class.hdl.send("CALC:MATH:OFFS 0.5 (@8)")
+    self.class.hdl.send("CALC:MATH:FUNC? (@8)")
+    out = self.class.hdl.recv
+    assert_equal("SUBT", out)
+    self.class.hdl.send("CALC:MATH:SOUR? (@8)")
+    out = self.class.hdl.recv
+    assert_equal("2,1", out)
+    self.class.hdl.send("CALC:MATH:SCAL? (@8)")
+    out = self.class.hdl.recv
+    assert_equal(2.0, Float(out))
+    self.class.hdl.send("CALC:MATH:OFFS? (@8)")
+    out = self.class.hdl.recv
+    assert_equal(0.5, Float(out))
+
+    self.class.hdl.send("SENS:FUNC:ON (@1,2)")
+    self.class.hdl.send("INIT:IMM")
+    self.class.hdl.send("SENS:DATA? (@1,2,8)")
+    v = self.class.hdl.recv.split(',').map { |s| Float(s) }
+    assert_equal(3*1024, v.length)
+    1024.times do |j|
+      assert_in_delta(2.0*(v[1024+j] - v[j]) + 0.5, v[2048+j], 1e-9)
+    end
+    self.class.hdl.send("MEAS:VOLT:MAX? (@8)")
+    out = self.class.hdl.recv
+    assert_in_delta(v[2048,1024].max, Float(out), 0.05)
+
+    self.class.hdl.send("SENS:DATA? (@9)")
+    self.class.hdl.send("SYST:ERR?")
+    out = self.class.hdl.recv
+    assert_match(/^-221/, out)
+    self.class.hdl.send("CALC:MATH:FUNC ADD (@1)")
+    self.class.hdl.send("SYST:ERR?")
+    out = self.class.hdl.recv
+    assert_match(/^-224/, out)
+    self.class.hdl.send("*RST")
+    assert_equal(0, self.class.hdl.out_length)
+    assert_equal(0, self.class.hdl.err_length)
+  end
+
 end
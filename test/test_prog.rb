@@ -21,6 +21,7 @@ require_relative 'cgr101_pwm'
 class TestProg < Test::Unit::TestCase
 
   JIG = ENV['TEST_JIG']
+  EXPORT = "/cgr101-scpi-test-#{Process.pid}"
 
   include CGR101Core
   include CGR101Meas
@@ -52,8 +53,12 @@ class TestProg < Test::Unit::TestCase
   class << self
     attr_reader :hdl
 
+    def export_name
+      EXPORT
+    end
+
     def startup
-      @hdl = CGR101.new
+      @hdl = CGR101.new("-m #{EXPORT}")
       # @hdl.send("SYSTem:INTernal:CALibrate")
       # @hdl.send("SYSTem:INTernal:CONFigure")
     end